@@ -0,0 +1,168 @@
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cinttypes>
+#include <algorithm>
+#include "random.hpp"
+#include "tile_grid.hpp"
+#include "flow_field.hpp"
+#include "line_of_fire.hpp"
+#include "exceptions.hpp"
+#include "ai_benchmark.hpp"
+
+namespace core {
+	//Half tiles per side.
+	static constexpr std::uint32_t Ai_Benchmark_Map_Dimension = Tile_Grid::Max_Dimension;
+	//A navigation window around a group of entities with the margin the game leaves around them.
+	static constexpr std::uint32_t Ai_Benchmark_Window_Dimension = 256;
+	static constexpr std::uint32_t Ai_Benchmark_Solid_Percentage = 20;
+	static constexpr std::uint32_t Ai_Benchmark_Indestructible_Percentage = 5;
+	static constexpr std::uint8_t Ai_Benchmark_Destructible_Cost = 6;
+	static constexpr std::uint32_t Ai_Benchmark_Destroyed_Tile_Count = 256;
+	static constexpr std::uint32_t Ai_Benchmark_Line_Of_Fire_Update_Count = 1 << 12;
+	static constexpr std::uint32_t Ai_Benchmark_Query_Count = 1 << 20;
+	static constexpr std::uint32_t Ai_Benchmark_Repeat_Count = 3;
+	static constexpr std::uint32_t Ai_Benchmark_Seed = 0xA1B3;
+
+	struct Ai_Benchmark_Result {
+		const char* test;
+		std::uint64_t operation_count;
+		std::chrono::nanoseconds time;
+	};
+
+	//'test' gets the index of the repetition and returns a checksum of its results, so they aren't optimized away.
+	template<typename Test>
+	[[nodiscard]] static Ai_Benchmark_Result time_ai_test(const char* name,std::uint64_t* checksum,Test test) {
+		Ai_Benchmark_Result result{name,0,std::chrono::nanoseconds::max()};
+		//The fastest repetition is the one least disturbed by the rest of the system.
+		for(std::uint32_t i = 0;i < Ai_Benchmark_Repeat_Count;i += 1) {
+			std::uint64_t operation_count = 0;
+			auto start = std::chrono::steady_clock::now();
+			*checksum += test(i,&operation_count);
+			auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+			if(time < result.time) result = {name,operation_count,time};
+		}
+		return result;
+	}
+
+	std::string run_ai_benchmark() {
+		std::vector<Ai_Benchmark_Result> results{};
+		std::uint64_t checksum = 0;
+		auto dimension = Ai_Benchmark_Map_Dimension;
+		auto center = std::int32_t(dimension / 2);
+		std::vector<std::uint32_t> random_values(dimension);
+
+		{
+			//Costs like the game's: open ground, destructible tiles that cost more and indestructible ones that can't be crossed.
+			std::vector<std::uint8_t> costs(std::size_t(dimension) * dimension);
+			for(std::uint32_t y = 0;y < dimension;y += 1) {
+				core::fill_random_u32({Ai_Benchmark_Seed,0},0,y,random_values.data(),random_values.size());
+				for(std::uint32_t x = 0;x < dimension;x += 1) {
+					auto value = random_values[x] % 100;
+					std::uint8_t cost = 1;
+					if(value < Ai_Benchmark_Indestructible_Percentage) cost = Flow_Field::Impassable;
+					else if(value < Ai_Benchmark_Solid_Percentage) cost = Ai_Benchmark_Destructible_Cost;
+					costs[std::size_t(y) * dimension + x] = cost;
+				}
+			}
+			Ipoint target = {center,center};
+
+			//How navigation scaled before it was limited to a window.
+			Flow_Field map_field{dimension,dimension,2};
+			results.push_back(core::time_ai_test("navigation_full_map",&checksum,[&](std::uint32_t,std::uint64_t* operation_count) {
+				map_field.compute(costs,&target,1);
+				*operation_count = std::uint64_t(map_field.width()) * map_field.height();
+				return std::uint64_t(map_field.distance(0,0));
+			}));
+			map_field = {};
+
+			auto window_dimension = Ai_Benchmark_Window_Dimension;
+			Ipoint origin = {center - std::int32_t(window_dimension / 2),center - std::int32_t(window_dimension / 2)};
+			std::vector<std::uint8_t> window_costs(std::size_t(window_dimension) * window_dimension);
+			Flow_Field window_field{window_dimension,window_dimension,2,origin};
+			results.push_back(core::time_ai_test("navigation_window",&checksum,[&](std::uint32_t,std::uint64_t* operation_count) {
+				for(std::uint32_t y = 0;y < window_dimension;y += 1) {
+					const auto* row = &costs[std::size_t(std::uint32_t(origin.y) + y) * dimension + std::uint32_t(origin.x)];
+					std::copy(row,row + window_dimension,&window_costs[std::size_t(y) * window_dimension]);
+				}
+				window_field.resize(window_dimension,window_dimension,origin);
+				window_field.compute(window_costs,&target,1);
+				*operation_count = std::uint64_t(window_field.width()) * window_field.height();
+				return std::uint64_t(window_field.distance(origin.x,origin.y));
+			}));
+
+			//Every repetition destroys its own tiles, one per call like a bullet hit would.
+			std::vector<Ipoint> destructible_cells{};
+			for(std::uint32_t round = 0;destructible_cells.size() < Ai_Benchmark_Destroyed_Tile_Count * Ai_Benchmark_Repeat_Count;round += 1) {
+				core::fill_random_u32({Ai_Benchmark_Seed,1},round,0,random_values.data(),random_values.size());
+				for(std::size_t i = 0;i + 1 < random_values.size() && destructible_cells.size() < Ai_Benchmark_Destroyed_Tile_Count * Ai_Benchmark_Repeat_Count;i += 2) {
+					Ipoint cell = {std::int32_t(random_values[i] % window_dimension),std::int32_t(random_values[i + 1] % window_dimension)};
+					auto& cost = window_costs[std::size_t(cell.y) * window_dimension + std::size_t(cell.x)];
+					if(cost != Ai_Benchmark_Destructible_Cost) continue;
+					//Marked so no cell is picked twice.
+					cost = Ai_Benchmark_Destructible_Cost + 1;
+					destructible_cells.push_back({origin.x + cell.x,origin.y + cell.y});
+				}
+			}
+			window_field.compute(window_costs,&target,1);
+			results.push_back(core::time_ai_test("navigation_destroyed_tile",&checksum,[&](std::uint32_t repetition,std::uint64_t* operation_count) {
+				std::uint64_t distance_sum = 0;
+				for(std::size_t i = repetition * Ai_Benchmark_Destroyed_Tile_Count;i < (repetition + 1) * Ai_Benchmark_Destroyed_Tile_Count;i += 1) {
+					auto cell = destructible_cells[i];
+					window_costs[std::size_t(cell.y - origin.y) * window_dimension + std::size_t(cell.x - origin.x)] = 1;
+					if(!window_field.lower_costs(window_costs,&cell,1)) throw Runtime_Exception("Destroying a tile raised a navigation cost.");
+					distance_sum += window_field.distance(cell.x,cell.y);
+					*operation_count += 1;
+				}
+				return distance_sum;
+			}));
+		}
+
+		//Tiles for the line of fire, with the same share of solid ones.
+		std::vector<Tile_Template> templates = {{0,1,0.0f,Tile_Flag::Solid}};
+		Tile_Grid grid{};
+		grid.resize(dimension,dimension);
+		for(std::uint32_t y = 0;y < dimension;y += 1) {
+			core::fill_random_u32({Ai_Benchmark_Seed,2},0,y,random_values.data(),random_values.size());
+			for(std::uint32_t x = 0;x < dimension;x += 1) {
+				if(random_values[x] % 100 < Ai_Benchmark_Solid_Percentage) grid.set(std::int32_t(x),std::int32_t(y),{0,1},templates);
+			}
+		}
+		core::fill_random_u32({Ai_Benchmark_Seed,3},0,0,random_values.data(),random_values.size());
+		auto random_coordinate = [&](std::size_t index) { return float(random_values[index % random_values.size()] % dimension) / 2.0f; };
+		Line_Of_Fire lines_of_fire;
+		Rect targets[Line_Of_Fire::Max_Target_Count] = {};
+		results.push_back(core::time_ai_test("line_of_fire_update",&checksum,[&](std::uint32_t,std::uint64_t* operation_count) {
+			for(std::uint32_t i = 0;i < Ai_Benchmark_Line_Of_Fire_Update_Count;i += 1) {
+				for(std::size_t j = 0;j < Line_Of_Fire::Max_Target_Count;j += 1) targets[j] = {random_coordinate(6 * i + 2 * j),random_coordinate(6 * i + 2 * j + 1),1.0f,1.0f};
+				lines_of_fire.update(grid,targets,Line_Of_Fire::Max_Target_Count);
+			}
+			*operation_count = Ai_Benchmark_Line_Of_Fire_Update_Count;
+			return std::uint64_t(lines_of_fire.first_target({0,0},0,true));
+		}));
+		results.push_back(core::time_ai_test("line_of_fire_query",&checksum,[&](std::uint32_t,std::uint64_t* operation_count) {
+			std::uint64_t hit_count = 0;
+			for(std::uint32_t i = 0;i < Ai_Benchmark_Query_Count;i += 1) {
+				auto value = random_values[i % random_values.size()];
+				Ipoint cell = {std::int32_t(value % dimension),std::int32_t(random_values[(i + 1) % random_values.size()] % dimension)};
+				hit_count += lines_of_fire.first_target(cell,std::uint8_t((value >> 29) & 3),(value >> 31) != 0) != Line_Of_Fire::No_Target;
+			}
+			*operation_count = Ai_Benchmark_Query_Count;
+			return hit_count;
+		}));
+
+		std::string report = "test,operations,ms,ns_per_operation\n";
+		for(const auto& result : results) {
+			char buffer[256] = {};
+			auto milliseconds = double(result.time.count()) / 1000000.0;
+			int count = std::snprintf(buffer,sizeof(buffer) - 1,"%s,%" PRIu64 ",%.3f,%.3f\n",result.test,result.operation_count,milliseconds,
+									  double(result.time.count()) / double(std::max<std::uint64_t>(result.operation_count,1)));
+			if(count < 0) throw Runtime_Exception("Couldn't create the AI benchmark report.");
+			report += buffer;
+		}
+		char buffer[64] = {};
+		int count = std::snprintf(buffer,sizeof(buffer) - 1,"#checksum: %" PRIu64 "\n",checksum);
+		if(count < 0) throw Runtime_Exception("Couldn't create the AI benchmark report.");
+		return report + buffer;
+	}
+}
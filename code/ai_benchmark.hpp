@@ -0,0 +1,12 @@
+#ifndef AI_BENCHMARK_HPP
+#define AI_BENCHMARK_HPP
+
+#include <string>
+
+namespace core {
+	/*	Times the per-tick AI passes on a random map of the largest size: the navigation field over the whole map and over a window around the
+		entities, updating a field after a tile got destroyed, and the line of fire queries. Returns the report as CSV, one line per test. */
+	[[nodiscard]] std::string run_ai_benchmark();
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef AI_SCHEDULER_HPP
+#define AI_SCHEDULER_HPP
+
+#include <deque>
+#include <chrono>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <memory_resource>
+
+namespace core {
+	/*	Spreads AI decisions over frames so that many agents wanting to think at once don't cause a spike.
+		Agents request a decision, requests are then granted in FIFO order as long as they fit the frame budget and the rest wait for the next frame.
+		Decisions may run in parallel, so the budget is judged by the decision times reported for previous frames rather than by timing the current one. */
+	class Ai_Scheduler {
+	public:
+		using Agent_Id = std::uint32_t;
+		static inline constexpr std::chrono::microseconds Default_Frame_Budget{500};
+
+		explicit Ai_Scheduler(std::chrono::microseconds _frame_budget = Default_Frame_Budget) : queue_memory(),queue(&queue_memory),frame_budget(_frame_budget),average_decision_time(),decision_limit() {}
+		void request(Agent_Id id) { queue.push_back(id); }
+		//Replaces the contents of 'granted' with the requests to serve this frame and returns how many there are.
+		//At least one request is granted every frame, so a decision slower than the budget can't stall the queue.
+		std::size_t grant(std::pmr::vector<Agent_Id>* granted);
+		//Total time the decisions granted this frame took, summed over all threads.
+		void report_decision_time(std::chrono::nanoseconds total_time,std::size_t decision_count) noexcept;
+		void clear() noexcept { queue.clear(); }
+		void set_frame_budget(std::chrono::microseconds budget) noexcept { frame_budget = budget; }
+		//A non-zero limit grants a fixed number of requests per frame regardless of timing, for runs that must be reproducible.
+		void set_decision_limit(std::size_t limit) noexcept { decision_limit = limit; }
+		[[nodiscard]] std::chrono::microseconds budget() const noexcept { return frame_budget; }
+		[[nodiscard]] std::size_t pending_count() const noexcept { return queue.size(); }
+	private:
+		//Recycles the blocks of the queue, requests pass through it every frame.
+		std::pmr::unsynchronized_pool_resource queue_memory;
+		std::pmr::deque<Agent_Id> queue;
+		std::chrono::microseconds frame_budget;
+		std::chrono::nanoseconds average_decision_time;
+		std::size_t decision_limit;
+	};
+
+	inline std::size_t Ai_Scheduler::grant(std::pmr::vector<Agent_Id>* granted) {
+		std::size_t count = queue.size();
+		if(decision_limit > 0) count = std::min(count,decision_limit);
+		else if(average_decision_time.count() > 0) {
+			auto affordable = std::size_t(std::chrono::duration_cast<std::chrono::nanoseconds>(frame_budget) / average_decision_time);
+			count = std::min(count,std::max<std::size_t>(affordable,1));
+		}
+		granted->assign(queue.begin(),queue.begin() + std::ptrdiff_t(count));
+		queue.erase(queue.begin(),queue.begin() + std::ptrdiff_t(count));
+		return count;
+	}
+
+	inline void Ai_Scheduler::report_decision_time(std::chrono::nanoseconds total_time,std::size_t decision_count) noexcept {
+		if(decision_count == 0) return;
+		//Exponential moving average, so a single slow frame doesn't throttle the next ones too much.
+		auto sample = total_time / std::chrono::nanoseconds::rep(decision_count);
+		if(average_decision_time.count() == 0) average_decision_time = sample;
+		else average_decision_time = (average_decision_time * 7 + sample) / 8;
+		if(average_decision_time.count() == 0) average_decision_time = std::chrono::nanoseconds(1);
+	}
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include <new>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cinttypes>
+#include <algorithm>
+#include "allocation_tracker.hpp"
+#include "exceptions.hpp"
+
+#if defined(CORE_TRACK_ALLOCATIONS) && defined(_MSC_VER)
+	#include <intrin.h>
+	#define CORE_CALLER_ADDRESS() _ReturnAddress()
+#elif defined(CORE_TRACK_ALLOCATIONS)
+	#define CORE_CALLER_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace core {
+	static constexpr std::size_t Phase_Count = std::size_t(Allocation_Phase::Count);
+
+	static std::atomic<std::uint8_t> current_allocation_phase{std::uint8_t(Allocation_Phase::Other)};
+
+	const char* allocation_phase_name(Allocation_Phase phase) noexcept {
+		switch(phase) {
+			case Allocation_Phase::Update_Player: return "update_player";
+			case Allocation_Phase::Update_Enemies: return "update_enemies";
+			case Allocation_Phase::Update_Bullets: return "update_bullets";
+			case Allocation_Phase::Render: return "render";
+			default: return "other";
+		}
+	}
+
+	Allocation_Counts Allocation_Frame::total() const noexcept {
+		Allocation_Counts counts{};
+		for(const auto& phase : phases) {
+			counts.count += phase.count;
+			counts.byte_count += phase.byte_count;
+		}
+		return counts;
+	}
+
+	Allocation_Phase_Scope::Allocation_Phase_Scope(Allocation_Phase phase) noexcept : previous(Allocation_Phase(current_allocation_phase.exchange(std::uint8_t(phase),std::memory_order_relaxed))) {}
+
+	Allocation_Phase_Scope::~Allocation_Phase_Scope() {
+		current_allocation_phase.store(std::uint8_t(previous),std::memory_order_relaxed);
+	}
+
+#if defined(CORE_TRACK_ALLOCATIONS)
+	//Power of two. Sites past a full table still count toward their phase, they just aren't listed.
+	static constexpr std::size_t Site_Table_Size = 1024;
+
+	struct Tracked_Site {
+		const void* caller;
+		std::uint8_t phase;
+		std::uint64_t count;
+		std::uint64_t byte_count;
+	};
+	struct Phase_Counters {
+		std::atomic<std::uint64_t> count;
+		std::atomic<std::uint64_t> byte_count;
+	};
+
+	//Everything is constant initialized, so allocations of static constructors that run before 'main' are counted as well.
+	static Phase_Counters phase_counters[Phase_Count];
+	static Tracked_Site tracked_sites[Site_Table_Size];
+	//The hook can't allocate, so the table is guarded by a spin lock instead of a mutex.
+	static std::atomic_flag tracked_sites_lock{};
+
+	static void lock_tracked_sites() noexcept {
+		while(tracked_sites_lock.test_and_set(std::memory_order_acquire)) {}
+	}
+	static void unlock_tracked_sites() noexcept {
+		tracked_sites_lock.clear(std::memory_order_release);
+	}
+
+	static void record_allocation(std::size_t byte_count,const void* caller) noexcept {
+		auto phase = current_allocation_phase.load(std::memory_order_relaxed);
+		phase_counters[phase].count.fetch_add(1,std::memory_order_relaxed);
+		phase_counters[phase].byte_count.fetch_add(byte_count,std::memory_order_relaxed);
+
+		auto hash = (std::uintptr_t(caller) >> 2) * 0x9E3779B97F4A7C15ull + phase;
+		lock_tracked_sites();
+		for(std::size_t probe = 0;probe < Site_Table_Size;probe += 1) {
+			auto& site = tracked_sites[(std::size_t(hash) + probe) & (Site_Table_Size - 1)];
+			if(site.count == 0) {
+				site.caller = caller;
+				site.phase = phase;
+			}
+			else if(site.caller != caller || site.phase != phase) continue;
+			site.count += 1;
+			site.byte_count += byte_count;
+			break;
+		}
+		unlock_tracked_sites();
+	}
+
+	static void* allocate_tracked(std::size_t byte_count,std::size_t alignment,const void* caller) {
+		//Zero bytes still give a unique pointer.
+		auto size = std::max<std::size_t>(byte_count,1);
+		while(true) {
+			void* pointer = nullptr;
+#if defined(_WIN32)
+			pointer = (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ? _aligned_malloc(size,alignment) : std::malloc(size);
+#else
+			pointer = (alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ? std::aligned_alloc(alignment,(size + alignment - 1) / alignment * alignment) : std::malloc(size);
+#endif
+			if(pointer) {
+				core::record_allocation(byte_count,caller);
+				return pointer;
+			}
+			auto handler = std::get_new_handler();
+			if(!handler) throw std::bad_alloc();
+			handler();
+		}
+	}
+
+	static void free_tracked(void* pointer,std::size_t alignment) noexcept {
+#if defined(_WIN32)
+		if(alignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+			_aligned_free(pointer);
+			return;
+		}
+#else
+		(void)alignment;
+#endif
+		std::free(pointer);
+	}
+#endif
+
+	Allocation_Frame take_allocation_frame() noexcept {
+		Allocation_Frame frame{};
+#if defined(CORE_TRACK_ALLOCATIONS)
+		for(std::size_t i = 0;i < Phase_Count;i += 1) {
+			frame.phases[i].count = phase_counters[i].count.exchange(0,std::memory_order_relaxed);
+			frame.phases[i].byte_count = phase_counters[i].byte_count.exchange(0,std::memory_order_relaxed);
+		}
+		lock_tracked_sites();
+		for(auto& site : tracked_sites) {
+			if(site.count == 0) continue;
+			//Kept sorted by count, the site replaces the last one if it allocated more often.
+			Allocation_Site entry{site.caller,Allocation_Phase(site.phase),{site.count,site.byte_count}};
+			auto index = frame.site_count;
+			if(index == Allocation_Frame::Max_Site_Count) {
+				if(frame.sites[index - 1].counts.count >= entry.counts.count) {
+					site = {};
+					continue;
+				}
+				index -= 1;
+			}
+			else frame.site_count += 1;
+			for(;index > 0 && frame.sites[index - 1].counts.count < entry.counts.count;index -= 1) frame.sites[index] = frame.sites[index - 1];
+			frame.sites[index] = entry;
+			site = {};
+		}
+		unlock_tracked_sites();
+#endif
+		return frame;
+	}
+
+	std::string format_allocation_frame(const Allocation_Frame& frame) {
+		std::string text{};
+		char buffer[256] = {};
+		for(std::size_t i = 0;i < Phase_Count;i += 1) {
+			const auto& counts = frame.phases[i];
+			if(counts.count == 0) continue;
+			int count = std::snprintf(buffer,sizeof(buffer) - 1,"%s: %" PRIu64 " allocations, %" PRIu64 " bytes\n",core::allocation_phase_name(Allocation_Phase(i)),counts.count,counts.byte_count);
+			if(count < 0) throw Runtime_Exception("Couldn't format the allocations of a frame.");
+			text += buffer;
+		}
+		for(std::size_t i = 0;i < frame.site_count;i += 1) {
+			const auto& site = frame.sites[i];
+			int count = std::snprintf(buffer,sizeof(buffer) - 1,"  %p in %s: %" PRIu64 " allocations, %" PRIu64 " bytes\n",site.caller,core::allocation_phase_name(site.phase),site.counts.count,site.counts.byte_count);
+			if(count < 0) throw Runtime_Exception("Couldn't format the allocations of a frame.");
+			text += buffer;
+		}
+		return text;
+	}
+}
+
+#if defined(CORE_TRACK_ALLOCATIONS)
+//The nothrow forms aren't replaced, by default they call these. Every form has to be replaced together with its 'operator delete'.
+void* operator new(std::size_t byte_count) {
+	return core::allocate_tracked(byte_count,__STDCPP_DEFAULT_NEW_ALIGNMENT__,CORE_CALLER_ADDRESS());
+}
+void* operator new[](std::size_t byte_count) {
+	return core::allocate_tracked(byte_count,__STDCPP_DEFAULT_NEW_ALIGNMENT__,CORE_CALLER_ADDRESS());
+}
+void* operator new(std::size_t byte_count,std::align_val_t alignment) {
+	return core::allocate_tracked(byte_count,std::size_t(alignment),CORE_CALLER_ADDRESS());
+}
+void* operator new[](std::size_t byte_count,std::align_val_t alignment) {
+	return core::allocate_tracked(byte_count,std::size_t(alignment),CORE_CALLER_ADDRESS());
+}
+void operator delete(void* pointer) noexcept {
+	core::free_tracked(pointer,__STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete[](void* pointer) noexcept {
+	core::free_tracked(pointer,__STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void* pointer,std::size_t) noexcept {
+	core::free_tracked(pointer,__STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete[](void* pointer,std::size_t) noexcept {
+	core::free_tracked(pointer,__STDCPP_DEFAULT_NEW_ALIGNMENT__);
+}
+void operator delete(void* pointer,std::align_val_t alignment) noexcept {
+	core::free_tracked(pointer,std::size_t(alignment));
+}
+void operator delete[](void* pointer,std::align_val_t alignment) noexcept {
+	core::free_tracked(pointer,std::size_t(alignment));
+}
+void operator delete(void* pointer,std::size_t,std::align_val_t alignment) noexcept {
+	core::free_tracked(pointer,std::size_t(alignment));
+}
+void operator delete[](void* pointer,std::size_t,std::align_val_t alignment) noexcept {
+	core::free_tracked(pointer,std::size_t(alignment));
+}
+#endif
@@ -0,0 +1,66 @@
+#ifndef ALLOCATION_TRACKER_HPP
+#define ALLOCATION_TRACKER_HPP
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+	/*	Counts heap allocations per frame, per phase of the frame and per call site, so hot paths can be kept from allocating. The counting
+		replaces the global 'operator new' and is only compiled in with CORE_TRACK_ALLOCATIONS defined, through the CMake option
+		TANKS_TRACK_ALLOCATIONS, since it costs a lock on every allocation. Without it frames always report no allocations.
+		Allocations of every thread count toward the phase the main thread is in, e.g. those of the simulation workers toward 'Update_Enemies'. */
+#if defined(CORE_TRACK_ALLOCATIONS)
+	inline constexpr bool Allocation_Tracking_Enabled = true;
+#else
+	inline constexpr bool Allocation_Tracking_Enabled = false;
+#endif
+
+	enum class Allocation_Phase : std::uint8_t {
+		Other,
+		Update_Player,
+		Update_Enemies,
+		Update_Bullets,
+		Render,
+		Count
+	};
+	[[nodiscard]] const char* allocation_phase_name(Allocation_Phase phase) noexcept;
+
+	struct Allocation_Counts {
+		std::uint64_t count;
+		std::uint64_t byte_count;
+	};
+	struct Allocation_Site {
+		//Return address of the call to 'operator new', resolved to a line with a debugger or addr2line.
+		const void* caller;
+		Allocation_Phase phase;
+		Allocation_Counts counts;
+	};
+	//Fixed size, so taking one every frame doesn't allocate itself.
+	struct Allocation_Frame {
+		static inline constexpr std::size_t Max_Site_Count = 16;
+		Allocation_Counts phases[std::size_t(Allocation_Phase::Count)];
+		//The sites that allocated most often, per phase.
+		Allocation_Site sites[Max_Site_Count];
+		std::size_t site_count;
+		[[nodiscard]] Allocation_Counts total() const noexcept;
+	};
+
+	//Returns what was allocated since the previous call and starts counting the next frame.
+	[[nodiscard]] Allocation_Frame take_allocation_frame() noexcept;
+	//One line per phase and per site that allocated.
+	[[nodiscard]] std::string format_allocation_frame(const Allocation_Frame& frame);
+
+	//Attributes allocations to 'phase' until destroyed, scopes can be nested.
+	class Allocation_Phase_Scope {
+	public:
+		explicit Allocation_Phase_Scope(Allocation_Phase phase) noexcept;
+		Allocation_Phase_Scope(const Allocation_Phase_Scope&) = delete;
+		Allocation_Phase_Scope& operator=(const Allocation_Phase_Scope&) = delete;
+		~Allocation_Phase_Scope();
+	private:
+		Allocation_Phase previous;
+	};
+}
+
+#endif
@@ -0,0 +1,170 @@
+#include <cmath>
+#include <cctype>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include "behaviour.hpp"
+#include "exceptions.hpp"
+
+namespace core {
+	struct Behaviour_Mnemonic {
+		const char* name;
+		Behaviour_Opcode opcode;
+		//One character per operand: 'r' register, 'v' number, 'l' label.
+		const char* operands;
+	};
+	static constexpr Behaviour_Mnemonic Behaviour_Mnemonics[] = {
+		{"set",Behaviour_Opcode::Set,"rv"},{"mov",Behaviour_Opcode::Mov,"rr"},
+		{"add",Behaviour_Opcode::Add,"rrr"},{"sub",Behaviour_Opcode::Sub,"rrr"},{"mul",Behaviour_Opcode::Mul,"rrr"},{"mod",Behaviour_Opcode::Mod,"rrr"},
+		{"lt",Behaviour_Opcode::Lt,"rrr"},{"le",Behaviour_Opcode::Le,"rrr"},{"eq",Behaviour_Opcode::Eq,"rrr"},{"not",Behaviour_Opcode::Not,"rr"},
+		{"random",Behaviour_Opcode::Random,"r"},
+		{"jmp",Behaviour_Opcode::Jmp,"l"},{"jz",Behaviour_Opcode::Jz,"rl"},{"jnz",Behaviour_Opcode::Jnz,"rl"},
+		{"dir",Behaviour_Opcode::Dir,"r"},{"cooldown",Behaviour_Opcode::Cooldown,"r"},{"hops",Behaviour_Opcode::Hops,"r"},
+		{"look",Behaviour_Opcode::Look,"rr"},{"sight",Behaviour_Opcode::Sight,"rr"},{"tile",Behaviour_Opcode::Tile,"rr"},
+		{"distance",Behaviour_Opcode::Distance,"rr"},{"navigate",Behaviour_Opcode::Navigate,"r"},
+		{"turn",Behaviour_Opcode::Turn,"r"},{"shoot",Behaviour_Opcode::Shoot,""},{"wait",Behaviour_Opcode::Wait,"r"},{"end",Behaviour_Opcode::End,""}
+	};
+
+	[[nodiscard]] static std::uint8_t parse_register(const std::string& token) {
+		if(token.size() < 2 || token[0] != 'r') throw Runtime_Exception("Behaviour operand isn't a register.");
+		char* end = nullptr;
+		auto index = std::strtoul(token.c_str() + 1,&end,10);
+		if(*end != '\0' || index >= Behaviour_Program::Register_Count) throw Runtime_Exception("Behaviour register doesn't exist.");
+		return std::uint8_t(index);
+	}
+
+	[[nodiscard]] static std::uint32_t to_direction(float value) noexcept {
+		return std::uint32_t(std::int32_t(value) & 3);
+	}
+
+	Behaviour_Program Behaviour_Program::compile(const std::vector<std::uint8_t>& text) {
+		struct Label_Fixup {
+			std::size_t instruction_index;
+			std::string label;
+		};
+		Behaviour_Program program{};
+		std::vector<std::pair<std::string,std::size_t>> labels{};
+		std::vector<Label_Fixup> fixups{};
+
+		std::string line{};
+		std::vector<std::string> tokens{};
+		for(std::size_t line_start = 0;line_start < text.size();) {
+			auto line_end = std::size_t(std::find(text.begin() + std::ptrdiff_t(line_start),text.end(),std::uint8_t('\n')) - text.begin());
+			line.assign(text.begin() + std::ptrdiff_t(line_start),text.begin() + std::ptrdiff_t(line_end));
+			line_start = line_end + 1;
+
+			//Comments run to the end of the line and commas are only there for readability.
+			line = line.substr(0,line.find('#'));
+			std::replace(line.begin(),line.end(),',',' ');
+			tokens.clear();
+			for(std::size_t i = 0;i < line.size();) {
+				if(std::isspace(static_cast<unsigned char>(line[i]))) {
+					i += 1;
+					continue;
+				}
+				std::size_t token_end = i;
+				while(token_end < line.size() && !std::isspace(static_cast<unsigned char>(line[token_end]))) token_end += 1;
+				tokens.push_back(line.substr(i,token_end - i));
+				i = token_end;
+			}
+			if(tokens.empty()) continue;
+
+			std::size_t first = 0;
+			if(tokens[0].back() == ':') {
+				labels.push_back({tokens[0].substr(0,tokens[0].size() - 1),program.code.size()});
+				first = 1;
+				if(tokens.size() == 1) continue;
+			}
+
+			const Behaviour_Mnemonic* mnemonic = nullptr;
+			for(const auto& candidate : Behaviour_Mnemonics) {
+				if(tokens[first] == candidate.name) mnemonic = &candidate;
+			}
+			if(!mnemonic) throw Runtime_Exception("Unknown behaviour instruction.");
+			if(tokens.size() - first - 1 != std::strlen(mnemonic->operands)) throw Runtime_Exception("Wrong number of behaviour operands.");
+
+			Behaviour_Instruction instruction{mnemonic->opcode,0,0,0};
+			std::uint8_t* registers[] = {&instruction.a,&instruction.b,&instruction.c};
+			std::size_t register_count = 0;
+			for(std::size_t i = 0;mnemonic->operands[i] != '\0';i += 1) {
+				const auto& token = tokens[first + 1 + i];
+				switch(mnemonic->operands[i]) {
+					case 'r': *registers[register_count++] = core::parse_register(token); break;
+					case 'v': {
+						char* end = nullptr;
+						float value = std::strtof(token.c_str(),&end);
+						if(*end != '\0') throw Runtime_Exception("Behaviour operand isn't a number.");
+						if(program.constants.size() > 0xFFFF) throw Runtime_Exception("Behaviour has too many constants.");
+						instruction.b = std::uint8_t(program.constants.size());
+						instruction.c = std::uint8_t(program.constants.size() >> 8);
+						program.constants.push_back(value);
+						break;
+					}
+					case 'l': fixups.push_back({program.code.size(),token}); break;
+				}
+			}
+			program.code.push_back(instruction);
+		}
+		program.code.push_back({Behaviour_Opcode::End,0,0,0});
+		if(program.code.size() > 0xFFFF) throw Runtime_Exception("Behaviour is too long.");
+
+		for(const auto& fixup : fixups) {
+			auto it = std::find_if(labels.begin(),labels.end(),[&](const auto& label) { return label.first == fixup.label; });
+			if(it == labels.end()) throw Runtime_Exception("Behaviour jumps to an unknown label.");
+			program.code[fixup.instruction_index].b = std::uint8_t(it->second);
+			program.code[fixup.instruction_index].c = std::uint8_t(it->second >> 8);
+		}
+		return program;
+	}
+
+	void Behaviour_Program::run(Behaviour_Agent* agent,const Behaviour_World& world,Random_Stream* random) const {
+		float r[Register_Count] = {};
+		std::size_t pc = 0;
+		for(std::uint32_t step = 0;step < Max_Step_Count;step += 1) {
+			//Every jump target was checked when compiling and the last instruction is 'end', so 'pc' can't leave the code.
+			const auto& instruction = code[pc++];
+			switch(instruction.opcode) {
+				case Behaviour_Opcode::Set: r[instruction.a] = constants[instruction.wide_operand()]; break;
+				case Behaviour_Opcode::Mov: r[instruction.a] = r[instruction.b]; break;
+				case Behaviour_Opcode::Add: r[instruction.a] = r[instruction.b] + r[instruction.c]; break;
+				case Behaviour_Opcode::Sub: r[instruction.a] = r[instruction.b] - r[instruction.c]; break;
+				case Behaviour_Opcode::Mul: r[instruction.a] = r[instruction.b] * r[instruction.c]; break;
+				case Behaviour_Opcode::Mod: {
+					float divisor = r[instruction.c];
+					float value = (divisor != 0.0f) ? std::fmod(r[instruction.b],divisor) : 0.0f;
+					r[instruction.a] = (value < 0.0f) ? value + std::abs(divisor) : value;
+					break;
+				}
+				case Behaviour_Opcode::Lt: r[instruction.a] = (r[instruction.b] < r[instruction.c]) ? 1.0f : 0.0f; break;
+				case Behaviour_Opcode::Le: r[instruction.a] = (r[instruction.b] <= r[instruction.c]) ? 1.0f : 0.0f; break;
+				case Behaviour_Opcode::Eq: r[instruction.a] = (r[instruction.b] == r[instruction.c]) ? 1.0f : 0.0f; break;
+				case Behaviour_Opcode::Not: r[instruction.a] = (r[instruction.b] == 0.0f) ? 1.0f : 0.0f; break;
+				case Behaviour_Opcode::Random: r[instruction.a] = random->next_float(); break;
+				case Behaviour_Opcode::Jmp: pc = instruction.wide_operand(); break;
+				case Behaviour_Opcode::Jz: if(r[instruction.a] == 0.0f) pc = instruction.wide_operand(); break;
+				case Behaviour_Opcode::Jnz: if(r[instruction.a] != 0.0f) pc = instruction.wide_operand(); break;
+				case Behaviour_Opcode::Dir: r[instruction.a] = float(agent->dir); break;
+				case Behaviour_Opcode::Cooldown: r[instruction.a] = agent->shoot_cooldown; break;
+				case Behaviour_Opcode::Hops: r[instruction.a] = float(agent->hop_count_until_shoot); break;
+				case Behaviour_Opcode::Look: r[instruction.a] = world.look(core::to_direction(r[instruction.b]),true); break;
+				case Behaviour_Opcode::Sight: r[instruction.a] = world.look(core::to_direction(r[instruction.b]),false); break;
+				case Behaviour_Opcode::Tile: r[instruction.a] = world.tile(core::to_direction(r[instruction.b])); break;
+				case Behaviour_Opcode::Distance: r[instruction.a] = world.distance(core::to_direction(r[instruction.b])); break;
+				case Behaviour_Opcode::Navigate: r[instruction.a] = world.navigate(); break;
+				case Behaviour_Opcode::Turn: {
+					auto dir = core::to_direction(r[instruction.a]);
+					if(dir != agent->dir) {
+						agent->dir = dir;
+						agent->turned = true;
+					}
+					break;
+				}
+				case Behaviour_Opcode::Shoot: agent->shoot = true; break;
+				case Behaviour_Opcode::Wait: agent->wait = std::max(r[instruction.a],0.0f); break;
+				case Behaviour_Opcode::End: return;
+			}
+		}
+	}
+}
@@ -0,0 +1,83 @@
+#ifndef BEHAVIOUR_HPP
+#define BEHAVIOUR_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "random.hpp"
+
+namespace core {
+	/*	Enemy behaviours written in a small assembly-like language and compiled once into bytecode for a register machine.
+		Every line holds a label ("name:") or an instruction, '#' starts a comment and operands are separated by spaces or commas.
+		There are 16 registers, 'r0' to 'r15', holding numbers. Directions are 0 right, 1 down, 2 left and 3 up.
+
+		set rA value      rA = value
+		mov rA rB         rA = rB
+		add/sub/mul/mod rA rB rC   rA = rB op rC, 'mod' is always non-negative
+		lt/le/eq rA rB rC          rA = 1 if the comparison holds, 0 otherwise
+		not rA rB         rA = 1 if rB is 0, 0 otherwise
+		random rA         rA = random number in [0, 1)
+		jmp label, jz rA label, jnz rA label
+		dir rA, cooldown rA, hops rA      Direction, shoot cooldown and moves left until a forced shot of the tank.
+		look rA rB        First target a shot in direction rB would reach through any tiles: 0 nothing, 2 first player, 3 second player, 4 eagle.
+		sight rA rB       Same as 'look', but solid tiles block the view.
+		tile rA rB        Flag of the tile in front of the tank in direction rB: -1 none, 0 solid, 1 below, 2 above, 3 bulletpass.
+		distance rA rB    Navigation distance to the nearest target after a step in direction rB, 65535 if unreachable.
+		navigate rA       Direction the navigation fields recommend, -1 if none.
+		turn rA           Faces direction rA.
+		shoot             Fires as soon as the cooldown allows.
+		wait rA           The next decision comes in rA seconds.
+		end               Stops, also implied after the last line. */
+	enum class Behaviour_Opcode : std::uint8_t {
+		Set,Mov,Add,Sub,Mul,Mod,Lt,Le,Eq,Not,Random,
+		Jmp,Jz,Jnz,
+		Dir,Cooldown,Hops,Look,Sight,Tile,Distance,Navigate,
+		Turn,Shoot,Wait,End
+	};
+	//Operands are register indices, 'set' and jumps keep a constant or instruction index in 'b' and 'c' instead.
+	struct Behaviour_Instruction {
+		Behaviour_Opcode opcode;
+		std::uint8_t a;
+		std::uint8_t b;
+		std::uint8_t c;
+		[[nodiscard]] std::uint16_t wide_operand() const noexcept { return std::uint16_t(b | (c << 8)); }
+	};
+
+	//Queries about the world around the agent a behaviour runs for.
+	class Behaviour_World {
+	public:
+		virtual ~Behaviour_World() = default;
+		[[nodiscard]] virtual float look(std::uint32_t dir,bool through_tiles) const = 0;
+		[[nodiscard]] virtual float tile(std::uint32_t dir) const = 0;
+		[[nodiscard]] virtual float distance(std::uint32_t dir) const = 0;
+		[[nodiscard]] virtual float navigate() const = 0;
+	};
+
+	struct Behaviour_Agent {
+		std::uint32_t dir;
+		float shoot_cooldown;
+		std::uint32_t hop_count_until_shoot;
+		//Set by the behaviour.
+		bool turned;
+		bool shoot;
+		//Negative unless the behaviour waited.
+		float wait;
+	};
+
+	class Behaviour_Program {
+	public:
+		static inline constexpr std::size_t Register_Count = 16;
+		//Stops runaway loops, a behaviour that doesn't end within this many instructions ends there.
+		static inline constexpr std::uint32_t Max_Step_Count = 512;
+
+		//Throws 'Runtime_Exception' if the text isn't a valid behaviour.
+		[[nodiscard]] static Behaviour_Program compile(const std::vector<std::uint8_t>& text);
+		void run(Behaviour_Agent* agent,const Behaviour_World& world,Random_Stream* random) const;
+		[[nodiscard]] std::size_t instruction_count() const noexcept { return code.size(); }
+	private:
+		std::vector<Behaviour_Instruction> code;
+		std::vector<float> constants;
+	};
+}
+
+#endif
@@ -0,0 +1,354 @@
+#include <bit>
+#include <cstdio>
+#include <vector>
+#include <cstring>
+#include "entity_kernels.hpp"
+#include "exceptions.hpp"
+#include "random.hpp"
+
+#if defined(CORE_SSE2)
+	#include <emmintrin.h>
+#endif
+#if defined(CORE_X86)
+	#include <immintrin.h>
+#endif
+
+namespace core {
+	static constexpr float Direction_X[] = {1.0f,0.0f,-1.0f,0.0f};
+	static constexpr float Direction_Y[] = {0.0f,1.0f,0.0f,-1.0f};
+
+	void Box_Array::resize(std::size_t count) {
+		min_x.resize(count);
+		min_y.resize(count);
+		max_x.resize(count);
+		max_y.resize(count);
+	}
+
+	//Boxes are passed to the kernels as plain pointers, so the SIMD versions don't care how they are stored.
+	struct Box_Pointers {
+		const float* min_x;
+		const float* min_y;
+		const float* max_x;
+		const float* max_y;
+	};
+
+	static void advance_positions_scalar(float* x,float* y,const std::uint8_t* dir,std::size_t count,float distance) noexcept {
+		for(std::size_t i = 0;i < count;i += 1) {
+			x[i] += Direction_X[dir[i] & 3] * distance;
+			y[i] += Direction_Y[dir[i] & 3] * distance;
+		}
+	}
+
+	static void build_boxes_scalar(const float* x,const float* y,const std::uint8_t* dir,std::size_t count,const Rect* center_boxes,float* min_x,float* min_y,float* max_x,float* max_y) noexcept {
+		for(std::size_t i = 0;i < count;i += 1) {
+			const auto& box = center_boxes[dir[i] & 3];
+			min_x[i] = x[i] + box.x;
+			min_y[i] = y[i] + box.y;
+			max_x[i] = min_x[i] + box.width;
+			max_y[i] = min_y[i] + box.height;
+		}
+	}
+
+	static void overlap_mask_scalar(Box_Pointers boxes,std::size_t count,const Box& box,std::uint8_t* out) noexcept {
+		for(std::size_t i = 0;i < count;i += 1) {
+			out[i] = (boxes.max_x[i] > box.min_x && boxes.min_x[i] < box.max_x && boxes.max_y[i] > box.min_y && boxes.min_y[i] < box.max_y) ? 1 : 0;
+		}
+	}
+
+	static std::size_t first_overlap_scalar(Box_Pointers boxes,std::size_t count,const Box& box) noexcept {
+		for(std::size_t i = 0;i < count;i += 1) {
+			if(boxes.max_x[i] > box.min_x && boxes.min_x[i] < box.max_x && boxes.max_y[i] > box.min_y && boxes.min_y[i] < box.max_y) return i;
+		}
+		return count;
+	}
+
+#if defined(CORE_SSE2)
+	[[nodiscard]] static __m128i load_directions_sse2(const std::uint8_t* dir) noexcept {
+		std::uint32_t packed = 0;
+		std::memcpy(&packed,dir,4);
+		const __m128i zero = _mm_setzero_si128();
+		__m128i widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(int(packed)),zero),zero);
+		return _mm_and_si128(widened,_mm_set1_epi32(3));
+	}
+
+	//Picks 'values[dir]' in every lane.
+	[[nodiscard]] static __m128 select_by_direction_sse2(__m128i dir,const float* values) noexcept {
+		__m128 result = _mm_setzero_ps();
+		for(int i = 0;i < 4;i += 1) {
+			__m128 mask = _mm_castsi128_ps(_mm_cmpeq_epi32(dir,_mm_set1_epi32(i)));
+			result = _mm_or_ps(result,_mm_and_ps(mask,_mm_set1_ps(values[i])));
+		}
+		return result;
+	}
+
+	[[nodiscard]] static int overlap_bits_sse2(Box_Pointers boxes,std::size_t i,const Box& box) noexcept {
+		__m128 overlaps = _mm_and_ps(_mm_cmpgt_ps(_mm_loadu_ps(boxes.max_x + i),_mm_set1_ps(box.min_x)),_mm_cmplt_ps(_mm_loadu_ps(boxes.min_x + i),_mm_set1_ps(box.max_x)));
+		overlaps = _mm_and_ps(overlaps,_mm_cmpgt_ps(_mm_loadu_ps(boxes.max_y + i),_mm_set1_ps(box.min_y)));
+		overlaps = _mm_and_ps(overlaps,_mm_cmplt_ps(_mm_loadu_ps(boxes.min_y + i),_mm_set1_ps(box.max_y)));
+		return _mm_movemask_ps(overlaps);
+	}
+
+	static void advance_positions_sse2(float* x,float* y,const std::uint8_t* dir,std::size_t count,float distance) noexcept {
+		const __m128 step = _mm_set1_ps(distance);
+		std::size_t i = 0;
+		for(;i + 4 <= count;i += 4) {
+			__m128i d = core::load_directions_sse2(dir + i);
+			//Comparisons give -1 where they hold, so the difference of two of them is the direction vector.
+			__m128 dx = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_cmpeq_epi32(d,_mm_set1_epi32(2)),_mm_cmpeq_epi32(d,_mm_setzero_si128())));
+			__m128 dy = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_cmpeq_epi32(d,_mm_set1_epi32(3)),_mm_cmpeq_epi32(d,_mm_set1_epi32(1))));
+			_mm_storeu_ps(x + i,_mm_add_ps(_mm_loadu_ps(x + i),_mm_mul_ps(dx,step)));
+			_mm_storeu_ps(y + i,_mm_add_ps(_mm_loadu_ps(y + i),_mm_mul_ps(dy,step)));
+		}
+		core::advance_positions_scalar(x + i,y + i,dir + i,count - i,distance);
+	}
+
+	static void build_boxes_sse2(const float* x,const float* y,const std::uint8_t* dir,std::size_t count,const Rect* center_boxes,float* min_x,float* min_y,float* max_x,float* max_y) noexcept {
+		float offset_x[4],offset_y[4],width[4],height[4];
+		for(int i = 0;i < 4;i += 1) {
+			offset_x[i] = center_boxes[i].x;
+			offset_y[i] = center_boxes[i].y;
+			width[i] = center_boxes[i].width;
+			height[i] = center_boxes[i].height;
+		}
+		std::size_t i = 0;
+		for(;i + 4 <= count;i += 4) {
+			__m128i d = core::load_directions_sse2(dir + i);
+			__m128 box_min_x = _mm_add_ps(_mm_loadu_ps(x + i),core::select_by_direction_sse2(d,offset_x));
+			__m128 box_min_y = _mm_add_ps(_mm_loadu_ps(y + i),core::select_by_direction_sse2(d,offset_y));
+			_mm_storeu_ps(min_x + i,box_min_x);
+			_mm_storeu_ps(min_y + i,box_min_y);
+			_mm_storeu_ps(max_x + i,_mm_add_ps(box_min_x,core::select_by_direction_sse2(d,width)));
+			_mm_storeu_ps(max_y + i,_mm_add_ps(box_min_y,core::select_by_direction_sse2(d,height)));
+		}
+		core::build_boxes_scalar(x + i,y + i,dir + i,count - i,center_boxes,min_x + i,min_y + i,max_x + i,max_y + i);
+	}
+
+	static void overlap_mask_sse2(Box_Pointers boxes,std::size_t count,const Box& box,std::uint8_t* out) noexcept {
+		std::size_t i = 0;
+		for(;i + 4 <= count;i += 4) {
+			int bits = core::overlap_bits_sse2(boxes,i,box);
+			for(std::size_t j = 0;j < 4;j += 1) out[i + j] = std::uint8_t((bits >> j) & 1);
+		}
+		core::overlap_mask_scalar({boxes.min_x + i,boxes.min_y + i,boxes.max_x + i,boxes.max_y + i},count - i,box,out + i);
+	}
+
+	static std::size_t first_overlap_sse2(Box_Pointers boxes,std::size_t count,const Box& box) noexcept {
+		std::size_t i = 0;
+		for(;i + 4 <= count;i += 4) {
+			int bits = core::overlap_bits_sse2(boxes,i,box);
+			if(bits != 0) return i + std::size_t(std::countr_zero(unsigned(bits)));
+		}
+		return i + core::first_overlap_scalar({boxes.min_x + i,boxes.min_y + i,boxes.max_x + i,boxes.max_y + i},count - i,box);
+	}
+#endif
+
+#if defined(CORE_X86)
+	CORE_TARGET_AVX2 static __m256i load_directions_avx2(const std::uint8_t* dir) noexcept {
+		return _mm256_and_si256(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(dir))),_mm256_set1_epi32(3));
+	}
+
+	CORE_TARGET_AVX2 static int overlap_bits_avx2(Box_Pointers boxes,std::size_t i,const Box& box) noexcept {
+		__m256 overlaps = _mm256_and_ps(_mm256_cmp_ps(_mm256_loadu_ps(boxes.max_x + i),_mm256_set1_ps(box.min_x),_CMP_GT_OQ),_mm256_cmp_ps(_mm256_loadu_ps(boxes.min_x + i),_mm256_set1_ps(box.max_x),_CMP_LT_OQ));
+		overlaps = _mm256_and_ps(overlaps,_mm256_cmp_ps(_mm256_loadu_ps(boxes.max_y + i),_mm256_set1_ps(box.min_y),_CMP_GT_OQ));
+		overlaps = _mm256_and_ps(overlaps,_mm256_cmp_ps(_mm256_loadu_ps(boxes.min_y + i),_mm256_set1_ps(box.max_y),_CMP_LT_OQ));
+		return _mm256_movemask_ps(overlaps);
+	}
+
+	//Directions index a table of four values repeated in both halves of the register.
+	CORE_TARGET_AVX2 static __m256 direction_table_avx2(float v0,float v1,float v2,float v3) noexcept {
+		return _mm256_setr_ps(v0,v1,v2,v3,v0,v1,v2,v3);
+	}
+
+	CORE_TARGET_AVX2 static void advance_positions_avx2(float* x,float* y,const std::uint8_t* dir,std::size_t count,float distance) noexcept {
+		const __m256 step = _mm256_set1_ps(distance);
+		std::size_t i = 0;
+		for(;i + 8 <= count;i += 8) {
+			__m256i d = core::load_directions_avx2(dir + i);
+			__m256 dx = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_cmpeq_epi32(d,_mm256_set1_epi32(2)),_mm256_cmpeq_epi32(d,_mm256_setzero_si256())));
+			__m256 dy = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_cmpeq_epi32(d,_mm256_set1_epi32(3)),_mm256_cmpeq_epi32(d,_mm256_set1_epi32(1))));
+			_mm256_storeu_ps(x + i,_mm256_add_ps(_mm256_loadu_ps(x + i),_mm256_mul_ps(dx,step)));
+			_mm256_storeu_ps(y + i,_mm256_add_ps(_mm256_loadu_ps(y + i),_mm256_mul_ps(dy,step)));
+		}
+		core::advance_positions_scalar(x + i,y + i,dir + i,count - i,distance);
+	}
+
+	CORE_TARGET_AVX2 static void build_boxes_avx2(const float* x,const float* y,const std::uint8_t* dir,std::size_t count,const Rect* center_boxes,float* min_x,float* min_y,float* max_x,float* max_y) noexcept {
+		const __m256 offset_x = core::direction_table_avx2(center_boxes[0].x,center_boxes[1].x,center_boxes[2].x,center_boxes[3].x);
+		const __m256 offset_y = core::direction_table_avx2(center_boxes[0].y,center_boxes[1].y,center_boxes[2].y,center_boxes[3].y);
+		const __m256 width = core::direction_table_avx2(center_boxes[0].width,center_boxes[1].width,center_boxes[2].width,center_boxes[3].width);
+		const __m256 height = core::direction_table_avx2(center_boxes[0].height,center_boxes[1].height,center_boxes[2].height,center_boxes[3].height);
+		std::size_t i = 0;
+		for(;i + 8 <= count;i += 8) {
+			__m256i d = core::load_directions_avx2(dir + i);
+			__m256 box_min_x = _mm256_add_ps(_mm256_loadu_ps(x + i),_mm256_permutevar8x32_ps(offset_x,d));
+			__m256 box_min_y = _mm256_add_ps(_mm256_loadu_ps(y + i),_mm256_permutevar8x32_ps(offset_y,d));
+			_mm256_storeu_ps(min_x + i,box_min_x);
+			_mm256_storeu_ps(min_y + i,box_min_y);
+			_mm256_storeu_ps(max_x + i,_mm256_add_ps(box_min_x,_mm256_permutevar8x32_ps(width,d)));
+			_mm256_storeu_ps(max_y + i,_mm256_add_ps(box_min_y,_mm256_permutevar8x32_ps(height,d)));
+		}
+		core::build_boxes_scalar(x + i,y + i,dir + i,count - i,center_boxes,min_x + i,min_y + i,max_x + i,max_y + i);
+	}
+
+	CORE_TARGET_AVX2 static void overlap_mask_avx2(Box_Pointers boxes,std::size_t count,const Box& box,std::uint8_t* out) noexcept {
+		std::size_t i = 0;
+		for(;i + 8 <= count;i += 8) {
+			int bits = core::overlap_bits_avx2(boxes,i,box);
+			for(std::size_t j = 0;j < 8;j += 1) out[i + j] = std::uint8_t((bits >> j) & 1);
+		}
+		core::overlap_mask_scalar({boxes.min_x + i,boxes.min_y + i,boxes.max_x + i,boxes.max_y + i},count - i,box,out + i);
+	}
+
+	CORE_TARGET_AVX2 static std::size_t first_overlap_avx2(Box_Pointers boxes,std::size_t count,const Box& box) noexcept {
+		std::size_t i = 0;
+		for(;i + 8 <= count;i += 8) {
+			int bits = core::overlap_bits_avx2(boxes,i,box);
+			if(bits != 0) return i + std::size_t(std::countr_zero(unsigned(bits)));
+		}
+		return i + core::first_overlap_scalar({boxes.min_x + i,boxes.min_y + i,boxes.max_x + i,boxes.max_y + i},count - i,box);
+	}
+#endif
+
+	struct Entity_Kernel_Table {
+		void(*advance_positions)(float*,float*,const std::uint8_t*,std::size_t,float) noexcept;
+		void(*build_boxes)(const float*,const float*,const std::uint8_t*,std::size_t,const Rect*,float*,float*,float*,float*) noexcept;
+		void(*overlap_mask)(Box_Pointers,std::size_t,const Box&,std::uint8_t*) noexcept;
+		std::size_t(*first_overlap)(Box_Pointers,std::size_t,const Box&) noexcept;
+	};
+	[[nodiscard]] static const Entity_Kernel_Table& entity_kernel_table() noexcept {
+		static const Entity_Kernel_Table table = []() -> Entity_Kernel_Table {
+#if defined(CORE_X86)
+			if(core::cpu_supports_avx2()) return {&core::advance_positions_avx2,&core::build_boxes_avx2,&core::overlap_mask_avx2,&core::first_overlap_avx2};
+#endif
+#if defined(CORE_SSE2)
+			return {&core::advance_positions_sse2,&core::build_boxes_sse2,&core::overlap_mask_sse2,&core::first_overlap_sse2};
+#else
+			return {&core::advance_positions_scalar,&core::build_boxes_scalar,&core::overlap_mask_scalar,&core::first_overlap_scalar};
+#endif
+		}();
+		return table;
+	}
+
+	[[nodiscard]] static Box_Pointers box_pointers(const Box_Array& boxes) noexcept {
+		return {boxes.min_x.data(),boxes.min_y.data(),boxes.max_x.data(),boxes.max_y.data()};
+	}
+
+	void advance_positions(float* x,float* y,const std::uint8_t* dir,std::size_t count,float distance) {
+		core::entity_kernel_table().advance_positions(x,y,dir,count,distance);
+	}
+
+	void build_boxes(const float* x,const float* y,const std::uint8_t* dir,std::size_t count,const Rect* center_boxes,Box_Array* out) {
+		out->resize(count);
+		core::entity_kernel_table().build_boxes(x,y,dir,count,center_boxes,out->min_x.data(),out->min_y.data(),out->max_x.data(),out->max_y.data());
+	}
+
+	void overlap_mask(const Box_Array& boxes,const Box& box,std::uint8_t* out) {
+		core::entity_kernel_table().overlap_mask(core::box_pointers(boxes),boxes.size(),box,out);
+	}
+
+	std::size_t first_overlap(const Box_Array& boxes,const Box& box) {
+		return core::entity_kernel_table().first_overlap(core::box_pointers(boxes),boxes.size(),box);
+	}
+
+	//Coordinates on a quarter tile grid, so boxes often share edges and the strict comparisons get exercised.
+	[[nodiscard]] static float random_coordinate(Random_Stream* random) noexcept {
+		return float(std::int32_t(random->next_below(64)) - 32) * 0.25f;
+	}
+
+	bool check_entity_kernels(std::string* out_report) {
+		//Counts cover every tail length of both vector widths as well as long runs.
+		std::vector<std::size_t> counts;
+		for(std::size_t count = 0;count <= 33;count += 1) counts.push_back(count);
+		counts.insert(counts.end(),{255,256,1000,1003});
+		struct Kernel_Variant {
+			const char* name;
+			bool supported;
+			Entity_Kernel_Table table;
+		};
+		//Builds without SIMD only have the scalar version, so there is nothing to compare.
+		const Kernel_Variant variants[] = {
+#if defined(CORE_SSE2)
+			{"sse2",true,{&core::advance_positions_sse2,&core::build_boxes_sse2,&core::overlap_mask_sse2,&core::first_overlap_sse2}},
+#endif
+#if defined(CORE_X86)
+			{"avx2",core::cpu_supports_avx2(),{&core::advance_positions_avx2,&core::build_boxes_avx2,&core::overlap_mask_avx2,&core::first_overlap_avx2}},
+#endif
+		};
+
+		bool passed = true;
+		std::string report = "kernel,variant,cases,mismatches\n";
+		for(const auto& [variant,supported,table] : variants) {
+			if(!supported) continue;
+			std::size_t mismatches[4] = {};
+			std::size_t case_count = 0;
+			Random_Stream random{{0,0},0,0};
+			for(auto count : counts) {
+				for(std::uint32_t repetition = 0;repetition < 8;repetition += 1) {
+					case_count += 1;
+					//Inputs start one element into their buffers, so no variant can rely on aligned loads.
+					std::vector<float> x(count + 1),y(count + 1);
+					std::vector<std::uint8_t> dir(count + 1);
+					for(std::size_t i = 0;i <= count;i += 1) {
+						x[i] = core::random_coordinate(&random);
+						y[i] = core::random_coordinate(&random);
+						//All byte values, the kernels only look at the lowest two bits.
+						dir[i] = std::uint8_t(random.next_below(256));
+					}
+					float distance = random.next_float() * 2.0f;
+					Rect center_boxes[4] = {};
+					for(auto& box : center_boxes) box = {core::random_coordinate(&random) / 16.0f,core::random_coordinate(&random) / 16.0f,float(random.next_below(16)) * 0.25f,float(random.next_below(16)) * 0.25f};
+					Box box = {core::random_coordinate(&random),core::random_coordinate(&random),0.0f,0.0f};
+					box.max_x = box.min_x + float(random.next_below(64)) * 0.25f;
+					box.max_y = box.min_y + float(random.next_below(64)) * 0.25f;
+
+					auto expected_x = x,expected_y = y;
+					core::advance_positions_scalar(expected_x.data() + 1,expected_y.data() + 1,dir.data() + 1,count,distance);
+					table.advance_positions(x.data() + 1,y.data() + 1,dir.data() + 1,count,distance);
+					if(std::memcmp(x.data(),expected_x.data(),x.size() * sizeof(float)) != 0 || std::memcmp(y.data(),expected_y.data(),y.size() * sizeof(float)) != 0) mismatches[0] += 1;
+
+					std::vector<float> expected_boxes(4 * count),boxes(4 * count);
+					float* expected_rows[4] = {};
+					float* rows[4] = {};
+					for(std::size_t i = 0;i < 4;i += 1) {
+						expected_rows[i] = expected_boxes.data() + i * count;
+						rows[i] = boxes.data() + i * count;
+					}
+					core::build_boxes_scalar(x.data() + 1,y.data() + 1,dir.data() + 1,count,center_boxes,expected_rows[0],expected_rows[1],expected_rows[2],expected_rows[3]);
+					table.build_boxes(x.data() + 1,y.data() + 1,dir.data() + 1,count,center_boxes,rows[0],rows[1],rows[2],rows[3]);
+					if(!boxes.empty() && std::memcmp(boxes.data(),expected_boxes.data(),boxes.size() * sizeof(float)) != 0) mismatches[1] += 1;
+
+					Box_Pointers pointers = {expected_rows[0],expected_rows[1],expected_rows[2],expected_rows[3]};
+					//Half of the cases move the box against one edge of a random entity, which only counts as an overlap if the comparisons are strict.
+					if(count > 0 && random.next_below(2) == 0) {
+						auto touched = random.next_below(std::uint32_t(count));
+						auto width = box.max_x - box.min_x;
+						auto height = box.max_y - box.min_y;
+						switch(random.next_below(4)) {
+							case 0: { box.min_x = pointers.max_x[touched]; box.max_x = box.min_x + width; break; }
+							case 1: { box.max_x = pointers.min_x[touched]; box.min_x = box.max_x - width; break; }
+							case 2: { box.min_y = pointers.max_y[touched]; box.max_y = box.min_y + height; break; }
+							case 3: { box.max_y = pointers.min_y[touched]; box.min_y = box.max_y - height; break; }
+						}
+					}
+					std::vector<std::uint8_t> expected_mask(count),mask(count);
+					core::overlap_mask_scalar(pointers,count,box,expected_mask.data());
+					table.overlap_mask(pointers,count,box,mask.data());
+					if(mask != expected_mask) mismatches[2] += 1;
+
+					if(table.first_overlap(pointers,count,box) != core::first_overlap_scalar(pointers,count,box)) mismatches[3] += 1;
+				}
+			}
+
+			const char* kernels[] = {"advance_positions","build_boxes","overlap_mask","first_overlap"};
+			for(std::size_t i = 0;i < 4;i += 1) {
+				char buffer[256] = {};
+				int length = std::snprintf(buffer,sizeof(buffer) - 1,"%s,%s,%zu,%zu\n",kernels[i],variant,case_count,mismatches[i]);
+				if(length < 0) throw Runtime_Exception("Couldn't create the entity kernel report.");
+				report += buffer;
+				passed = passed && mismatches[i] == 0;
+			}
+		}
+		*out_report = report;
+		return passed;
+	}
+}
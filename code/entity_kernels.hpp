@@ -0,0 +1,52 @@
+#ifndef ENTITY_KERNELS_HPP
+#define ENTITY_KERNELS_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include "math.hpp"
+
+namespace core {
+	/*	Passes over many entities stored as structure of arrays. Every kernel has a scalar reference version and SSE2 and AVX2 versions picked at runtime,
+		which do the same float operations in the same order and so give bit-identical results, checked by 'check_entity_kernels'.
+		Directions are numbered like 'Entity_Direction': right, down, left, up. */
+	struct Box {
+		float min_x;
+		float min_y;
+		float max_x;
+		float max_y;
+	};
+	[[nodiscard]] inline Box box_from_rect(const Rect& rect) noexcept {
+		return {rect.x,rect.y,rect.x + rect.width,rect.y + rect.height};
+	}
+
+	//Usually scratch space, so it can live in a frame arena.
+	struct Box_Array {
+		std::pmr::vector<float> min_x;
+		std::pmr::vector<float> min_y;
+		std::pmr::vector<float> max_x;
+		std::pmr::vector<float> max_y;
+
+		explicit Box_Array(std::pmr::memory_resource* memory = std::pmr::get_default_resource()) : min_x(memory),min_y(memory),max_x(memory),max_y(memory) {}
+
+		void resize(std::size_t count);
+		[[nodiscard]] std::size_t size() const noexcept { return min_x.size(); }
+		[[nodiscard]] Box operator[](std::size_t index) const noexcept { return {min_x[index],min_y[index],max_x[index],max_y[index]}; }
+	};
+
+	//Moves every entity 'distance' along its direction.
+	void advance_positions(float* x,float* y,const std::uint8_t* dir,std::size_t count,float distance);
+	//Boxes of entities whose box depends on their direction. 'center_boxes' holds one box per direction, relative to the position of the entity.
+	void build_boxes(const float* x,const float* y,const std::uint8_t* dir,std::size_t count,const Rect* center_boxes,Box_Array* out);
+	//Sets 'out[i]' to 1 if box 'i' overlaps 'box' and to 0 otherwise. Touching edges don't count, like in 'Rect::overlaps'.
+	void overlap_mask(const Box_Array& boxes,const Box& box,std::uint8_t* out);
+	//Index of the first box overlapping 'box', or the number of boxes if there is none.
+	[[nodiscard]] std::size_t first_overlap(const Box_Array& boxes,const Box& box);
+	//Runs every kernel variant the CPU supports on random inputs and compares it with the scalar version bit for bit.
+	//'out_report' gets the number of mismatching cases per kernel and variant as CSV. Returns false if there was any.
+	[[nodiscard]] bool check_entity_kernels(std::string* out_report);
+}
+
+#endif
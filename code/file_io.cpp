@@ -0,0 +1,360 @@
+#include <memory>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <system_error>
+#include "defer.hpp"
+#include "file_io.hpp"
+#include "exceptions.hpp"
+
+#if defined(__linux__)
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/uio.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <linux/io_uring.h>
+#endif
+
+namespace core {
+	void throw_file_completion_error(const File_Completion& completion) {
+		//Exceptions only store pointers, so the path has to outlive the completion.
+		static char static_file_path[2048];
+		std::strncpy(static_file_path,completion.file_path.c_str(),sizeof(static_file_path) - 1);
+		switch(completion.error) {
+			case File_Completion::Error::Open: throw File_Open_Exception(static_file_path);
+			case File_Completion::Error::Read: throw File_Read_Exception(static_file_path,completion.data.size());
+			case File_Completion::Error::Write: throw File_Exception(static_file_path,"Couldn't write the whole file");
+			case File_Completion::Error::Processing: throw File_Exception(static_file_path,"Invalid file contents");
+			default: throw Runtime_Exception("'throw_file_completion_error' called for a successful request.");
+		}
+	}
+
+#if defined(__linux__)
+	//Files are split into chunks the kernel works on at the same time, at most 'Io_Uring_Entry_Count' of them per worker.
+	//Rings only ever hold the chunks of one file, requests for different files overlap through the worker threads instead.
+	static constexpr unsigned Io_Uring_Entry_Count = 8;
+	static constexpr std::size_t Io_Uring_Chunk_Size = 256 * 1024;
+
+	/*	A minimal io_uring driven through the raw system calls, so liburing isn't needed. Every worker thread owns one, rings are never shared.
+		Kernels without io_uring, or with it blocked (e.g. by the seccomp profile of a container), leave it invalid and files go through streams. */
+	class Io_Uring {
+	public:
+		Io_Uring() noexcept;
+		Io_Uring(const Io_Uring&) = delete;
+		Io_Uring& operator=(const Io_Uring&) = delete;
+		~Io_Uring() { destroy(); }
+		[[nodiscard]] bool valid() const noexcept { return ring_fd >= 0; }
+		//Reads or writes the first 'byte_count' bytes of the file. Short transfers are continued, returns false if any chunk failed.
+		[[nodiscard]] bool transfer(int file_fd,void* bytes,std::size_t byte_count,bool write) noexcept;
+	private:
+		struct Chunk {
+			iovec buffer;
+			std::uint64_t offset;
+		};
+		void destroy() noexcept;
+
+		int ring_fd;
+		void* sq_ring;
+		std::size_t sq_ring_size;
+		void* cq_ring;
+		std::size_t cq_ring_size;
+		io_uring_sqe* sqes;
+		std::size_t sqes_size;
+		unsigned* sq_tail;
+		unsigned* sq_mask;
+		unsigned* sq_array;
+		unsigned* cq_head;
+		unsigned* cq_tail;
+		unsigned* cq_mask;
+		io_uring_cqe* cqes;
+		//Indexed by the 'user_data' of the submission, the buffers have to stay put until the kernel is done with them.
+		Chunk chunks[Io_Uring_Entry_Count];
+	};
+
+	Io_Uring::Io_Uring() noexcept : ring_fd(-1),sq_ring(MAP_FAILED),sq_ring_size(),cq_ring(MAP_FAILED),cq_ring_size(),sqes(static_cast<io_uring_sqe*>(MAP_FAILED)),sqes_size(),
+									sq_tail(),sq_mask(),sq_array(),cq_head(),cq_tail(),cq_mask(),cqes(),chunks() {
+		io_uring_params params{};
+		int fd = int(syscall(__NR_io_uring_setup,Io_Uring_Entry_Count,&params));
+		if(fd < 0) return;
+		sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+		sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+		sq_ring = mmap(nullptr,sq_ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_SQ_RING);
+		cq_ring = mmap(nullptr,cq_ring_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_CQ_RING);
+		sqes = static_cast<io_uring_sqe*>(mmap(nullptr,sqes_size,PROT_READ | PROT_WRITE,MAP_SHARED | MAP_POPULATE,fd,IORING_OFF_SQES));
+		ring_fd = fd;
+		if(sq_ring == MAP_FAILED || cq_ring == MAP_FAILED || sqes == MAP_FAILED) {
+			destroy();
+			return;
+		}
+		auto* sq_bytes = static_cast<std::uint8_t*>(sq_ring);
+		auto* cq_bytes = static_cast<std::uint8_t*>(cq_ring);
+		sq_tail = reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.tail);
+		sq_mask = reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.ring_mask);
+		sq_array = reinterpret_cast<unsigned*>(sq_bytes + params.sq_off.array);
+		cq_head = reinterpret_cast<unsigned*>(cq_bytes + params.cq_off.head);
+		cq_tail = reinterpret_cast<unsigned*>(cq_bytes + params.cq_off.tail);
+		cq_mask = reinterpret_cast<unsigned*>(cq_bytes + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<io_uring_cqe*>(cq_bytes + params.cq_off.cqes);
+	}
+
+	void Io_Uring::destroy() noexcept {
+		if(sq_ring != MAP_FAILED) munmap(sq_ring,sq_ring_size);
+		if(cq_ring != MAP_FAILED) munmap(cq_ring,cq_ring_size);
+		if(sqes != MAP_FAILED) munmap(sqes,sqes_size);
+		if(ring_fd >= 0) close(ring_fd);
+		sq_ring = MAP_FAILED;
+		cq_ring = MAP_FAILED;
+		sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+		ring_fd = -1;
+	}
+
+	bool Io_Uring::transfer(int file_fd,void* bytes,std::size_t byte_count,bool write) noexcept {
+		unsigned free_slots[Io_Uring_Entry_Count] = {};
+		unsigned free_slot_count = Io_Uring_Entry_Count;
+		for(unsigned i = 0;i < Io_Uring_Entry_Count;i += 1) free_slots[i] = i;
+		//Chunks that were cut short or interrupted are queued again before new ones.
+		unsigned retry_slots[Io_Uring_Entry_Count] = {};
+		unsigned retry_slot_count = 0;
+
+		std::size_t next_offset = 0;
+		unsigned in_flight = 0;
+		unsigned unsubmitted = 0;
+		bool failed = false;
+		for(;;) {
+			//Only this thread writes the tail of the submission queue, the release store publishes the entries to the kernel.
+			unsigned tail = *sq_tail;
+			auto queue = [&](unsigned slot) {
+				io_uring_sqe& sqe = sqes[tail & *sq_mask];
+				sqe = {};
+				sqe.opcode = std::uint8_t(write ? IORING_OP_WRITEV : IORING_OP_READV);
+				sqe.fd = file_fd;
+				sqe.addr = std::uint64_t(reinterpret_cast<std::uintptr_t>(&chunks[slot].buffer));
+				sqe.len = 1;
+				sqe.off = chunks[slot].offset;
+				sqe.user_data = slot;
+				sq_array[tail & *sq_mask] = tail & *sq_mask;
+				tail += 1;
+				unsubmitted += 1;
+				in_flight += 1;
+			};
+			if(!failed) {
+				while(retry_slot_count > 0) queue(retry_slots[--retry_slot_count]);
+				while(free_slot_count > 0 && next_offset < byte_count) {
+					unsigned slot = free_slots[--free_slot_count];
+					std::size_t length = std::min(Io_Uring_Chunk_Size,byte_count - next_offset);
+					chunks[slot] = {{static_cast<std::uint8_t*>(bytes) + next_offset,length},next_offset};
+					next_offset += length;
+					queue(slot);
+				}
+			}
+			__atomic_store_n(sq_tail,tail,__ATOMIC_RELEASE);
+			if(in_flight == 0) return !failed;
+
+			//Submits whatever is queued and sleeps until at least one chunk is done.
+			long result = syscall(__NR_io_uring_enter,ring_fd,unsubmitted,1,IORING_ENTER_GETEVENTS,nullptr,0);
+			if(result < 0) {
+				if(errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+				//The ring is in an unknown state, closing it cancels what the kernel still holds. Later requests use streams.
+				destroy();
+				return false;
+			}
+			unsubmitted -= unsigned(result);
+
+			unsigned head = *cq_head;
+			unsigned completed_tail = __atomic_load_n(cq_tail,__ATOMIC_ACQUIRE);
+			for(;head != completed_tail;head += 1) {
+				const io_uring_cqe& cqe = cqes[head & *cq_mask];
+				auto slot = unsigned(cqe.user_data);
+				Chunk& chunk = chunks[slot];
+				in_flight -= 1;
+				if(cqe.res == -EINTR || cqe.res == -EAGAIN) {
+					retry_slots[retry_slot_count++] = slot;
+					continue;
+				}
+				//Reading nothing means the file got shorter since its size was queried.
+				if(cqe.res <= 0) {
+					failed = true;
+					free_slots[free_slot_count++] = slot;
+					continue;
+				}
+				auto transferred = std::size_t(cqe.res);
+				if(transferred < chunk.buffer.iov_len) {
+					chunk.buffer.iov_base = static_cast<std::uint8_t*>(chunk.buffer.iov_base) + transferred;
+					chunk.buffer.iov_len -= transferred;
+					chunk.offset += transferred;
+					retry_slots[retry_slot_count++] = slot;
+					continue;
+				}
+				free_slots[free_slot_count++] = slot;
+			}
+			__atomic_store_n(cq_head,head,__ATOMIC_RELEASE);
+		}
+	}
+
+	[[nodiscard]] static Io_Uring& worker_io_uring() {
+		static thread_local Io_Uring ring{};
+		return ring;
+	}
+#endif
+
+	[[nodiscard]] static File_Completion::Error read_file_contents(const std::string& file_path,std::vector<std::uint8_t>* data) {
+#if defined(__linux__)
+		if(auto& ring = core::worker_io_uring();ring.valid()) {
+			int fd = open(file_path.c_str(),O_RDONLY | O_CLOEXEC);
+			if(fd < 0) return File_Completion::Error::Open;
+			defer[&]{ close(fd); };
+			struct stat status{};
+			if(fstat(fd,&status) != 0) return File_Completion::Error::Read;
+			data->resize(std::size_t(status.st_size));
+			return ring.transfer(fd,data->data(),data->size(),false) ? File_Completion::Error::None : File_Completion::Error::Read;
+		}
+#endif
+		std::ifstream file{file_path,std::ios::binary};
+		if(!file.is_open()) return File_Completion::Error::Open;
+		std::error_code error_code{};
+		auto file_size = std::filesystem::file_size(file_path,error_code);
+		if(error_code) return File_Completion::Error::Read;
+		//The whole file is read with a single request.
+		data->resize(std::size_t(file_size));
+		if(!file.read(reinterpret_cast<char*>(data->data()),std::streamsize(file_size))) return File_Completion::Error::Read;
+		return File_Completion::Error::None;
+	}
+
+	[[nodiscard]] static File_Completion::Error write_file_contents(const std::string& file_path,std::vector<std::uint8_t>& bytes) {
+#if defined(__linux__)
+		if(auto& ring = core::worker_io_uring();ring.valid()) {
+			int fd = open(file_path.c_str(),O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,0644);
+			if(fd < 0) return File_Completion::Error::Open;
+			bool written = ring.transfer(fd,bytes.data(),bytes.size(),true);
+			if(close(fd) != 0) written = false;
+			return written ? File_Completion::Error::None : File_Completion::Error::Write;
+		}
+#endif
+		std::ofstream file{file_path,std::ios::binary | std::ios::trunc};
+		if(!file.is_open()) return File_Completion::Error::Open;
+		if(!file.write(reinterpret_cast<const char*>(bytes.data()),std::streamsize(bytes.size())) || !file.flush()) return File_Completion::Error::Write;
+		return File_Completion::Error::None;
+	}
+
+	std::string normalized_file_path(const char* file_path) {
+		std::error_code error_code{};
+		auto path = std::filesystem::absolute(file_path,error_code);
+		if(error_code) path = file_path;
+		return path.lexically_normal().string();
+	}
+
+	Async_File_Io::Async_File_Io(std::size_t queue_depth) : mutex(),completion_available(),completions(),handlers(),next_request_id(1),workers(queue_depth) {}
+
+	File_Request_Id Async_File_Io::submit_read(const char* file_path,Completion_Handler handler,Processing_Step processing_step) {
+		File_Request_Id id = next_request_id++;
+		handlers.emplace(id,std::move(handler));
+		workers.submit([this,id,path = std::string(file_path),processing_step = std::move(processing_step)]() mutable {
+			File_Completion completion{id,File_Completion::Type::Read,File_Completion::Error::None,std::move(path),{}};
+			completion.error = core::read_file_contents(completion.file_path,&completion.data);
+			if(completion.succeeded() && processing_step) {
+				try {
+					processing_step(completion);
+				}
+				catch(...) {
+					completion.error = File_Completion::Error::Processing;
+				}
+			}
+			push_completion(std::move(completion));
+		});
+		return id;
+	}
+
+	File_Request_Id Async_File_Io::submit_write(const char* file_path,std::vector<std::uint8_t> bytes,Completion_Handler handler) {
+		auto shared_bytes = std::make_shared<std::vector<std::uint8_t>>(std::move(bytes));
+		return submit_write(file_path,[shared_bytes]{ return std::move(*shared_bytes); },std::move(handler));
+	}
+
+	File_Request_Id Async_File_Io::submit_write(const char* file_path,Byte_Producer producer,Completion_Handler handler) {
+		File_Request_Id id = next_request_id++;
+		handlers.emplace(id,std::move(handler));
+		workers.submit([this,id,path = std::string(file_path),producer = std::move(producer)]() mutable {
+			File_Completion completion{id,File_Completion::Type::Write,File_Completion::Error::None,std::move(path),{}};
+			std::vector<std::uint8_t> bytes{};
+			try {
+				bytes = producer();
+			}
+			catch(...) {
+				completion.error = File_Completion::Error::Processing;
+				push_completion(std::move(completion));
+				return;
+			}
+
+			auto temporary_path = completion.file_path + ".tmp";
+			completion.error = core::write_file_contents(temporary_path,bytes);
+			std::error_code error_code{};
+			if(completion.succeeded()) {
+				std::filesystem::rename(temporary_path,completion.file_path,error_code);
+				if(error_code) completion.error = File_Completion::Error::Write;
+			}
+			if(!completion.succeeded()) std::filesystem::remove(temporary_path,error_code);
+			push_completion(std::move(completion));
+		});
+		return id;
+	}
+
+	std::size_t Async_File_Io::dispatch_completions() {
+		std::vector<File_Completion> finished{};
+		{
+			std::lock_guard lock{mutex};
+			finished.swap(completions);
+		}
+		for(std::size_t i = 0;i < finished.size();i += 1) {
+			auto iterator = handlers.find(finished[i].id);
+			if(iterator == handlers.end()) continue;
+			auto handler = std::move(iterator->second);
+			handlers.erase(iterator);
+			try {
+				if(handler) handler(finished[i]);
+			}
+			catch(...) {
+				//Completions that weren't dispatched yet are put back so that the caller can still handle them after catching the exception.
+				std::lock_guard lock{mutex};
+				completions.insert(completions.begin(),std::make_move_iterator(finished.begin() + std::ptrdiff_t(i) + 1),std::make_move_iterator(finished.end()));
+				throw;
+			}
+		}
+		return finished.size();
+	}
+
+	void Async_File_Io::wait(File_Request_Id id) {
+		while(handlers.contains(id)) {
+			{
+				std::unique_lock lock{mutex};
+				completion_available.wait(lock,[this]{ return !completions.empty(); });
+			}
+			dispatch_completions();
+		}
+	}
+
+	void Async_File_Io::wait_all() {
+		while(!handlers.empty()) {
+			{
+				std::unique_lock lock{mutex};
+				completion_available.wait(lock,[this]{ return !completions.empty(); });
+			}
+			dispatch_completions();
+		}
+	}
+
+	std::size_t Async_File_Io::pending_count() const noexcept {
+		return handlers.size();
+	}
+
+	void Async_File_Io::push_completion(File_Completion&& completion) {
+		{
+			std::lock_guard lock{mutex};
+			completions.push_back(std::move(completion));
+		}
+		completion_available.notify_all();
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef FILE_IO_HPP
+#define FILE_IO_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+#include "thread_pool.hpp"
+
+namespace core {
+	using File_Request_Id = std::uint64_t;
+
+	struct File_Completion {
+		enum class Type { Read,Write };
+		enum class Error { None,Open,Read,Write,Processing };
+		File_Request_Id id;
+		Type type;
+		Error error;
+		std::string file_path;
+		//Whole file contents for reads, empty for writes.
+		std::vector<std::uint8_t> data;
+		[[nodiscard]] bool succeeded() const noexcept { return error == Error::None; }
+	};
+	//Converts a failed completion into the same exception types that synchronous file code throws.
+	[[noreturn]] void throw_file_completion_error(const File_Completion& completion);
+	//Absolute and lexically normal, so the same file gets the same key however its path was written.
+	[[nodiscard]] std::string normalized_file_path(const char* file_path);
+
+	/*	All file access of the game goes through this class so that loads never block the thread that requested them.
+		Requests are executed by 'queue_depth' worker threads, so at most that many files are being read or written at the same time.
+		That pool is the only thing overlapping separate requests, each worker still transfers one file at a time and waits for it.
+		On Linux a worker hands its file to its own io_uring, which only helps files larger than one 256 KiB chunk: their chunks are transferred concurrently.
+		Smaller files, which are all the assets of the game, become a single submission followed by a wait, the same as a 'read' on the worker.
+		Elsewhere, or when io_uring is unavailable, workers use streams.
+		Completions are queued and their handlers only run inside 'dispatch_completions' or 'wait', which lets the game loop pick them up between frames. */
+	class Async_File_Io {
+	public:
+		using Completion_Handler = std::function<void(File_Completion& completion)>;
+		//Runs on the worker thread right after a successful read, e.g. to parse the file without stalling the game loop.
+		//If it throws, the completion is reported with 'File_Completion::Error::Processing'.
+		using Processing_Step = std::function<void(File_Completion& completion)>;
+		//Produces the bytes of a write on the worker thread, so expensive encoding doesn't happen on the game loop either.
+		using Byte_Producer = std::function<std::vector<std::uint8_t>()>;
+		static inline constexpr std::size_t Default_Queue_Depth = 4;
+
+		explicit Async_File_Io(std::size_t queue_depth = Default_Queue_Depth);
+		Async_File_Io(const Async_File_Io&) = delete;
+		Async_File_Io& operator=(const Async_File_Io&) = delete;
+
+		File_Request_Id submit_read(const char* file_path,Completion_Handler handler,Processing_Step processing_step = {});
+		//Writes go to a temporary file that is renamed over the destination once complete, so readers never observe a half-written file.
+		File_Request_Id submit_write(const char* file_path,std::vector<std::uint8_t> bytes,Completion_Handler handler);
+		File_Request_Id submit_write(const char* file_path,Byte_Producer producer,Completion_Handler handler);
+		//Runs handlers of every finished request on the calling thread and returns how many were run.
+		std::size_t dispatch_completions();
+		//Blocks until the given request finishes. Other completions that arrive in the meantime are dispatched as well.
+		void wait(File_Request_Id id);
+		void wait_all();
+		[[nodiscard]] std::size_t pending_count() const noexcept;
+	private:
+		void push_completion(File_Completion&& completion);
+
+		mutable std::mutex mutex;
+		std::condition_variable completion_available;
+		std::vector<File_Completion> completions;
+		std::unordered_map<File_Request_Id,Completion_Handler> handlers;
+		File_Request_Id next_request_id;
+		//Declared last so the workers are joined before anything they touch is destroyed.
+		Thread_Pool workers;
+	};
+}
+
+#endif
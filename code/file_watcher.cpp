@@ -0,0 +1,102 @@
+#include <algorithm>
+#include "file_io.hpp"
+#include "file_watcher.hpp"
+
+#if defined(__linux__)
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/inotify.h>
+#endif
+
+namespace core {
+	[[nodiscard]] static std::filesystem::file_time_type last_write_time_or_default(const std::string& file_path) {
+		std::error_code error_code{};
+		auto time = std::filesystem::last_write_time(file_path,error_code);
+		return error_code ? std::filesystem::file_time_type() : time;
+	}
+
+	File_Watcher::File_Watcher() : mutex(),stop_requested(),files(),changed_files(),stopping()
+#if defined(__linux__)
+		,inotify_fd(-1),watched_directories()
+#endif
+		,poll_thread() {
+#if defined(__linux__)
+		inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if(inotify_fd >= 0) return;
+#endif
+		//There is no change notification mechanism available, so we fall back to polling.
+		poll_thread = std::thread([this]{ poll_loop(); });
+	}
+
+	File_Watcher::~File_Watcher() {
+		{
+			std::lock_guard lock{mutex};
+			stopping = true;
+		}
+		stop_requested.notify_all();
+		if(poll_thread.joinable()) poll_thread.join();
+#if defined(__linux__)
+		if(inotify_fd >= 0) close(inotify_fd);
+#endif
+	}
+
+	void File_Watcher::watch(const char* file_path) {
+		auto key = core::normalized_file_path(file_path);
+		std::lock_guard lock{mutex};
+		if(files.contains(key)) return;
+		files.emplace(key,Watched_File{file_path,core::last_write_time_or_default(key)});
+#if defined(__linux__)
+		if(inotify_fd >= 0) {
+			//Editors often save by writing a temporary file and renaming it, so the directory is watched instead of the file itself.
+			auto directory = std::filesystem::path(key).parent_path().string();
+			int descriptor = inotify_add_watch(inotify_fd,directory.c_str(),IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+			if(descriptor >= 0) watched_directories[descriptor] = directory;
+		}
+#endif
+	}
+
+	std::vector<std::string> File_Watcher::take_changed_files() {
+#if defined(__linux__)
+		if(inotify_fd >= 0) {
+			alignas(inotify_event) char buffer[4096];
+			for(;;) {
+				auto byte_count = read(inotify_fd,buffer,sizeof(buffer));
+				if(byte_count <= 0) break;
+				for(std::size_t offset = 0;offset < std::size_t(byte_count);) {
+					const auto* event = reinterpret_cast<const inotify_event*>(&buffer[offset]);
+					offset += sizeof(inotify_event) + event->len;
+					if(event->len == 0) continue;
+
+					std::lock_guard lock{mutex};
+					auto directory = watched_directories.find(event->wd);
+					if(directory == watched_directories.end()) continue;
+					auto key = (std::filesystem::path(directory->second) / event->name).lexically_normal().string();
+					if(files.contains(key)) mark_changed(key);
+				}
+			}
+		}
+#endif
+		std::lock_guard lock{mutex};
+		std::vector<std::string> result{};
+		result.swap(changed_files);
+		return result;
+	}
+
+	void File_Watcher::poll_loop() {
+		std::unique_lock lock{mutex};
+		while(!stop_requested.wait_for(lock,Poll_Interval,[this]{ return stopping; })) {
+			for(auto& [key,file] : files) {
+				auto time = core::last_write_time_or_default(key);
+				if(time == file.last_write_time) continue;
+				file.last_write_time = time;
+				mark_changed(key);
+			}
+		}
+	}
+
+	//Expects 'mutex' to be locked.
+	void File_Watcher::mark_changed(const std::string& key) {
+		const auto& original_path = files[key].original_path;
+		if(std::find(changed_files.begin(),changed_files.end(),original_path) == changed_files.end()) changed_files.push_back(original_path);
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef FILE_WATCHER_HPP
+#define FILE_WATCHER_HPP
+
+#include <mutex>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <filesystem>
+#include <unordered_map>
+#include <condition_variable>
+
+namespace core {
+	/*	Reports files that were modified on the drive since the last call to 'take_changed_files'.
+		On Linux the kernel notifies us through inotify, elsewhere a background thread compares modification times every 'Poll_Interval'. */
+	class File_Watcher {
+	public:
+		static inline constexpr std::chrono::milliseconds Poll_Interval{250};
+
+		File_Watcher();
+		File_Watcher(const File_Watcher&) = delete;
+		File_Watcher& operator=(const File_Watcher&) = delete;
+		~File_Watcher();
+		//Watching a file that is already being watched does nothing.
+		void watch(const char* file_path);
+		//Returns paths in the same form they were passed to 'watch', each path at most once.
+		[[nodiscard]] std::vector<std::string> take_changed_files();
+	private:
+		struct Watched_File {
+			std::string original_path;
+			std::filesystem::file_time_type last_write_time;
+		};
+		void poll_loop();
+		void mark_changed(const std::string& key);
+
+		std::mutex mutex;
+		std::condition_variable stop_requested;
+		//Keys are normalized absolute paths.
+		std::unordered_map<std::string,Watched_File> files;
+		std::vector<std::string> changed_files;
+		bool stopping;
+#if defined(__linux__)
+		int inotify_fd;
+		std::unordered_map<int,std::string> watched_directories;
+#endif
+		std::thread poll_thread;
+	};
+}
+
+#endif
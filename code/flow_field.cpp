@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <functional>
+#include "flow_field.hpp"
+#include "exceptions.hpp"
+#include "memory_telemetry.hpp"
+
+namespace core {
+	Flow_Field::Flow_Field(std::uint32_t _grid_width,std::uint32_t _grid_height,std::uint32_t _footprint,Ipoint _origin) : grid_origin(),grid_width(),grid_height(),footprint(_footprint),
+		field_width(),field_height(),distances(),footprint_costs(),buckets(),lowered_cells() {
+		resize(_grid_width,_grid_height,_origin);
+		//Costs fit into a byte, so a ring of 256 buckets always separates the current distance from every distance pushed from it.
+		buckets.resize(256);
+	}
+
+	void Flow_Field::resize(std::uint32_t _grid_width,std::uint32_t _grid_height,Ipoint _origin) {
+		if(footprint == 0 || _grid_width < footprint || _grid_height < footprint) throw Runtime_Exception("Flow field grid is smaller than the agent footprint.");
+		grid_origin = _origin;
+		grid_width = _grid_width;
+		grid_height = _grid_height;
+		field_width = grid_width - footprint + 1;
+		field_height = grid_height - footprint + 1;
+		distances.assign(std::size_t(field_width) * field_height,Unreachable);
+		footprint_costs.assign(std::size_t(field_width) * field_height,Impassable);
+	}
+
+	void Flow_Field::compute(const std::vector<std::uint8_t>& cell_costs,const Ipoint* targets,std::size_t target_count) {
+		if(cell_costs.size() != std::size_t(grid_width) * grid_height) throw Runtime_Exception("Flow field cost grid has a wrong size.");
+
+		for(std::uint32_t y = 0;y < field_height;y += 1) {
+			for(std::uint32_t x = 0;x < field_width;x += 1) footprint_costs[std::size_t(y) * field_width + x] = compute_footprint_cost(cell_costs,x,y);
+		}
+
+		//Dial's algorithm, costs are small integers so buckets indexed by distance replace the priority queue of Dijkstra's algorithm.
+		std::fill(distances.begin(),distances.end(),Unreachable);
+		for(auto& bucket : buckets) bucket.clear();
+		std::size_t pending_count = 0;
+		for(std::size_t i = 0;i < target_count;i += 1) {
+			std::size_t index = 0;
+			if(!field_index(targets[i].x,targets[i].y,&index)) continue;
+			distances[index] = 0;
+			buckets[0].push_back(std::uint32_t(index));
+			pending_count += 1;
+		}
+
+		for(std::uint32_t current = 0;pending_count > 0;current += 1) {
+			auto& bucket = buckets[current % buckets.size()];
+			while(!bucket.empty()) {
+				auto index = bucket.back();
+				bucket.pop_back();
+				pending_count -= 1;
+				//Cells can be pushed several times, only the entry with the final distance is expanded.
+				if(distances[index] != current) continue;
+
+				std::uint32_t x = index % field_width;
+				std::uint32_t y = index / field_width;
+				auto relax = [&](std::uint32_t neighbour) {
+					std::uint8_t cost = footprint_costs[neighbour];
+					if(cost == Impassable) return;
+					std::uint64_t new_distance = std::uint64_t(current) + cost;
+					if(new_distance >= Unreachable || new_distance >= distances[neighbour]) return;
+					distances[neighbour] = std::uint32_t(new_distance);
+					buckets[new_distance % buckets.size()].push_back(neighbour);
+					pending_count += 1;
+				};
+				if(x + 1 < field_width) relax(index + 1);
+				if(x > 0) relax(index - 1);
+				if(y + 1 < field_height) relax(index + field_width);
+				if(y > 0) relax(index - field_width);
+			}
+		}
+	}
+
+	bool Flow_Field::lower_costs(const std::vector<std::uint8_t>& cell_costs,const Ipoint* changed_cells,std::size_t changed_count) {
+		if(cell_costs.size() != std::size_t(grid_width) * grid_height) throw Runtime_Exception("Flow field cost grid has a wrong size.");
+		auto raised = [](std::uint8_t old_cost,std::uint8_t new_cost) {
+			return new_cost != old_cost && (new_cost == Impassable || (old_cost != Impassable && new_cost > old_cost));
+		};
+
+		//Agents whose footprint covers a changed cell pay a new cost, which is checked for all of them before anything is changed.
+		auto for_each_footprint = [this,changed_cells,changed_count](auto visit) {
+			for(std::size_t i = 0;i < changed_count;i += 1) {
+				auto cell_x = changed_cells[i].x - grid_origin.x;
+				auto cell_y = changed_cells[i].y - grid_origin.y;
+				for(std::int32_t y = std::max(cell_y - std::int32_t(footprint) + 1,0);y <= std::min(cell_y,std::int32_t(field_height) - 1);y += 1) {
+					for(std::int32_t x = std::max(cell_x - std::int32_t(footprint) + 1,0);x <= std::min(cell_x,std::int32_t(field_width) - 1);x += 1) {
+						if(!visit(std::uint32_t(x),std::uint32_t(y))) return false;
+					}
+				}
+			}
+			return true;
+		};
+		bool lowered_only = for_each_footprint([&](std::uint32_t x,std::uint32_t y) {
+			return !raised(footprint_costs[std::size_t(y) * field_width + x],compute_footprint_cost(cell_costs,x,y));
+		});
+		if(!lowered_only) return false;
+
+		//Dijkstra's algorithm started from the cheaper cells, it stops where the distances don't improve anymore.
+		lowered_cells.clear();
+		auto push = [this](std::uint32_t distance,std::uint32_t index) {
+			distances[index] = distance;
+			lowered_cells.push_back({distance,index});
+			std::push_heap(lowered_cells.begin(),lowered_cells.end(),std::greater<>{});
+		};
+		auto best_entry = [this](std::uint32_t index) {
+			std::uint32_t x = index % field_width;
+			std::uint32_t y = index / field_width;
+			std::uint32_t best = Unreachable;
+			if(x + 1 < field_width) best = std::min(best,distances[index + 1]);
+			if(x > 0) best = std::min(best,distances[index - 1]);
+			if(y + 1 < field_height) best = std::min(best,distances[index + field_width]);
+			if(y > 0) best = std::min(best,distances[index - field_width]);
+			return best;
+		};
+		static_cast<void>(for_each_footprint([&](std::uint32_t x,std::uint32_t y) {
+			auto index = y * field_width + x;
+			auto cost = compute_footprint_cost(cell_costs,x,y);
+			footprint_costs[index] = cost;
+			if(cost == Impassable) return true;
+			auto neighbour_distance = best_entry(index);
+			if(neighbour_distance == Unreachable) return true;
+			std::uint64_t new_distance = std::uint64_t(neighbour_distance) + cost;
+			if(new_distance < distances[index]) push(std::uint32_t(new_distance),index);
+			return true;
+		}));
+
+		while(!lowered_cells.empty()) {
+			std::pop_heap(lowered_cells.begin(),lowered_cells.end(),std::greater<>{});
+			auto [current,index] = lowered_cells.back();
+			lowered_cells.pop_back();
+			if(distances[index] != current) continue;
+
+			std::uint32_t x = index % field_width;
+			std::uint32_t y = index / field_width;
+			auto relax = [&](std::uint32_t neighbour) {
+				std::uint8_t cost = footprint_costs[neighbour];
+				if(cost == Impassable) return;
+				std::uint64_t new_distance = std::uint64_t(current) + cost;
+				if(new_distance >= Unreachable || new_distance >= distances[neighbour]) return;
+				push(std::uint32_t(new_distance),neighbour);
+			};
+			if(x + 1 < field_width) relax(index + 1);
+			if(x > 0) relax(index - 1);
+			if(y + 1 < field_height) relax(index + field_width);
+			if(y > 0) relax(index - field_width);
+		}
+		return true;
+	}
+
+	std::size_t Flow_Field::memory_usage() const noexcept {
+		auto byte_count = core::reserved_bytes(distances) + core::reserved_bytes(footprint_costs) + core::reserved_bytes(buckets) + core::reserved_bytes(lowered_cells);
+		for(const auto& bucket : buckets) byte_count += core::reserved_bytes(bucket);
+		return byte_count;
+	}
+
+	std::uint32_t Flow_Field::distance(std::int32_t x,std::int32_t y) const noexcept {
+		std::size_t index = 0;
+		if(!field_index(x,y,&index)) return Unreachable;
+		return distances[index];
+	}
+
+	std::uint8_t Flow_Field::footprint_cost(std::int32_t x,std::int32_t y) const noexcept {
+		std::size_t index = 0;
+		if(!field_index(x,y,&index)) return Impassable;
+		return footprint_costs[index];
+	}
+
+	std::uint8_t Flow_Field::compute_footprint_cost(const std::vector<std::uint8_t>& cell_costs,std::uint32_t x,std::uint32_t y) const noexcept {
+		std::uint8_t cost = 1;
+		for(std::uint32_t dy = 0;dy < footprint;dy += 1) {
+			for(std::uint32_t dx = 0;dx < footprint;dx += 1) {
+				std::uint8_t cell_cost = cell_costs[std::size_t(y + dy) * grid_width + (x + dx)];
+				if(cell_cost == Impassable) return Impassable;
+				cost = std::max(cost,cell_cost);
+			}
+		}
+		return cost;
+	}
+
+	bool Flow_Field::field_index(std::int32_t x,std::int32_t y,std::size_t* out_index) const noexcept {
+		auto local_x = std::int64_t(x) - grid_origin.x;
+		auto local_y = std::int64_t(y) - grid_origin.y;
+		if(local_x < 0 || local_y < 0 || local_x >= std::int64_t(field_width) || local_y >= std::int64_t(field_height)) return false;
+		*out_index = std::size_t(local_y) * field_width + std::size_t(local_x);
+		return true;
+	}
+}
@@ -0,0 +1,58 @@
+#ifndef FLOW_FIELD_HPP
+#define FLOW_FIELD_HPP
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include "math.hpp"
+
+namespace core {
+	//Distance field toward a set of target cells. Computed once, it lets any number of agents find their way with a few lookups.
+	//Agents cover 'footprint' x 'footprint' grid cells and are addressed by their top-left cell. The grid may be a window of a larger map starting
+	//at 'origin', all cells are given in map coordinates and those outside of the window are out of bounds.
+	class Flow_Field {
+	public:
+		static inline constexpr std::uint8_t Impassable = 0;
+		//32 bits, a path across the largest maps is far longer than 16 bits can count.
+		static inline constexpr std::uint32_t Unreachable = std::uint32_t(-1);
+
+		Flow_Field() noexcept = default;
+		Flow_Field(std::uint32_t _grid_width,std::uint32_t _grid_height,std::uint32_t _footprint,Ipoint _origin = {});
+
+		//Moves the window, distances are lost until the next 'compute'. Keeps the memory of larger windows.
+		void resize(std::uint32_t _grid_width,std::uint32_t _grid_height,Ipoint _origin);
+		//'cell_costs' holds the cost of entering every grid cell, or 'Impassable'. An agent pays for the most expensive cell it covers.
+		//Targets get a distance of 0 even if the agent couldn't fit there, e.g. when the target is walled in.
+		void compute(const std::vector<std::uint8_t>& cell_costs,const Ipoint* targets,std::size_t target_count);
+		//Updates the distances after the costs of 'changed_cells' went down in 'cell_costs', only cells that get closer are visited.
+		//Returns false without changing anything if a cost went up, which needs 'compute'.
+		bool lower_costs(const std::vector<std::uint8_t>& cell_costs,const Ipoint* changed_cells,std::size_t changed_count);
+		//Out of bounds cells are unreachable.
+		[[nodiscard]] std::uint32_t distance(std::int32_t x,std::int32_t y) const noexcept;
+		//Out of bounds cells are impassable.
+		[[nodiscard]] std::uint8_t footprint_cost(std::int32_t x,std::int32_t y) const noexcept;
+		[[nodiscard]] std::uint32_t width() const noexcept { return field_width; }
+		[[nodiscard]] std::uint32_t height() const noexcept { return field_height; }
+		[[nodiscard]] Ipoint origin() const noexcept { return grid_origin; }
+		[[nodiscard]] std::size_t memory_usage() const noexcept;
+	private:
+		[[nodiscard]] std::uint8_t compute_footprint_cost(const std::vector<std::uint8_t>& cell_costs,std::uint32_t x,std::uint32_t y) const noexcept;
+		//Index of the field cell at map coordinates, false if it's outside of the field.
+		[[nodiscard]] bool field_index(std::int32_t x,std::int32_t y,std::size_t* out_index) const noexcept;
+
+		Ipoint grid_origin = {};
+		std::uint32_t grid_width = 0;
+		std::uint32_t grid_height = 0;
+		std::uint32_t footprint = 0;
+		std::uint32_t field_width = 0;
+		std::uint32_t field_height = 0;
+		std::vector<std::uint32_t> distances;
+		std::vector<std::uint8_t> footprint_costs;
+		//Kept between computations to avoid reallocating them.
+		std::vector<std::vector<std::uint32_t>> buckets;
+		//Binary heap of (distance, cell) for 'lower_costs', whose distances don't fit into the ring of buckets.
+		std::vector<std::pair<std::uint32_t,std::uint32_t>> lowered_cells;
+	};
+}
+
+#endif
@@ -0,0 +1,68 @@
+#include <cstdint>
+#include <algorithm>
+#include "frame_arena.hpp"
+
+namespace core {
+	//Overflow blocks are only tracked while warming up, so a few of them are enough before the list itself has to grow.
+	static constexpr std::size_t Reserved_Overflow_Block_Count = 16;
+
+	Frame_Arena::Frame_Arena(std::size_t capacity,std::pmr::memory_resource* _upstream) : upstream(_upstream),block(),block_size(std::max<std::size_t>(capacity,1)),
+		block_offset(),overflow_blocks(),used_byte_count(),peak_byte_count(),upstream_allocations() {
+		block = static_cast<unsigned char*>(upstream->allocate(block_size,alignof(std::max_align_t)));
+		upstream_allocations += 1;
+		overflow_blocks.reserve(Reserved_Overflow_Block_Count);
+	}
+
+	Frame_Arena::~Frame_Arena() {
+		for(const auto& overflow : overflow_blocks) upstream->deallocate(overflow.pointer,overflow.byte_count,overflow.alignment);
+		upstream->deallocate(block,block_size,alignof(std::max_align_t));
+	}
+
+	void Frame_Arena::reset() {
+		if(!overflow_blocks.empty()) {
+			for(const auto& overflow : overflow_blocks) upstream->deallocate(overflow.pointer,overflow.byte_count,overflow.alignment);
+			overflow_blocks.clear();
+			//Doubling at least once leaves room for the alignment padding the allocations will need once they share a block.
+			std::size_t new_block_size = block_size * 2;
+			while(new_block_size < peak_byte_count) new_block_size *= 2;
+			auto new_block = static_cast<unsigned char*>(upstream->allocate(new_block_size,alignof(std::max_align_t)));
+			upstream->deallocate(block,block_size,alignof(std::max_align_t));
+			block = new_block;
+			block_size = new_block_size;
+			upstream_allocations += 1;
+		}
+		block_offset = 0;
+		used_byte_count = 0;
+	}
+
+	void* Frame_Arena::do_allocate(std::size_t byte_count,std::size_t alignment) {
+		auto address = reinterpret_cast<std::uintptr_t>(block) + block_offset;
+		std::size_t padding = (alignment - address % alignment) % alignment;
+		if(padding + byte_count <= block_size - block_offset) {
+			void* pointer = block + block_offset + padding;
+			block_offset += padding + byte_count;
+			used_byte_count += padding + byte_count;
+			peak_byte_count = std::max(peak_byte_count,used_byte_count);
+			return pointer;
+		}
+
+		void* pointer = upstream->allocate(byte_count,alignment);
+		try {
+			overflow_blocks.push_back({pointer,byte_count,alignment});
+		}
+		catch(...) {
+			upstream->deallocate(pointer,byte_count,alignment);
+			throw;
+		}
+		upstream_allocations += 1;
+		used_byte_count += byte_count;
+		peak_byte_count = std::max(peak_byte_count,used_byte_count);
+		return pointer;
+	}
+
+	void Frame_Arena::do_deallocate(void*,std::size_t,std::size_t) {}
+
+	bool Frame_Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+		return this == &other;
+	}
+}
@@ -0,0 +1,50 @@
+#ifndef FRAME_ARENA_HPP
+#define FRAME_ARENA_HPP
+
+#include <vector>
+#include <cstddef>
+#include <memory_resource>
+
+namespace core {
+	/*	Bump allocator for data that only lives until the next 'reset', e.g. scratch space of one tick. Allocating moves a pointer, deallocating
+		does nothing and 'reset' frees everything at once. Allocations that don't fit get blocks of their own from 'upstream', and the next 'reset'
+		replaces all blocks with a single one large enough for the whole peak, so once warmed up the arena doesn't allocate anymore.
+		Containers use it through the 'std::pmr' ones. Only one thread may use an arena at a time. */
+	class Frame_Arena : public std::pmr::memory_resource {
+	public:
+		static inline constexpr std::size_t Default_Capacity = 256 * 1024;
+
+		explicit Frame_Arena(std::size_t capacity = Default_Capacity,std::pmr::memory_resource* _upstream = std::pmr::new_delete_resource());
+		Frame_Arena(const Frame_Arena&) = delete;
+		Frame_Arena& operator=(const Frame_Arena&) = delete;
+		~Frame_Arena();
+		//Everything allocated since the last reset has to be unused by now.
+		void reset();
+		[[nodiscard]] std::size_t used_bytes() const noexcept { return used_byte_count; }
+		[[nodiscard]] std::size_t peak_bytes() const noexcept { return peak_byte_count; }
+		[[nodiscard]] std::size_t capacity() const noexcept { return block_size; }
+		//Blocks requested from 'upstream' so far, it stops growing once the arena is warmed up.
+		[[nodiscard]] std::size_t upstream_allocation_count() const noexcept { return upstream_allocations; }
+	private:
+		void* do_allocate(std::size_t byte_count,std::size_t alignment) override;
+		void do_deallocate(void* pointer,std::size_t byte_count,std::size_t alignment) override;
+		[[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+		struct Overflow_Block {
+			void* pointer;
+			std::size_t byte_count;
+			std::size_t alignment;
+		};
+
+		std::pmr::memory_resource* upstream;
+		unsigned char* block;
+		std::size_t block_size;
+		std::size_t block_offset;
+		std::vector<Overflow_Block> overflow_blocks;
+		std::size_t used_byte_count;
+		std::size_t peak_byte_count;
+		std::size_t upstream_allocations;
+	};
+}
+
+#endif
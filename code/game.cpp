@@ -1,19 +1,27 @@
+#include <array>
+#include <memory>
 #include <cstdio>
+#include <cctype>
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <charconv>
+#include <string_view>
+#include <algorithm>
 #include <cinttypes>
 #include "game.hpp"
 #include "exceptions.hpp"
+#include "defer.hpp"
 #include <Windows.h>
 namespace core {
 	static constexpr float Main_Menu_First_Option_Y_Offset = 7.0f;
-	static constexpr const char* Main_Menu_Options[] = {"1 player","2 players","Load Level","Construction","Quit"};
+	static constexpr const char* Main_Menu_Options[] = {"1 player","2 players","Horde","Load Level","Construction","Quit"};
 	static constexpr std::size_t Main_Menu_Options_Count = sizeof(Main_Menu_Options) / sizeof(*Main_Menu_Options);
 	static constexpr float Map_First_Option_Y_Offset = 5.0f;
 	static constexpr const char* Map_Options[] = {"Level 1","Level 2","Level 3","Level 4","Level 5 ","Search in windows"};
 	static constexpr std::size_t Map_Options_Count = sizeof(Map_Options) / sizeof(*Map_Options);
+	static constexpr const char* Stage_Map_File_Paths[] = {"./assets/maps/map1.txt","./assets/maps/map2.txt","./assets/maps/map3.txt","./assets/maps/map4.txt","./assets/maps/map5.txt"};
 	static constexpr float Players_Mode_Option_Y_Offset = 4.0f;
 	static constexpr const char* Players_Mode_Options[] = { "1 Player","2 Players" };
 	static constexpr std::size_t Players_Mode_Options_Count = sizeof(Players_Mode_Options) / sizeof(*Players_Mode_Options);
@@ -27,15 +35,101 @@ namespace core {
 	static constexpr Vec2 Eagle_Size = {1.0f,1.0f};
 	static constexpr Vec2 Tank_Size = {1.0f,1.0f};
 	static constexpr Vec2 Bullet_Size = {1.0f,1.0f};
-	static constexpr Vec2 Enemy_Spawner_Locations[] = {{1,1},{Background_Tile_Count_X / 2,1},{Background_Tile_Count_X - 1 - 0.001f,1}};
-	static constexpr std::size_t Enemy_Spawner_Location_Count = sizeof(Enemy_Spawner_Locations) / sizeof(*Enemy_Spawner_Locations);
+	static constexpr std::size_t Enemy_Spawner_Location_Count = 3;
 	static constexpr std::uint32_t Spawn_Effect_Layer_Count = 7;
 	static constexpr float Spawn_Effect_Frame_Duration = 0.1f;
 	static constexpr float Tank_Shoot_Cooldown = 0.4f;
 	static constexpr float Enemy_Spawn_Time = 2.0f;
+	//AI tanks don't attack players immediately after spawning.
+	static constexpr float Enemy_React_Time = 2.0f;
+	static constexpr float Player_Respawn_Time = 2.0f;
+	static constexpr float Player_Invulnerability_Time = 5.0f;
+	static constexpr float Explosion_Duration = 1.0f;
+	//Time between a stage being won or lost and the scene changing.
+	static constexpr float Game_End_Delay = 1.0f;
 	static constexpr float Collision_Offset = 0.1f;
 	static constexpr std::uint32_t Player_Starting_Life_Count = 3;
 	static constexpr std::uint32_t Enemy_Hop_Count_To_Shoot = 10;
+	static constexpr float Autosave_Interval = 30.0f;
+	static constexpr const char* Autosave_File_Path = "./assets/maps/autosave.txt";
+	//Streamed maps are only partly in memory, so they are autosaved in their own format.
+	static constexpr const char* Streamed_Autosave_File_Path = "./assets/maps/autosave.chunks";
+	//Tiles per second the editor scrolls over large maps.
+	static constexpr float Construction_Scroll_Speed = 8.0f;
+	static constexpr float Save_Status_Duration = 2.0f;
+	//Half tiles around entities and past the edges of the screen whose chunks a streamed map keeps loaded.
+	static constexpr std::int32_t Stream_Entity_Margin = 4;
+	static constexpr std::int32_t Stream_View_Margin = 8;
+	//Half tiles ahead of moving tanks and bullets whose chunks are prefetched, two chunks.
+	static constexpr std::int32_t Stream_Prefetch_Distance = 2 * std::int32_t(Tile_Grid::Chunk_Size);
+	static constexpr const char* Horde_Settings_File_Path = "./assets/horde.txt";
+	static constexpr std::uint32_t Max_Horde_Entity_Count = 65536;
+	static constexpr std::uint32_t Default_Max_Bullet_Count = 1024;
+	//The benchmark doubles the enemy count from this one up to the requested maximum.
+	static constexpr std::uint32_t Stress_First_Enemy_Count = 125;
+	static constexpr float Stress_Tick_Duration = 1.0f / 60.0f;
+	static constexpr std::uint32_t Stress_Warmup_Tick_Count = 60;
+	static constexpr std::uint32_t Stress_Measured_Tick_Count = 300;
+	static constexpr std::uint32_t Stress_Match_Seed = 0x5EED;
+	static constexpr std::uint32_t Stress_Placement_Attempt_Count = 64;
+	static constexpr const char* Stress_Map_File_Path = "./assets/maps/map1.txt";
+	static constexpr const char* Stress_Report_File_Path = "./stress_report.csv";
+	//Seconds between two writes of the memory report.
+	static constexpr float Memory_Dump_Interval = 5.0f;
+	//Every use of randomness draws from its own stream, so adding draws to one doesn't change the numbers another one gets.
+	enum class Random_Purpose : std::uint32_t {
+		Enemy_Spawn,
+		Enemy_Decision,
+		Enemy_Steering,
+		Enemy_Unstuck,
+		Stress_Placement,
+		Enemy_Planner
+	};
+	//Streams of the game itself rather than of a particular entity use this id.
+	static constexpr std::uint32_t Game_Entity_Id = 0;
+	//Timers count ticks shorter than a frame, so a timer fires on the frame it runs out rather than up to a frame later.
+	static constexpr double Timer_Ticks_Per_Second = 240.0;
+	//Enemy and effect timers carry the id of their entity, player timers the player's index and the rest 'Game_Entity_Id'.
+	enum class Timer_Kind : std::uint32_t {
+		Enemy_Decision,
+		Enemy_Spawn,
+		Player_Respawn,
+		Player_Vulnerable,
+		Spawn_Effect_Expired,
+		Explosion_Expired,
+		Game_Won,
+		Game_Lost
+	};
+	[[nodiscard]] static Timer_Event pool_timer_event(Timer_Kind kind,Pool_Handle handle) noexcept {
+		return {std::uint32_t(kind),handle.index,handle.generation};
+	}
+	//Destructible tiles can be shot through, so paths through them are allowed but cost more than open ground.
+	static constexpr std::uint8_t Destructible_Tile_Navigation_Cost = 6;
+	//Half tiles the navigation fields reach past the entities. Paths leaving the window aren't found, so it leaves room for detours.
+	static constexpr std::int32_t Navigation_Window_Margin = 64;
+	static constexpr float Navigation_Follow_Chance = 0.8f;
+	static constexpr float Enemy_Decision_Interval = 0.15f;
+	static constexpr std::uint32_t Enemy_Decision_Stagger_Slot_Count = 8;
+	static constexpr std::chrono::microseconds Enemy_Ai_Frame_Budget{500};
+	//Ticks between updates for each 'Ai_Lod' value in order.
+	static constexpr std::uint32_t Ai_Lod_Strides[] = {1,2,4};
+	//Navigation distances, i.e. roughly half tiles of open ground, up to which enemies are kept at full and reduced rate.
+	static constexpr std::uint32_t Ai_Lod_Full_Distance = 16;
+	static constexpr std::uint32_t Ai_Lod_Reduced_Distance = 40;
+	static constexpr float Ai_Lod_Hold_Time = 1.0f;
+	//Tiles around a player bullet in which enemies count as under fire.
+	static constexpr std::int32_t Ai_Lod_Threat_Radius = 3;
+	//Longest step a skipping enemy integrates at once. Stays below half a tile of movement, so steering and collisions don't miss a half tile even at low frame rates.
+	static constexpr float Ai_Lod_Max_Step = 0.1f;
+	//Planner rollouts look this far ahead, several enemy decisions deep. A decision stops rolling out once its budget is spent, while 'Ai_Scheduler' keeps the total per frame within 'Enemy_Ai_Frame_Budget'.
+	static constexpr float Planner_Horizon = 1.5f;
+	static constexpr float Planner_Step = 0.05f;
+	static constexpr std::uint32_t Planner_Max_Rollout_Count = 256;
+	static constexpr std::chrono::microseconds Planner_Decision_Budget{200};
+	static constexpr float Planner_Eagle_Value = 100.0f;
+	static constexpr float Planner_Player_Value = 50.0f;
+	//Below this many enemies per worker, splitting the update costs more than it saves.
+	static constexpr std::size_t Enemy_Update_Chunk_Size = 16;
 	static constexpr Entity_Direction_Triple Entity_Direction_Triples[] = {
 		{Entity_Direction::Down,Entity_Direction::Up,Entity_Direction::Left},
 		{Entity_Direction::Right,Entity_Direction::Left,Entity_Direction::Up},
@@ -43,148 +137,382 @@ namespace core {
 		{Entity_Direction::Right,Entity_Direction::Left,Entity_Direction::Down}
 	};
 
-	//Bounding boxes for each 'Entity_Direction' value in order.
-	static constexpr Rect Bullet_Bounding_Boxes[] = {{0.28125f,0.4375f,0.40625f,0.1875f},{0.4375f,0.28125f,0.1875f,0.40625f},{0.3125f,0.40625f,0.40625f,0.1875f},{0.4375f,0.3125f,0.1875f,0.40625f}};
+	//Bounding boxes for each 'Entity_Direction' value in order, relative to the center of the bullet.
+	static constexpr Rect Bullet_Center_Boxes[] = {{-0.21875f,-0.0625f,0.40625f,0.1875f},{-0.0625f,-0.21875f,0.1875f,0.40625f},{-0.1875f,-0.09375f,0.40625f,0.1875f},{-0.0625f,-0.1875f,0.1875f,0.40625f}};
 	static constexpr Vec2 Tank_Bullet_Firing_Positions[] = {{0.6f,0.0f},{0.0f,0.6f},{-0.6f,0.0f},{0.0f,-0.6f}};
 
-	Game::Game(Renderer* _renderer,Platform* _platform) : renderer(_renderer),platform(_platform),scene(Scene::Main_Menu),
-		current_main_menu_option(),update_timer(),construction_marker_pos(),construction_choosing_tile(),construction_tile_choice_marker_pos(),
-		construction_current_tile_template_index(),tile_templates(),show_fps(),quit(),tiles(),eagle(),game_lose_timer(),spawn_effects(),enemy_tanks(),
-		random_engine(),enamy_spawn_point_random_dist(),enemy_action_duration_dist(),chance_0_1_dist(),max_enemy_count_on_screen(),remaining_enemy_count_to_spawn(),
-		enemy_spawn_timer(),game_win_timer(),current_stage_index(),first_player(),second_player() {
-		random_engine = std::minstd_rand0(std::time(nullptr));
-		enamy_spawn_point_random_dist = std::uniform_int_distribution<std::size_t>(0,Enemy_Spawner_Location_Count - 1);
-		enemy_action_duration_dist = std::uniform_real_distribution<float>(0.5f,3.0f);
-		chance_0_1_dist = std::uniform_real_distribution<float>(0.0f,1.0f);
-
-		tiles_texture = renderer->sprite_atlas("./assets/tiles_16x16.bmp",16);
-		construction_place_marker = renderer->sprite("./assets/marker.bmp");
-		entity_sprites = renderer->sprite_atlas("./assets/entities_32x32.bmp",32);
-		spawn_effect_sprite_atlas = renderer->sprite_atlas("./assets/spawn_effect_32x32.bmp",32);
-		explosion_sprite = renderer->sprite_atlas("./assets/explosions_16x16.bmp",16);
+	static constexpr const char* Tiles_Info_File_Path = "./assets/tiles_16x16.txt";
+	[[nodiscard]] static std::vector<Tile_Template> parse_tile_templates(const std::vector<std::uint8_t>& file_bytes) {
+		std::vector<Tile_Template> tile_templates{};
+		std::istringstream file{std::string(file_bytes.begin(),file_bytes.end())};
+
+		std::string line{};
+		while(std::getline(file,line)) {
+			//Skip comments.
+			if(line.size() < 2 || line[0] == '#') continue;
+
+			std::uint32_t index_buffer = 0;
+			char health_buffer[32] = {};
+			char flag_buffer[32] = {};
+			std::uint32_t rotation = 0;
+
+			int count = std::sscanf(line.c_str(),"%" SCNu32 " %31s %" SCNu32 " %31s",&index_buffer,health_buffer,&rotation,flag_buffer);
+			if(count < 0) throw File_Exception(Tiles_Info_File_Path,"Invalid format.");
+
+			Tile_Template tile_template{};
+			tile_template.tile_layer_index = index_buffer;
+
+			switch(rotation) {
+				case 0: tile_template.rotation = 0.0f; break;
+				case 1: tile_template.rotation = PI / 2.0f; break;
+				case 2: tile_template.rotation = PI; break;
+				case 3: tile_template.rotation = 3.0f * PI / 2.0f; break;
+				default: throw File_Exception(Tiles_Info_File_Path,"Invalid rotation value.");
+			}
 
-		{
-			static constexpr const char* Tiles_Info_File_Path = "./assets/tiles_16x16.txt";
-			std::ifstream file{Tiles_Info_File_Path,std::ios::binary};
-			if(!file.is_open()) throw File_Open_Exception(Tiles_Info_File_Path);
+			if(std::strcmp(health_buffer,"-1") == 0) {
+				tile_template.health = std::uint32_t(-1);
+			}
+			else {
+				count = std::sscanf(health_buffer,"%" SCNu32,&tile_template.health);
+				if(count < 0) throw File_Exception(Tiles_Info_File_Path,"Invalid format.");
+			}
 
-			std::string line{};
-			while(std::getline(file,line)) {
-				//Skip comments.
-				if(line.size() < 2 || line[0] == '#') continue;
+			if(std::strcmp(flag_buffer,"solid") == 0) {
+				tile_template.flag = Tile_Flag::Solid;
+			}
+			else if(std::strcmp(flag_buffer,"below") == 0) {
+				tile_template.flag = Tile_Flag::Below;
+			}
+			else if(std::strcmp(flag_buffer,"above") == 0) {
+				tile_template.flag = Tile_Flag::Above;
+			}
+			else if(std::strcmp(flag_buffer,"bulletpass") == 0) {
+				tile_template.flag = Tile_Flag::Bulletpass;
+			}
+			else throw File_Exception(Tiles_Info_File_Path,"Invalid format.");
 
-				std::uint32_t index_buffer = 0;
-				char health_buffer[32] = {};
-				char flag_buffer[32] = {};
-				std::uint32_t rotation = 0;
+			//The last template index marks empty cells of 'Tile_Grid'.
+			if(tile_templates.size() >= Tile_Grid::Template_Mask) throw File_Exception(Tiles_Info_File_Path,"Too many tile templates.");
+			tile_templates.push_back(tile_template);
+		}
+		return tile_templates;
+	}
 
-				int count = std::sscanf(line.c_str(),"%" SCNu32 " %31s %" SCNu32 " %31s",&index_buffer,health_buffer,&rotation,flag_buffer);
-				if(count < 0) throw File_Exception(Tiles_Info_File_Path,"Invalid format.");
+	//Maps are stored as text, two numbers per half-tile: template index and health. They start with "size" and their width and height
+	//in half tiles, maps without it are one screen large.
+	[[nodiscard]] static Tile_Grid parse_map(const std::vector<std::uint8_t>& file_bytes,Tile_Layout layout) {
+		const char* cursor = reinterpret_cast<const char*>(file_bytes.data());
+		const char* end = cursor + file_bytes.size();
+		auto parse_value = [&]() {
+			while(cursor < end && std::isspace(static_cast<unsigned char>(*cursor))) cursor += 1;
+			std::uint32_t value = 0;
+			auto result = std::from_chars(cursor,end,value);
+			if(result.ec != std::errc()) throw Runtime_Exception("Invalid map format.");
+			cursor = result.ptr;
+			return value;
+		};
 
-				Tile_Template tile_template{};
-				tile_template.tile_layer_index = index_buffer;
+		static constexpr std::string_view Size_Keyword = "size";
+		std::uint32_t width = Tile_Grid::Default_Width;
+		std::uint32_t height = Tile_Grid::Default_Height;
+		while(cursor < end && std::isspace(static_cast<unsigned char>(*cursor))) cursor += 1;
+		if(std::string_view(cursor,std::size_t(end - cursor)).starts_with(Size_Keyword)) {
+			cursor += Size_Keyword.size();
+			width = parse_value();
+			height = parse_value();
+		}
 
-				switch(rotation) {
-					case 0: tile_template.rotation = 0.0f; break;
-					case 1: tile_template.rotation = PI / 2.0f; break;
-					case 2: tile_template.rotation = PI; break;
-					case 3: tile_template.rotation = 3.0f * PI / 2.0f; break;
-					default: throw File_Exception(Tiles_Info_File_Path,"Invalid rotation value.");
-				}
+		Tile_Grid tiles{};
+		tiles.resize(width,height,layout);
+		//Templates are loaded on the main thread, the flag bits are filled in by 'refresh_templates' once the map is swapped in.
+		const std::vector<Tile_Template> no_templates{};
+		for(std::uint32_t y = 0;y < height;y += 1) {
+			for(std::uint32_t x = 0;x < width;x += 1) {
+				Tile tile{};
+				tile.template_index = parse_value();
+				tile.health = parse_value();
+				tiles.set(std::int32_t(x),std::int32_t(y),tile,no_templates);
+			}
+		}
+		return tiles;
+	}
 
-				if(std::strcmp(health_buffer,"-1") == 0) {
-					tile_template.health = std::uint32_t(-1);
-				}
-				else {
-					count = std::sscanf(health_buffer,"%" SCNu32,&tile_template.health);
-					if(count < 0) throw File_Exception(Tiles_Info_File_Path,"Invalid format.");
-				}
+	[[nodiscard]] static Horde_Settings parse_horde_settings(const std::vector<std::uint8_t>& file_bytes) {
+		Horde_Settings settings{};
+		std::istringstream file{std::string(file_bytes.begin(),file_bytes.end())};
+
+		std::string line{};
+		while(std::getline(file,line)) {
+			//Skip comments.
+			if(line.size() < 2 || line[0] == '#') continue;
+
+			char name_buffer[32] = {};
+			float value = 0.0f;
+			int count = std::sscanf(line.c_str(),"%31s %f",name_buffer,&value);
+			if(count != 2 || value < 0.0f) throw File_Exception(Horde_Settings_File_Path,"Invalid format.");
+
+			auto entity_count = std::uint32_t(std::min(value,float(Max_Horde_Entity_Count)));
+			if(std::strcmp(name_buffer,"max_enemies_on_screen") == 0) settings.max_enemy_count_on_screen = entity_count;
+			else if(std::strcmp(name_buffer,"enemies_to_spawn") == 0) settings.enemy_count_to_spawn = entity_count;
+			else if(std::strcmp(name_buffer,"max_bullets") == 0) settings.max_bullet_count = entity_count;
+			else if(std::strcmp(name_buffer,"spawners") == 0) settings.spawner_count = std::clamp(entity_count,1u,Tile_Grid::Max_Dimension / 2 - 1);
+			else if(std::strcmp(name_buffer,"spawn_batch") == 0) settings.spawn_batch_size = std::max(entity_count,1u);
+			else if(std::strcmp(name_buffer,"spawn_interval") == 0) settings.spawn_interval = value;
+			else throw File_Exception(Horde_Settings_File_Path,"Unknown setting.");
+		}
+		return settings;
+	}
 
-				if(std::strcmp(flag_buffer,"solid") == 0) {
-					tile_template.flag = Tile_Flag::Solid;
-				}
-				else if(std::strcmp(flag_buffer,"below") == 0) {
-					tile_template.flag = Tile_Flag::Below;
-				}
-				else if(std::strcmp(flag_buffer,"above") == 0) {
-					tile_template.flag = Tile_Flag::Above;
-				}
-				else if(std::strcmp(flag_buffer,"bulletpass") == 0) {
-					tile_template.flag = Tile_Flag::Bulletpass;
-				}
-				else throw File_Exception(Tiles_Info_File_Path,"Invalid format.");
+	[[nodiscard]] static bool is_streamed_map_path(std::string_view file_path) noexcept {
+		return file_path.ends_with(Map_Stream::File_Extension);
+	}
+
+	//Behaviours live next to their maps, "map1.txt" uses "map1.behaviour".
+	[[nodiscard]] static std::string behaviour_path_for_map(const char* map_path) {
+		std::string path = map_path;
+		auto dot = path.find_last_of('.');
+		auto separator = path.find_last_of("/\\");
+		if(dot != std::string::npos && (separator == std::string::npos || dot > separator)) path.resize(dot);
+		return path + ".behaviour";
+	}
+
+	//Tanks cover 2x2 half tiles, on the navigation grid they are addressed by the top-left one.
+	[[nodiscard]] static Ipoint tank_navigation_cell(Vec2 position) noexcept {
+		return {std::int32_t(std::lround(position.x * 2.0f)) - 1,std::int32_t(std::lround(position.y * 2.0f)) - 1};
+	}
+	//Cost of driving into the half tile at 'x','y' holding 'cell'. Half tiles of streamed chunks that aren't loaded are blocked, their tiles are unknown.
+	[[nodiscard]] static std::uint8_t navigation_cell_cost(const Tile_Grid& tiles,const Map_Stream& map_stream,std::int32_t x,std::int32_t y,std::uint16_t cell) {
+		if(!map_stream.is_resident(x,y)) return Flow_Field::Impassable;
+		if(cell & Tile_Grid::Bulletpass_Bit) return Flow_Field::Impassable;
+		if(cell & Tile_Grid::Solid_Bit) return (tiles.health(x,y) == std::uint32_t(-1)) ? Flow_Field::Impassable : Destructible_Tile_Navigation_Cost;
+		return 1;
+	}
+
+	//Rounded to the nearest tick, rounding up would turn durations like 0.1f, which is slightly more than a tenth, into an extra tick.
+	[[nodiscard]] static std::uint64_t seconds_to_ticks(float seconds) noexcept {
+		return std::uint64_t(std::llround(std::max(double(seconds),0.0) * Timer_Ticks_Per_Second));
+	}
 
-				tile_templates.push_back(tile_template);
+	//The top corners and the middle of the top row of a map 'map_width' tiles wide.
+	[[nodiscard]] static std::array<Vec2,Enemy_Spawner_Location_Count> default_enemy_spawner_locations(float map_width) noexcept {
+		return {{{1.0f,1.0f},{std::floor(map_width / 2.0f),1.0f},{map_width - 1.0f - 0.001f,1.0f}}};
+	}
+
+	[[nodiscard]] static std::vector<std::uint8_t> encode_map(const Tile_Grid& tiles) {
+		//Each value takes at most 10 digits and is followed by a separator, so does the header.
+		std::vector<std::uint8_t> bytes{};
+		bytes.resize(5 + 2 * 11 + std::size_t(tiles.width()) * tiles.height() * 2 * 11);
+		char* cursor = reinterpret_cast<char*>(bytes.data());
+		char* end = cursor + bytes.size();
+		cursor = std::copy_n("size ",5,cursor);
+		cursor = std::to_chars(cursor,end,tiles.width()).ptr;
+		*cursor++ = ' ';
+		cursor = std::to_chars(cursor,end,tiles.height()).ptr;
+		*cursor++ = '\n';
+		for(std::uint32_t y = 0;y < tiles.height();y += 1) {
+			for(std::uint32_t x = 0;x < tiles.width();x += 1) {
+				auto tile = tiles.get(std::int32_t(x),std::int32_t(y));
+				cursor = std::to_chars(cursor,end,tile.template_index).ptr;
+				*cursor++ = ' ';
+				cursor = std::to_chars(cursor,end,tile.health).ptr;
+				*cursor++ = (x + 1 == tiles.width()) ? '\n' : ' ';
 			}
 		}
-		load_map("./assets/maps/map_menu.txt");
+		bytes.resize(std::size_t(cursor - reinterpret_cast<char*>(bytes.data())));
+		return bytes;
 	}
 
-	std::optional<Ipoint> Game::check_collision_with_tiles(Vec2* out_position,Vec2 collider_size,std::int32_t start_x,std::int32_t start_y,std::int32_t end_x,std::int32_t end_y,Entity_Direction dir,bool is_bullet) {
-		if(dir == Entity_Direction::Right && (end_x >= 0 && end_x < Background_Tile_Count_X * 2)) {
-			for(std::int32_t y = start_y;y <= end_y;y += 1) {
-				if(y < 0 || y >= Background_Tile_Count_Y * 2) continue;
-				auto& tile = tiles[y * (Background_Tile_Count_X * 2) + end_x];
-				if(tile.template_index == Invalid_Tile_Index) continue;
+	//Answers the queries of a behaviour for one enemy from the same per-tick maps the built-in AI reads.
+	class Enemy_Behaviour_World final : public Behaviour_World {
+	public:
+		Enemy_Behaviour_World(const Game& _game,const Tank& _enemy) noexcept : game(_game),enemy(_enemy) {}
+		[[nodiscard]] float look(std::uint32_t dir,bool through_tiles) const override {
+			Vec2 position = enemy.position;
+			return float(game.line_of_fire(position + Tank_Bullet_Firing_Positions[dir],Entity_Direction(dir),through_tiles));
+		}
+		[[nodiscard]] float tile(std::uint32_t dir) const override {
+			//The half tile just past the front edge of the tank.
+			Vec2 position = enemy.position;
+			auto front = position + core::entity_direction_to_vector(Entity_Direction(dir)) * 0.75f;
+			auto x = std::int32_t(std::floor(front.x * 2.0f));
+			auto y = std::int32_t(std::floor(front.y * 2.0f));
+			if(!game.tiles.contains(x,y)) return float(Tile_Flag::Solid);
+			auto cell = game.tiles.cell(x,y);
+			if(Tile_Grid::empty(cell)) return -1.0f;
+			return float(game.tile_templates[Tile_Grid::template_index(cell)].flag);
+		}
+		[[nodiscard]] float distance(std::uint32_t dir) const override {
+			auto cell = core::tank_navigation_cell(enemy.position);
+			auto offset = core::entity_direction_to_vector(Entity_Direction(dir));
+			std::uint32_t distance = Flow_Field::Unreachable;
+			static_cast<void>(game.nearest_navigation_field({cell.x + std::int32_t(offset.x),cell.y + std::int32_t(offset.y)},&distance));
+			return float(distance);
+		}
+		[[nodiscard]] float navigate() const override {
+			auto dir = game.navigation_direction(core::tank_navigation_cell(enemy.position));
+			return dir.has_value() ? float(dir.value()) : -1.0f;
+		}
+	private:
+		const Game& game;
+		const Tank& enemy;
+	};
 
-				const auto& tile_template = tile_templates[tile.template_index];
-				if(is_bullet) {
-					if(tile_template.flag != Tile_Flag::Solid) continue;
-				}
-				else {
-					if(tile_template.flag != Tile_Flag::Solid && tile_template.flag != Tile_Flag::Bulletpass) continue;
-				}
+	void Bullet_Array::reserve(std::size_t capacity) {
+		x.reserve(capacity);
+		y.reserve(capacity);
+		dir.reserve(capacity);
+		fired_by_player.reserve(capacity);
+		destroyed.reserve(capacity);
+		slots.reserve(capacity);
+	}
+
+	Pool_Handle Bullet_Array::push_back(const Bullet& bullet) {
+		if(slots.full()) return {};
+		x.push_back(bullet.position.x);
+		y.push_back(bullet.position.y);
+		dir.push_back(std::uint8_t(bullet.dir));
+		fired_by_player.push_back(bullet.fired_by_player);
+		destroyed.push_back(bullet.destroyed);
+		return slots.add();
+	}
+
+	void Bullet_Array::clear() noexcept {
+		x.clear();
+		y.clear();
+		dir.clear();
+		fired_by_player.clear();
+		destroyed.clear();
+		slots.clear();
+	}
+
+	void Bullet_Array::remove_destroyed() noexcept {
+		slots.remove_if([this](std::size_t index) { return destroyed[index] != 0; },[this](std::size_t from,std::size_t to) {
+			x[to] = x[from];
+			y[to] = y[from];
+			dir[to] = dir[from];
+			fired_by_player[to] = fired_by_player[from];
+			destroyed[to] = destroyed[from];
+		});
+		auto kept = slots.size();
+		x.resize(kept);
+		y.resize(kept);
+		dir.resize(kept);
+		fired_by_player.resize(kept);
+		destroyed.resize(kept);
+	}
+
+	std::size_t Bullet_Array::memory_usage() const noexcept {
+		return core::reserved_bytes(x) + core::reserved_bytes(y) + core::reserved_bytes(dir) + core::reserved_bytes(fired_by_player) + core::reserved_bytes(destroyed) + slots.memory_usage();
+	}
+
+	Game::Game(Renderer* _renderer,Platform* _platform) : renderer(_renderer),platform(_platform),file_io(),file_watcher(),simulation_workers(),scene(Scene::Main_Menu),
+		current_main_menu_option(),update_timer(),construction_marker_pos(),construction_choosing_tile(),construction_tile_choice_marker_pos(),
+		construction_current_tile_template_index(),tile_templates(),show_fps(),quit(),tiles(),eagle(),game_lose_timer(),spawn_effects(),enemy_tanks(),
+		match_seed(),max_enemy_count_on_screen(),remaining_enemy_count_to_spawn(),
+		game_win_timer(),current_stage_index(),first_player(),second_player() {
+		match_seed = std::uint32_t(std::time(nullptr));
+		enemy_ai_scheduler.set_frame_budget(Enemy_Ai_Frame_Budget);
+		enemy_planner_settings = {Tank_Speed,Bullet_Speed,Tank_Shoot_Cooldown,Planner_Horizon,Planner_Step,Planner_Max_Rollout_Count,Planner_Decision_Budget};
+
+		//Sprites that aren't resident are loaded in the background from now on.
+		renderer->set_file_io(&file_io);
+
+		//Every startup file is requested at once so the reads overlap instead of running one after another.
+		hot_reload_sprites = {
+			{"./assets/tiles_16x16.bmp",&tiles_texture,16,false},
+			{"./assets/marker.bmp",&construction_place_marker,0,false},
+			{"./assets/entities_32x32.bmp",&entity_sprites,32,false},
+			{"./assets/spawn_effect_32x32.bmp",&spawn_effect_sprite_atlas,32,true},
+			{"./assets/explosions_16x16.bmp",&explosion_sprite,16,true}
+		};
+		for(const auto& asset : hot_reload_sprites) {
+			file_watcher.watch(asset.file_path);
+			if(asset.per_level) continue;
+			file_io.submit_read(asset.file_path,[this,asset](File_Completion& completion) {
+				if(!completion.succeeded()) core::throw_file_completion_error(completion);
+				if(asset.tile_dimension == 0) *asset.sprite = renderer->sprite(completion.file_path.c_str(),completion.data.data(),completion.data.size());
+				else *asset.sprite = renderer->sprite_atlas(completion.file_path.c_str(),completion.data.data(),completion.data.size(),asset.tile_dimension);
+			});
+		}
+		file_io.submit_read(Tiles_Info_File_Path,[this](File_Completion& completion) {
+			if(!completion.succeeded()) core::throw_file_completion_error(completion);
+			tile_templates = core::parse_tile_templates(completion.data);
+			tile_templates_loaded = true;
+			//The map may have been loaded first.
+			tiles.refresh_templates(tile_templates);
+			navigation_dirty = true;
+		});
+		file_watcher.watch(Tiles_Info_File_Path);
+		file_io.submit_read(Horde_Settings_File_Path,[this](File_Completion& completion) {
+			if(completion.error == File_Completion::Error::Open) return;
+			if(!completion.succeeded()) core::throw_file_completion_error(completion);
+			horde_settings = core::parse_horde_settings(completion.data);
+		});
+		file_watcher.watch(Horde_Settings_File_Path);
+		request_map("./assets/maps/map_menu.txt");
+		file_io.wait_all();
+	}
+
+	Game::~Game() {
+		//Requests that are still queued are dropped with 'file_io', the renderer must not wait for them.
+		renderer->set_file_io(nullptr);
+		for(const auto& asset : hot_reload_sprites) {
+			if(!asset.per_level || level_sprites_acquired) renderer->release_sprite(*asset.sprite);
+		}
+	}
+
+	void Game::acquire_level_sprites() {
+		//The new references are taken before the old ones are dropped, so sheets shared by both levels stay resident.
+		for(const auto& asset : hot_reload_sprites) {
+			if(!asset.per_level) continue;
+			auto previous = *asset.sprite;
+			*asset.sprite = (asset.tile_dimension == 0) ? renderer->sprite(asset.file_path) : renderer->sprite_atlas(asset.file_path,asset.tile_dimension);
+			if(level_sprites_acquired) renderer->release_sprite(previous);
+			//Read while the intro screen is shown rather than when the first enemy spawns.
+			renderer->prefetch_sprite(*asset.sprite);
+		}
+		level_sprites_acquired = true;
+	}
+
+	std::optional<Ipoint> Game::check_collision_with_tiles(Vec2* out_position,Vec2 collider_size,std::int32_t start_x,std::int32_t start_y,std::int32_t end_x,std::int32_t end_y,Entity_Direction dir,bool is_bullet) const {
+		//Bullets fly over bulletpass tiles, tanks don't.
+		auto blocking_bits = is_bullet ? Tile_Grid::Solid_Bit : std::uint16_t(Tile_Grid::Solid_Bit | Tile_Grid::Bulletpass_Bit);
+		//Rows and columns outside the map are skipped by clamping the ranges once, so the loops index the grid unchecked.
+		auto grid_width = std::int32_t(tiles.width());
+		auto grid_height = std::int32_t(tiles.height());
+		auto first_x = std::max(start_x,0);
+		auto first_y = std::max(start_y,0);
+		auto last_x = std::min(end_x,grid_width - 1);
+		auto last_y = std::min(end_y,grid_height - 1);
+		if(dir == Entity_Direction::Right && (end_x >= 0 && end_x < grid_width)) {
+			auto column = tiles.cursor(end_x,first_y);
+			for(std::int32_t y = first_y;y <= last_y;y += 1,column.next_y()) {
+				if(!(column.cell() & blocking_bits)) continue;
 				out_position->x = end_x / 2.0f - collider_size.x / 2.0f - 0.001f;
 				return Ipoint{end_x,y};
 			}
 		}
-		if(dir == Entity_Direction::Down && (end_y >= 0 && end_y < Background_Tile_Count_Y * 2)) {
-			for(std::int32_t x = start_x;x <= end_x;x += 1) {
-				if(x < 0 || x >= Background_Tile_Count_X * 2) continue;
-				auto& tile = tiles[end_y * (Background_Tile_Count_X * 2) + x];
-				if(tile.template_index == Invalid_Tile_Index) continue;
-
-				const auto& tile_template = tile_templates[tile.template_index];
-				if(is_bullet) {
-					if(tile_template.flag != Tile_Flag::Solid) continue;
-				}
-				else {
-					if(tile_template.flag != Tile_Flag::Solid && tile_template.flag != Tile_Flag::Bulletpass) continue;
-				}
+		if(dir == Entity_Direction::Down && (end_y >= 0 && end_y < grid_height)) {
+			auto row = tiles.cursor(first_x,end_y);
+			for(std::int32_t x = first_x;x <= last_x;x += 1,row.next_x()) {
+				if(!(row.cell() & blocking_bits)) continue;
 				out_position->y = end_y / 2.0f - collider_size.y / 2.0f - 0.001f;
 				return Ipoint{x,end_y};
 			}
 		}
-		if(dir == Entity_Direction::Left && (start_x >= 0 && start_x < Background_Tile_Count_X * 2)) {
-			for(std::int32_t y = start_y;y <= end_y;y += 1) {
-				if(y < 0 || y >= Background_Tile_Count_Y * 2) continue;
-				auto& tile = tiles[y * (Background_Tile_Count_X * 2) + start_x];
-				if(tile.template_index == Invalid_Tile_Index) continue;
-
-				const auto& tile_template = tile_templates[tile.template_index];
-				if(is_bullet) {
-					if(tile_template.flag != Tile_Flag::Solid) continue;
-				}
-				else {
-					if(tile_template.flag != Tile_Flag::Solid && tile_template.flag != Tile_Flag::Bulletpass) continue;
-				}
+		if(dir == Entity_Direction::Left && (start_x >= 0 && start_x < grid_width)) {
+			auto column = tiles.cursor(start_x,first_y);
+			for(std::int32_t y = first_y;y <= last_y;y += 1,column.next_y()) {
+				if(!(column.cell() & blocking_bits)) continue;
 				out_position->x = start_x / 2.0f + collider_size.x + 0.001f;
 				return Ipoint{start_x,y};
 			}
 		}
-		if(dir == Entity_Direction::Up && (start_y >= 0 && start_y < Background_Tile_Count_Y * 2)) {
-			for(std::int32_t x = start_x;x <= end_x;x += 1) {
-				if(x < 0 || x >= Background_Tile_Count_X * 2) continue;
-				auto& tile = tiles[start_y * (Background_Tile_Count_X * 2) + x];
-				if(tile.template_index == Invalid_Tile_Index) continue;
-
-				const auto& tile_template = tile_templates[tile.template_index];
-				if(is_bullet) {
-					if(tile_template.flag != Tile_Flag::Solid) continue;
-				}
-				else {
-					if(tile_template.flag != Tile_Flag::Solid && tile_template.flag != Tile_Flag::Bulletpass) continue;
-				}
+		if(dir == Entity_Direction::Up && (start_y >= 0 && start_y < grid_height)) {
+			auto row = tiles.cursor(first_x,start_y);
+			for(std::int32_t x = first_x;x <= last_x;x += 1,row.next_x()) {
+				if(!(row.cell() & blocking_bits)) continue;
 				out_position->y = start_y / 2.0f + collider_size.y + 0.001f;
 				return Ipoint{x,start_y};
 			}
@@ -207,10 +535,12 @@ namespace core {
 			return point;
 		};
 
+		auto blocking_bits = include_bulletpass_tiles ? std::uint16_t(Tile_Grid::Solid_Bit | Tile_Grid::Bulletpass_Bit) : Tile_Grid::Solid_Bit;
 		auto increment = core::entity_direction_to_vector(dir) * 0.5f;
+		auto map_bounds = map_size();
 		for(;;origin += increment) {
-			if(origin.x < 0.0f || origin.x >= (float(Background_Tile_Count_X))) break;
-			if(origin.y < 0.0f || origin.y >= (float(Background_Tile_Count_Y))) break;
+			if(origin.x < 0.0f || origin.x >= map_bounds.x) break;
+			if(origin.y < 0.0f || origin.y >= map_bounds.y) break;
 			
 			if(!skip_targets) {
 				if(!eagle.destroyed && eagle_rect.point_inside(origin)) {
@@ -227,19 +557,8 @@ namespace core {
 			}
 			if(!skip_tiles) {
 				Ipoint coords = {std::int32_t(origin.x * 2.0f),std::int32_t(origin.y * 2.0f)};
-				const Tile& tile = tiles[coords.y * (Background_Tile_Count_X * 2) + coords.x];
-				if(tile.template_index == Invalid_Tile_Index) continue;
-
-				const Tile_Template& temp = tile_templates[tile.template_index];
-				if(!include_bulletpass_tiles) {
-					if(temp.flag == Tile_Flag::Solid) {
-						return {Raycast_Outcome::Type::Tile,align_to_tile_grid(origin,dir)};
-					}
-				}
-				else {
-					if(temp.flag == Tile_Flag::Solid || temp.flag == Tile_Flag::Bulletpass) {
-						return {Raycast_Outcome::Type::Tile,align_to_tile_grid(origin,dir)};
-					}
+				if(tiles.cell(coords.x,coords.y) & blocking_bits) {
+					return {Raycast_Outcome::Type::Tile,align_to_tile_grid(origin,dir)};
 				}
 			}
 		}
@@ -247,25 +566,9 @@ namespace core {
 	}
 
 	void Game::update_player(Player* player,float delta_time) {
-		if(player->tank.destroyed && player->lifes > 0) {
-			player->respawn_timer -= delta_time;
-			if(player->respawn_timer <= 0.0f) {
-				player->respawn_timer = 0.0f;
-				player->tank.destroyed = false;
-				player->tank.dir = Entity_Direction::Up;
-				player->tank.position = eagle.position + ((player == &first_player) ? Vec2{-3.0f,0.0f} : Vec2{3.0f,0.0f});
-				player->lifes -= 1;
-				player->invulnerability_timer = 5.0f;
-				add_spawn_effect(player->tank.position);
-			}
-			return;
-		}
-
-		player->invulnerability_timer -= delta_time;
-		if(player->invulnerability_timer <= 0.0f) player->invulnerability_timer = 0.0f;
-
-		player->tank.shoot_cooldown -= delta_time;
-		if(player->tank.shoot_cooldown <= 0.0f) player->tank.shoot_cooldown = 0.0f;
+		Allocation_Phase_Scope allocation_phase{Allocation_Phase::Update_Player};
+		//Destroyed players wait for their respawn timer.
+		if(player->tank.destroyed) return;
 
 		Vec2 forward = {};
 		auto key_right = (player == &first_player) ? Keycode::D : Keycode::Right;
@@ -290,13 +593,13 @@ namespace core {
 			player->tank.dir = Entity_Direction::Up;
 			forward = {0.0f,-1.0f};
 		}
-		if(platform->was_key_pressed(key_shoot) && player->tank.shoot_cooldown <= 0.0f) {
+		if(platform->was_key_pressed(key_shoot) && timers.now() >= player->tank.shoot_ready_tick) {
 			Bullet bullet{};
 			bullet.fired_by_player = true;
 			bullet.dir = player->tank.dir;
 			bullet.position = player->tank.position + Tank_Bullet_Firing_Positions[std::size_t(bullet.dir)];
 			bullets.push_back(bullet);
-			player->tank.shoot_cooldown = Tank_Shoot_Cooldown;
+			player->tank.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown);
 		}
 		
 		player->tank.position.x += forward.x * Tank_Speed * delta_time;
@@ -311,231 +614,911 @@ namespace core {
 		check_collision_with_tiles(&player->tank.position,Tank_Size,start_x,start_y,end_x,end_y,player->tank.dir);
 	}
 
-	void Game::update_enemies(float delta_time) {
-		if(remaining_enemy_count_to_spawn == 0 && enemy_tanks.size() == 0) {
-			game_win_timer -= delta_time;
-			if(game_win_timer <= 0.0f) {
-				game_win_timer = 0.0f;
-				scene = ((scene == Scene::Game_1player) ? Scene::Outro_1player : Scene::Outro_2player);
-				return;
+	void Game::respawn_player(Player* player) {
+		player->tank.destroyed = false;
+		player->tank.dir = Entity_Direction::Up;
+		player->tank.position = eagle.position + ((player == &first_player) ? Vec2{-3.0f,0.0f} : Vec2{3.0f,0.0f});
+		player->lifes -= 1;
+		player->invulnerable = true;
+		timers.schedule(core::seconds_to_ticks(Player_Invulnerability_Time),{std::uint32_t(Timer_Kind::Player_Vulnerable),std::uint32_t(player == &second_player)});
+		add_spawn_effect(player->tank.position);
+	}
+
+	void Game::update_timers(float delta_time) {
+		timer_tick_fraction += double(delta_time) * Timer_Ticks_Per_Second;
+		auto tick_count = std::uint64_t(timer_tick_fraction);
+		timer_tick_fraction -= double(tick_count);
+		std::pmr::vector<Timer_Event> expired_timers{&frame_arena};
+		timers.advance(tick_count,&expired_timers);
+
+		//Entities may be gone by the time their timer fires, such timers are ignored. Timers of pooled entities carry their handle.
+		for(const auto& event : expired_timers) {
+			Player* player = (event.entity_id == 0) ? &first_player : &second_player;
+			Pool_Handle handle = {event.entity_id,event.entity_generation};
+			switch(Timer_Kind(event.kind)) {
+				case Timer_Kind::Enemy_Decision: {
+					auto enemy = enemy_tanks.find(handle);
+					if(enemy && !enemy->destroyed) enemy_ai_scheduler.request(enemy->id);
+					break;
+				}
+				case Timer_Kind::Enemy_Spawn: spawn_enemy_batch(); break;
+				case Timer_Kind::Player_Respawn: respawn_player(player); break;
+				case Timer_Kind::Player_Vulnerable: player->invulnerable = false; break;
+				case Timer_Kind::Spawn_Effect_Expired: spawn_effects.remove(handle); break;
+				case Timer_Kind::Explosion_Expired: explosions.remove(handle); break;
+				case Timer_Kind::Game_Won: scene = ((scene == Scene::Game_1player) ? Scene::Outro_1player : Scene::Outro_2player); break;
+				case Timer_Kind::Game_Lost: scene = ((scene == Scene::Game_1player) ? Scene::Game_Over_1player : Scene::Game_Over_2player); break;
+			}
+		}
+	}
+
+	std::uint64_t Game::timer_deadline(float seconds) const noexcept {
+		return timers.now() + core::seconds_to_ticks(seconds);
+	}
+
+	float Game::seconds_until(std::uint64_t tick) const noexcept {
+		return (tick > timers.now()) ? float(double(tick - timers.now()) / Timer_Ticks_Per_Second) : 0.0f;
+	}
+
+	Vec2 Game::map_size() const noexcept {
+		return {float(tiles.width()) / 2.0f,float(tiles.height()) / 2.0f};
+	}
+
+	Vec2 Game::default_eagle_position() const noexcept {
+		auto size = map_size();
+		return {std::floor(size.x) / 2.0f,size.y - 2.0f};
+	}
+
+	Vec2 Game::camera_position() const noexcept {
+		Vec2 focus = {};
+		switch(scene) {
+			case Scene::Construction: {
+				focus = {construction_camera.x + Background_Tile_Count_X / 2.0f,construction_camera.y + Background_Tile_Count_Y / 2.0f};
+				break;
+			}
+			case Scene::Game_1player:
+			case Scene::Game_2player:
+			case Scene::Stress_Benchmark: {
+				focus = first_player.tank.destroyed ? eagle.position : first_player.tank.position;
+				break;
+			}
+			default: return {};
+		}
+		//The view stops at the edges of the map, maps of one screen don't scroll at all.
+		auto size = map_size();
+		auto max_x = std::max(size.x - float(Background_Tile_Count_X),0.0f);
+		auto max_y = std::max(size.y - float(Background_Tile_Count_Y),0.0f);
+		return {std::clamp(focus.x - Background_Tile_Count_X / 2.0f,0.0f,max_x),std::clamp(focus.y - Background_Tile_Count_Y / 2.0f,0.0f,max_y)};
+	}
+
+	void Game::update_map_stream() {
+		//Chunks drop the tiles whose template isn't loaded, so streaming waits for the templates.
+		if(!map_stream.is_open() || !tile_templates_loaded) return;
+		auto camera = camera_position();
+		map_stream.request({std::int32_t(camera.x * 2.0f) - Stream_View_Margin,std::int32_t(camera.y * 2.0f) - Stream_View_Margin,
+							std::int32_t(Background_Tile_Count_X * 2) + 2 * Stream_View_Margin,std::int32_t(Background_Tile_Count_Y * 2) + 2 * Stream_View_Margin});
+		auto request_around = [this](Vec2 position,std::optional<Entity_Direction> dir) {
+			auto x = std::int32_t(std::floor(position.x * 2.0f));
+			auto y = std::int32_t(std::floor(position.y * 2.0f));
+			map_stream.request({x - Stream_Entity_Margin,y - Stream_Entity_Margin,2 * Stream_Entity_Margin + 1,2 * Stream_Entity_Margin + 1});
+			if(!dir.has_value()) return;
+			//A strip as wide as the requested area, reaching 'Stream_Prefetch_Distance' further in the direction of movement.
+			switch(dir.value()) {
+				case Entity_Direction::Right: { map_stream.prefetch({x + Stream_Entity_Margin + 1,y - Stream_Entity_Margin,Stream_Prefetch_Distance,2 * Stream_Entity_Margin + 1}); break; }
+				case Entity_Direction::Down: { map_stream.prefetch({x - Stream_Entity_Margin,y + Stream_Entity_Margin + 1,2 * Stream_Entity_Margin + 1,Stream_Prefetch_Distance}); break; }
+				case Entity_Direction::Left: { map_stream.prefetch({x - Stream_Entity_Margin - Stream_Prefetch_Distance,y - Stream_Entity_Margin,Stream_Prefetch_Distance,2 * Stream_Entity_Margin + 1}); break; }
+				case Entity_Direction::Up: { map_stream.prefetch({x - Stream_Entity_Margin,y - Stream_Entity_Margin - Stream_Prefetch_Distance,2 * Stream_Entity_Margin + 1,Stream_Prefetch_Distance}); break; }
 			}
+		};
+		request_around(eagle.position,std::nullopt);
+		if(!first_player.tank.destroyed) request_around(first_player.tank.position,first_player.tank.dir);
+		if(scene == Scene::Game_2player && !second_player.tank.destroyed) request_around(second_player.tank.position,second_player.tank.dir);
+		for(const auto& enemy : enemy_tanks) request_around(enemy.position,enemy.dir);
+		for(std::size_t i = 0;i < bullets.size();i += 1) request_around({bullets.x[i],bullets.y[i]},Entity_Direction(bullets.dir[i]));
+		//Loaded and evicted chunks change the tiles the navigation fields were built from, only their half tiles are updated.
+		map_stream.update(tile_templates);
+		for(auto slot : map_stream.changed_chunks()) {
+			if(navigation_changed_chunks.size() < navigation_changed_chunks.capacity()) navigation_changed_chunks.push_back(slot);
+			else navigation_dirty = true;
 		}
+	}
 
-		if(remaining_enemy_count_to_spawn > 0) {
-			enemy_spawn_timer -= delta_time;
-			if(enemy_spawn_timer <= 0.0f) {
-				enemy_spawn_timer = Enemy_Spawn_Time;
+	void Game::update_navigation() {
+		auto grid_width = std::int32_t(tiles.width());
+		auto grid_height = std::int32_t(tiles.height());
+		//The fields cover a window around the targets, the enemies and their spawners rather than the whole map.
+		std::int32_t min_x = grid_width;
+		std::int32_t min_y = grid_height;
+		std::int32_t max_x = 0;
+		std::int32_t max_y = 0;
+		auto include = [&](Vec2 position) {
+			auto cell = core::tank_navigation_cell(position);
+			min_x = std::min(min_x,cell.x);
+			min_y = std::min(min_y,cell.y);
+			max_x = std::max(max_x,cell.x + 2);
+			max_y = std::max(max_y,cell.y + 2);
+		};
+		include(eagle.position);
+		include(first_player.tank.position);
+		if(scene == Scene::Game_2player) include(second_player.tank.position);
+		for(const auto& enemy : enemy_tanks) include(enemy.position);
+		for(auto position : enemy_spawner_locations) include(position);
+		auto window_around = [&](std::int32_t margin) {
+			Irect window = {std::clamp(min_x - margin,0,grid_width),std::clamp(min_y - margin,0,grid_height),0,0};
+			window.width = std::clamp(max_x + margin,0,grid_width) - window.x;
+			window.height = std::clamp(max_y + margin,0,grid_height) - window.y;
+			if(window.width < 2 || window.height < 2) window = {0,0,grid_width,grid_height};
+			return window;
+		};
+		auto contains = [](const Irect& outer,const Irect& inner) {
+			return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+		};
+		//The window moves once an entity gets within half the margin of its edge, or once it's far larger than needed, so it isn't rebuilt on every step.
+		auto wanted_window = window_around(Navigation_Window_Margin);
+		auto window_area = std::int64_t(navigation_window.width) * navigation_window.height;
+		if(navigation_dirty || !contains(navigation_window,window_around(Navigation_Window_Margin / 2)) || window_area > 4 * std::int64_t(wanted_window.width) * wanted_window.height) {
+			navigation_window = wanted_window;
+			navigation_dirty = true;
+		}
 
-				if(enemy_tanks.size() < max_enemy_count_on_screen) {
-					Tank enemy = {};
-					enemy.dir = Entity_Direction::Up;
-					enemy.position = Enemy_Spawner_Locations[enamy_spawn_point_random_dist(random_engine)];
-					enemy.ai_react_timer = 2.0f;
-					enemy.ai_dir_change_timer = 0.5f;
-					enemy.hop_count_until_shoot = Enemy_Hop_Count_To_Shoot;
-					add_spawn_effect(enemy.position);
-					enemy_tanks.push_back(enemy);
-					remaining_enemy_count_to_spawn -= 1;
+		const auto& window = navigation_window;
+		auto window_width = std::size_t(window.width);
+		if(navigation_dirty) {
+			navigation_cell_costs.resize(window_width * std::size_t(window.height));
+			for(std::int32_t y = window.y;y < window.y + window.height;y += 1) {
+				auto row = tiles.cursor(window.x,y);
+				auto* costs = &navigation_cell_costs[std::size_t(y - window.y) * window_width];
+				for(std::int32_t x = window.x;x < window.x + window.width;x += 1,row.next_x()) costs[x - window.x] = core::navigation_cell_cost(tiles,map_stream,x,y,row.cell());
+			}
+			for(auto& field : navigation_fields) {
+				if(field.width() == 0) field = Flow_Field(std::uint32_t(window.width),std::uint32_t(window.height),2,{window.x,window.y});
+				else field.resize(std::uint32_t(window.width),std::uint32_t(window.height),{window.x,window.y});
+			}
+		}
+		//Half tiles of destroyed tiles and of loaded or evicted chunks whose cost changed.
+		std::pmr::vector<Ipoint> changed_cells{&frame_arena};
+		if(!navigation_dirty) {
+			auto update_cost = [&](std::int32_t x,std::int32_t y,std::uint16_t cell) {
+				auto& cost = navigation_cell_costs[std::size_t(y - window.y) * window_width + std::size_t(x - window.x)];
+				auto new_cost = core::navigation_cell_cost(tiles,map_stream,x,y,cell);
+				if(new_cost == cost) return;
+				cost = new_cost;
+				changed_cells.push_back({x,y});
+			};
+			for(auto cell : navigation_changed_cells) {
+				if(cell.x < window.x || cell.y < window.y || cell.x >= window.x + window.width || cell.y >= window.y + window.height) continue;
+				update_cost(cell.x,cell.y,tiles.cell(cell.x,cell.y));
+			}
+			for(auto slot : navigation_changed_chunks) {
+				auto chunk_x = std::int32_t((slot % tiles.chunk_columns()) << Tile_Grid::Chunk_Shift);
+				auto chunk_y = std::int32_t((slot / tiles.chunk_columns()) << Tile_Grid::Chunk_Shift);
+				auto first_x = std::max(chunk_x,window.x);
+				auto end_x = std::min(chunk_x + std::int32_t(Tile_Grid::Chunk_Size),window.x + window.width);
+				for(std::int32_t y = std::max(chunk_y,window.y);y < std::min(chunk_y + std::int32_t(Tile_Grid::Chunk_Size),window.y + window.height);y += 1) {
+					auto row = tiles.cursor(first_x,y);
+					for(std::int32_t x = first_x;x < end_x;x += 1,row.next_x()) update_cost(x,y,row.cell());
 				}
 			}
 		}
 
-		Rect eagle_rect = {eagle.position.x - Eagle_Size.x / 2.0f,eagle.position.y - Eagle_Size.y / 2.0f,Eagle_Size.x,Eagle_Size.y};
-		for(auto& enemy : enemy_tanks) {
-			//AI tanks don't attack players immediately after spawning.
-			enemy.ai_react_timer -= delta_time;
-			if(enemy.ai_react_timer <= 0.0f) {
-				enemy.ai_react_timer = 0.0f;
+		//Fields are only recomputed when the window moved or their target moved into another half tile. Cheaper half tiles only update the
+		//distances they shorten, a half tile getting more expensive, e.g. when its chunk is evicted, recomputes the field.
+		Vec2 target_positions[] = {eagle.position,first_player.tank.position,second_player.tank.position};
+		std::size_t target_count = (scene == Scene::Game_2player) ? 3 : 2;
+		for(std::size_t i = 0;i < target_count;i += 1) {
+			auto cell = core::tank_navigation_cell(target_positions[i]);
+			auto& field = navigation_fields[i];
+			if(navigation_dirty || cell.x != navigation_targets[i].x || cell.y != navigation_targets[i].y) {
+				navigation_targets[i] = cell;
+				field.compute(navigation_cell_costs,&cell,1);
+			}
+			else if(!changed_cells.empty() && !field.lower_costs(navigation_cell_costs,changed_cells.data(),changed_cells.size())) {
+				field.compute(navigation_cell_costs,&navigation_targets[i],1);
+			}
+		}
+		navigation_changed_cells.clear();
+		navigation_changed_chunks.clear();
+		navigation_dirty = false;
+	}
+
+	std::uint8_t Game::navigation_footprint_cost(Ipoint cell) const {
+		std::uint8_t cost = 1;
+		for(std::int32_t y = cell.y;y < cell.y + 2;y += 1) {
+			for(std::int32_t x = cell.x;x < cell.x + 2;x += 1) {
+				if(!tiles.contains(x,y)) return Flow_Field::Impassable;
+				auto cell_cost = core::navigation_cell_cost(tiles,map_stream,x,y,tiles.cell(x,y));
+				if(cell_cost == Flow_Field::Impassable) return Flow_Field::Impassable;
+				cost = std::max(cost,cell_cost);
+			}
+		}
+		return cost;
+	}
+
+	const Flow_Field* Game::nearest_navigation_field(Ipoint cell,std::uint32_t* out_distance) const {
+		bool target_alive[] = {!eagle.destroyed,!first_player.tank.destroyed,scene == Scene::Game_2player && !second_player.tank.destroyed};
+		const Flow_Field* nearest_field = nullptr;
+		*out_distance = Flow_Field::Unreachable;
+		for(std::size_t i = 0;i < 3;i += 1) {
+			if(!target_alive[i]) continue;
+			auto distance = navigation_fields[i].distance(cell.x,cell.y);
+			if(distance < *out_distance) {
+				*out_distance = distance;
+				nearest_field = &navigation_fields[i];
+			}
+		}
+		return nearest_field;
+	}
 
-				enemy.shoot_cooldown -= delta_time;
-				if(enemy.shoot_cooldown <= 0.0f) {
-					enemy.shoot_cooldown = 0.0f;
+	std::optional<Entity_Direction> Game::navigation_direction(Ipoint cell) const {
+		std::uint32_t nearest_distance = Flow_Field::Unreachable;
+		const Flow_Field* nearest_field = nearest_navigation_field(cell,&nearest_distance);
+		if(!nearest_field || nearest_distance == 0) return std::nullopt;
+
+		std::optional<Entity_Direction> best_dir{};
+		std::uint32_t best_distance = nearest_distance;
+		for(auto dir : {Entity_Direction::Right,Entity_Direction::Down,Entity_Direction::Left,Entity_Direction::Up}) {
+			auto offset = core::entity_direction_to_vector(dir);
+			auto distance = nearest_field->distance(cell.x + std::int32_t(offset.x),cell.y + std::int32_t(offset.y));
+			if(distance < best_distance) {
+				best_distance = distance;
+				best_dir = dir;
+			}
+		}
+		return best_dir;
+	}
+
+	void Game::decide_enemy_direction(Enemy_Update* update) const {
+		Tank& enemy = update->tank;
+		enemy.ai_decision_delay = Enemy_Decision_Interval * float(Ai_Lod_Strides[std::size_t(enemy.ai_lod)]);
+
+		if(enemy_planner_enabled) {
+			Planner_Window window;
+			Planner_State state;
+			build_planner_snapshot(enemy,&window,&state);
+			Random_Stream random{{match_seed,enemy.id},simulation_tick,std::uint32_t(Random_Purpose::Enemy_Planner)};
+			auto move = core::plan_move(window,state,enemy_planner_settings,&random);
+			if(Entity_Direction(move.dir) != enemy.dir && enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+			enemy.dir = Entity_Direction(move.dir);
+			if(move.shoot && timers.now() >= enemy.shoot_ready_tick) enemy.ai_wants_to_shoot = true;
+			return;
+		}
+
+		if(enemy_behaviour.has_value() && enemy_behaviour_enabled) {
+			Behaviour_Agent agent = {std::uint32_t(enemy.dir),seconds_until(enemy.shoot_ready_tick),enemy.hop_count_until_shoot,false,false,-1.0f};
+			Random_Stream random{{match_seed,enemy.id},simulation_tick,std::uint32_t(Random_Purpose::Enemy_Decision)};
+			enemy_behaviour->run(&agent,Enemy_Behaviour_World(*this,enemy),&random);
+			if(agent.turned) {
+				enemy.dir = Entity_Direction(agent.dir);
+				if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+			}
+			if(agent.shoot && timers.now() >= enemy.shoot_ready_tick) {
+				enemy.ai_wants_to_shoot = true;
+				enemy.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown * 2);
+			}
+			if(agent.wait >= 0.0f) enemy.ai_decision_delay = agent.wait;
+			return;
+		}
 
-					auto firing_pos = enemy.position + Tank_Bullet_Firing_Positions[std::size_t(enemy.dir)];
-					if(enemy.hop_count_until_shoot == 0) {
+		Random_Stream random{{match_seed,enemy.id},simulation_tick,std::uint32_t(Random_Purpose::Enemy_Decision)};
+		const auto& triple = Entity_Direction_Triples[std::size_t(enemy.dir)];
+		for(auto dir : {triple.dir0,triple.dir1,triple.dir_back}) {
+			auto target = line_of_fire(enemy.position + Tank_Bullet_Firing_Positions[std::size_t(dir)],dir,true);
+			if(target == Raycast_Outcome::Type::Eagle) {
+				if(random.next_float() <= 0.4f) {
+					enemy.dir = dir;
+					if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+					if(timers.now() >= enemy.shoot_ready_tick && random.next_float() <= 0.25f) {
 						Bullet bullet{};
 						bullet.dir = enemy.dir;
-						bullet.position = firing_pos;
-						bullets.push_back(bullet);
-						enemy.shoot_cooldown = Tank_Shoot_Cooldown;
-						enemy.hop_count_until_shoot = Enemy_Hop_Count_To_Shoot;
+						bullet.position = enemy.position + Tank_Bullet_Firing_Positions[std::size_t(enemy.dir)];
+						update->bullets[update->bullet_count++] = bullet;
+						enemy.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown * 2);
 					}
-					else {
-						if(enemy.ai_wants_to_shoot) {
-							enemy.ai_wants_to_shoot = false;
-							Bullet bullet{};
-							bullet.dir = enemy.dir;
-							bullet.position = firing_pos;
-							bullets.push_back(bullet);
-							enemy.shoot_cooldown = Tank_Shoot_Cooldown;
-						}
-						else {
-							auto raycast_against_targets = raycast(firing_pos,enemy.dir,false,false,false);
-							if(raycast_against_targets.hit_target()) {
-								Bullet bullet{};
-								bullet.dir = enemy.dir;
-								bullet.position = firing_pos;
-								bullets.push_back(bullet);
-								enemy.shoot_cooldown = Tank_Shoot_Cooldown;
-							}
-						}
+					break;
+				}
+			}
+			else if(target == Raycast_Outcome::Type::Player1 || target == Raycast_Outcome::Type::Player2) {
+				float chance = (dir == triple.dir_back) ? 0.15f : 0.4f;
+				if(random.next_float() <= chance) {
+					enemy.dir = dir;
+					if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+					if(timers.now() >= enemy.shoot_ready_tick && random.next_float() <= 0.25f) {
+						enemy.ai_wants_to_shoot = true;
+						enemy.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown * 2);
 					}
+					break;
 				}
 			}
+		}
+	}
 
-			enemy.ai_dir_change_timer -= delta_time;
-			if(enemy.ai_dir_change_timer <= 0.0f) {
-				enemy.ai_dir_change_timer = 0.15f;
-
-				const auto& triple = Entity_Direction_Triples[std::size_t(enemy.dir)];
-				for(auto dir : {triple.dir0,triple.dir1,triple.dir_back}) {
-					auto raycast_result = raycast(enemy.position + Tank_Bullet_Firing_Positions[std::size_t(dir)],dir,false,true,false);
-					if(raycast_result.type == Raycast_Outcome::Type::Eagle) {
-						if(chance_0_1_dist(random_engine) <= 0.4f) {
-							enemy.dir = dir;
-							if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
-							if(enemy.shoot_cooldown <= 0.0f && chance_0_1_dist(random_engine) <= 0.25f) {
-								Bullet bullet{};
-								bullet.dir = enemy.dir;
-								bullet.position = enemy.position + Tank_Bullet_Firing_Positions[std::size_t(enemy.dir)];
-								bullets.push_back(bullet);
-								enemy.shoot_cooldown = Tank_Shoot_Cooldown * 2;
-							}
-							break;
-						}
-					}
-					else if(raycast_result.type == Raycast_Outcome::Type::Player1 || raycast_result.type == Raycast_Outcome::Type::Player2) {
-						float chance = (dir == triple.dir_back) ? 0.15f : 0.4f;
-						if(chance_0_1_dist(random_engine) <= chance) {
-							enemy.dir = dir;
-							if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
-							if(enemy.shoot_cooldown <= 0.0f && chance_0_1_dist(random_engine) <= 0.25f) {
-								enemy.ai_wants_to_shoot = true;
-								enemy.shoot_cooldown = Tank_Shoot_Cooldown * 2;
-							}
-							break;
-						}
-					}
-					if(dir != triple.dir_back) {
-						raycast_result = raycast(enemy.position + Tank_Bullet_Firing_Positions[std::size_t(dir)],dir,true,false,true);
-						if(raycast_result.type == Raycast_Outcome::Type::Tile) {
-							if(chance_0_1_dist(random_engine) <= 0.1f) {
-								enemy.dir = dir;
-								if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
-								break;
-							}
-						}
-					}
+	void Game::update_line_of_fire() {
+		//Targets are passed in the order 'raycast' tests them, so overlapping ones resolve the same way.
+		Rect targets[Line_Of_Fire::Max_Target_Count] = {};
+		std::size_t target_count = 0;
+		auto add_target = [&](Vec2 position,Vec2 size,Raycast_Outcome::Type type) {
+			targets[target_count] = {position.x - size.x / 2.0f,position.y - size.y / 2.0f,size.x,size.y};
+			line_of_fire_types[target_count] = type;
+			target_count += 1;
+		};
+		if(!eagle.destroyed) add_target(eagle.position,Eagle_Size,Raycast_Outcome::Type::Eagle);
+		if(!first_player.tank.destroyed) add_target(first_player.tank.position,Tank_Size,Raycast_Outcome::Type::Player1);
+		if(scene == Scene::Game_2player && !second_player.tank.destroyed) add_target(second_player.tank.position,Tank_Size,Raycast_Outcome::Type::Player2);
+		lines_of_fire.update(tiles,targets,target_count,&map_stream);
+	}
+
+	Raycast_Outcome::Type Game::line_of_fire(Vec2 origin,Entity_Direction dir,bool through_tiles) const noexcept {
+		Ipoint cell = {std::int32_t(std::floor(origin.x * 2.0f)),std::int32_t(std::floor(origin.y * 2.0f))};
+		auto target = lines_of_fire.first_target(cell,std::uint8_t(dir),through_tiles);
+		return (target == Line_Of_Fire::No_Target) ? Raycast_Outcome::Type::None : line_of_fire_types[target];
+	}
+
+	void Game::update_enemies(float delta_time) {
+		Allocation_Phase_Scope allocation_phase{Allocation_Phase::Update_Enemies};
+		auto navigation_start = std::chrono::steady_clock::now();
+		//Spawners don't depend on the fields, but the fields cover them.
+		if(enemy_spawner_locations.empty()) update_enemy_spawners();
+		update_navigation();
+		auto line_of_fire_start = std::chrono::steady_clock::now();
+		update_line_of_fire();
+		auto enemies_start = std::chrono::steady_clock::now();
+		frame_timings.navigation = line_of_fire_start - navigation_start;
+		frame_timings.line_of_fire = enemies_start - line_of_fire_start;
+		defer[&]{ frame_timings.enemies = std::chrono::steady_clock::now() - enemies_start; };
+
+		//Once won, a stage stays won until the scene changes.
+		if(remaining_enemy_count_to_spawn == 0 && enemy_tanks.size() == 0 && !timers.pending(game_win_timer)) {
+			game_win_timer = timers.schedule(core::seconds_to_ticks(Game_End_Delay),{std::uint32_t(Timer_Kind::Game_Won),Game_Entity_Id});
+		}
+
+		//Decisions are requested by their timers, which are scheduled again once a decision has been applied.
+		collect_player_bullets();
+		for(auto& enemy : enemy_tanks) {
+			enemy.ai_lod = choose_ai_lod(&enemy);
+			enemy.ai_lod_elapsed += delta_time;
+		}
+
+		//Decide phase: every enemy is updated on a copy, reading only the world as it was at the start of the phase.
+		//Enemies don't see each other's changes and draw only from their own random streams, so the outcome doesn't depend on how the work is split.
+		std::pmr::vector<Enemy_Update> enemy_updates(enemy_tanks.size(),&frame_arena);
+		for(std::size_t i = 0;i < enemy_tanks.size();i += 1) {
+			const auto& enemy = enemy_tanks[i];
+			auto stride = Ai_Lod_Strides[std::size_t(enemy.ai_lod)];
+			enemy_updates[i].tank = enemy;
+			enemy_updates[i].bullet_count = 0;
+			enemy_updates[i].active = (simulation_tick + enemy.id) % stride == 0 || enemy.ai_lod_elapsed >= Ai_Lod_Max_Step;
+			enemy_updates[i].decide = false;
+			enemy_updates[i].decision_time = {};
+		}
+		std::pmr::vector<Ai_Scheduler::Agent_Id> granted_enemy_decisions{&frame_arena};
+		enemy_ai_scheduler.grant(&granted_enemy_decisions);
+		for(auto id : granted_enemy_decisions) {
+			auto it = std::lower_bound(enemy_ids.begin(),enemy_ids.end(),id,[](const Enemy_Id_Entry& entry,Ai_Scheduler::Agent_Id value) { return entry.id < value; });
+			if(it == enemy_ids.end() || it->id != id) continue;
+			auto index = enemy_tanks.index(it->handle);
+			if(index == Pool_Slots::Invalid_Index) continue;
+			auto& update = enemy_updates[index];
+			update.decide = true;
+			update.active = true;
+		}
+		simulation_workers.parallel_for(enemy_updates.size(),Enemy_Update_Chunk_Size,[this,&enemy_updates](std::size_t begin,std::size_t end) {
+			for(std::size_t i = begin;i < end;i += 1) {
+				auto& update = enemy_updates[i];
+				if(!update.active) continue;
+				float step = update.tank.ai_lod_elapsed;
+				update.tank.ai_lod_elapsed = 0.0f;
+				update_enemy(&update,step);
+			}
+		});
+
+		//Apply phase: results are committed in enemy order.
+		std::chrono::nanoseconds decision_time{};
+		std::size_t decision_count = 0;
+		for(std::size_t i = 0;i < enemy_updates.size();i += 1) {
+			const auto& update = enemy_updates[i];
+			enemy_tanks[i] = update.tank;
+			if(update.decide && !update.tank.destroyed) timers.schedule(core::seconds_to_ticks(update.tank.ai_decision_delay),core::pool_timer_event(Timer_Kind::Enemy_Decision,enemy_tanks.handle(i)));
+			//Shots over the bullet cap are dropped, the enemy still waits for its cooldown.
+			std::size_t bullet_room = (bullets.size() < max_bullet_count) ? (max_bullet_count - bullets.size()) : 0;
+			for(std::size_t j = 0;j < std::min<std::size_t>(update.bullet_count,bullet_room);j += 1) bullets.push_back(update.bullets[j]);
+			if(update.decide) {
+				decision_time += update.decision_time;
+				decision_count += 1;
+			}
+		}
+		enemy_ai_scheduler.report_decision_time(decision_time,decision_count);
+		enemy_tanks.remove_if([](const Tank& tank) { return tank.destroyed; });
+		//Entries of removed enemies are dropped once they outnumber the live ones, which keeps the index within twice the enemy cap.
+		if(enemy_ids.size() > 2 * enemy_tanks.size()) std::erase_if(enemy_ids,[this](const Enemy_Id_Entry& entry) { return enemy_tanks.index(entry.handle) == Pool_Slots::Invalid_Index; });
+	}
+
+	Ai_Lod Game::choose_ai_lod(Tank* enemy) const {
+		//Enemies that see a target or are near a player bullet are promoted at once and held at full rate for a while, so they don't flap between tiers.
+		bool promoted = false;
+		auto tile_x = std::int32_t(enemy->position.x);
+		auto tile_y = std::int32_t(enemy->position.y);
+		auto* nearby = std::lower_bound(player_bullets,player_bullets + player_bullet_count,tile_y - Ai_Lod_Threat_Radius,[](const Bullet& bullet,std::int32_t y) { return std::int32_t(bullet.position.y) < y; });
+		for(;!promoted && nearby != player_bullets + player_bullet_count && std::int32_t(nearby->position.y) <= tile_y + Ai_Lod_Threat_Radius;nearby += 1) {
+			auto bullet_x = std::int32_t(nearby->position.x);
+			promoted = bullet_x >= tile_x - Ai_Lod_Threat_Radius && bullet_x <= tile_x + Ai_Lod_Threat_Radius;
+		}
+		for(auto dir : {Entity_Direction::Right,Entity_Direction::Down,Entity_Direction::Left,Entity_Direction::Up}) {
+			if(promoted) break;
+			promoted = line_of_fire(enemy->position + Tank_Bullet_Firing_Positions[std::size_t(dir)],dir,true) != Raycast_Outcome::Type::None;
+		}
+		if(promoted) enemy->ai_lod_hold_tick = timer_deadline(Ai_Lod_Hold_Time);
+		if(timers.now() < enemy->ai_lod_hold_tick) return Ai_Lod::Full;
+
+		std::uint32_t distance = Flow_Field::Unreachable;
+		if(!nearest_navigation_field(core::tank_navigation_cell(enemy->position),&distance)) return Ai_Lod::Distant;
+		if(distance <= Ai_Lod_Full_Distance) return Ai_Lod::Full;
+		if(distance <= Ai_Lod_Reduced_Distance) return Ai_Lod::Reduced;
+		return Ai_Lod::Distant;
+	}
+
+	void Game::collect_player_bullets() {
+		player_bullet_count = std::size_t(std::count_if(bullets.fired_by_player.begin(),bullets.fired_by_player.end(),[](std::uint8_t fired_by_player) { return fired_by_player != 0; }));
+		auto* player_bullet_copies = std::pmr::polymorphic_allocator<Bullet>(&frame_arena).allocate(player_bullet_count);
+		player_bullets = player_bullet_copies;
+		for(std::size_t i = 0;i < bullets.size();i += 1) {
+			if(bullets.fired_by_player[i]) *player_bullet_copies++ = bullets[i];
+		}
+		std::sort(player_bullet_copies - player_bullet_count,player_bullet_copies,[](const Bullet& a,const Bullet& b) { return std::int32_t(a.position.y) < std::int32_t(b.position.y); });
+	}
+
+	void Game::build_planner_snapshot(const Tank& enemy,Planner_Window* window,Planner_State* state) const {
+		auto cell = core::tank_navigation_cell(enemy.position);
+		window->origin = {cell.x - Planner_Window::Size / 2 + 1,cell.y - Planner_Window::Size / 2 + 1};
+		for(std::int32_t y = 0;y < Planner_Window::Size;y += 1) {
+			state->tank_blocking[y] = 0;
+			state->bullet_blocking[y] = 0;
+			state->destructible[y] = 0;
+			for(std::int32_t x = 0;x < Planner_Window::Size;x += 1) {
+				Ipoint map_cell = {window->origin.x + x,window->origin.y + y};
+				auto bit = 1u << x;
+				auto& distance = window->target_distances[y * Planner_Window::Size + x];
+				if(!tiles.contains(map_cell.x,map_cell.y) || !map_stream.is_resident(map_cell.x,map_cell.y)) {
+					state->tank_blocking[y] |= bit;
+					state->bullet_blocking[y] |= bit;
+					distance = Flow_Field::Unreachable;
+					continue;
+				}
+				static_cast<void>(nearest_navigation_field(map_cell,&distance));
+
+				auto tile_cell = tiles.cell(map_cell.x,map_cell.y);
+				if(tile_cell & Tile_Grid::Solid_Bit) {
+					state->tank_blocking[y] |= bit;
+					state->bullet_blocking[y] |= bit;
+					if(tiles.health(map_cell.x,map_cell.y) != std::uint32_t(-1)) state->destructible[y] |= bit;
 				}
+				else if(tile_cell & Tile_Grid::Bulletpass_Bit) state->tank_blocking[y] |= bit;
 			}
+		}
+
+		state->tank_position = enemy.position;
+		state->tank_dir = std::uint8_t(enemy.dir);
+		state->tank_destroyed = false;
+		state->shoot_cooldown = seconds_until(enemy.shoot_ready_tick);
+		state->score = 0.0f;
+		state->target_count = 0;
+		auto add_target = [state](Vec2 position,float value) {
+			state->targets[state->target_count] = position;
+			state->target_values[state->target_count] = value;
+			state->target_count += 1;
+		};
+		if(!eagle.destroyed) add_target(eagle.position,Planner_Eagle_Value);
+		if(!first_player.tank.destroyed) add_target(first_player.tank.position,Planner_Player_Value);
+		if(scene == Scene::Game_2player && !second_player.tank.destroyed) add_target(second_player.tank.position,Planner_Player_Value);
+
+		state->bullet_count = 0;
+		Rect window_rect = {float(window->origin.x) / 2.0f,float(window->origin.y) / 2.0f,float(Planner_Window::Size) / 2.0f,float(Planner_Window::Size) / 2.0f};
+		for(std::size_t i = 0;i < player_bullet_count;i += 1) {
+			const auto& bullet = player_bullets[i];
+			if(state->bullet_count == Planner_State::Max_Bullet_Count) break;
+			if(!window_rect.point_inside(bullet.position)) continue;
+			state->bullets[state->bullet_count++] = {bullet.position,std::uint8_t(bullet.dir),false};
+		}
+	}
 
-			enemy.position.x += core::entity_direction_to_vector(enemy.dir).x * Tank_Speed * delta_time;
-			enemy.position.y += core::entity_direction_to_vector(enemy.dir).y * Tank_Speed * delta_time;
+	void Game::spawn_enemy(Vec2 position) {
+		Tank enemy = {};
+		enemy.dir = Entity_Direction::Up;
+		enemy.position = position;
+		enemy.shoot_ready_tick = timer_deadline(Enemy_React_Time);
+		enemy.id = next_entity_id++;
+		//Decisions of tanks spawned close together are offset from each other so they don't all come due in the same frame.
+		float first_decision_delay = 0.5f + float(enemy.id % Enemy_Decision_Stagger_Slot_Count) * (Enemy_Decision_Interval / float(Enemy_Decision_Stagger_Slot_Count));
+		enemy.hop_count_until_shoot = Enemy_Hop_Count_To_Shoot;
+		add_spawn_effect(enemy.position);
+		auto handle = enemy_tanks.insert(enemy);
+		//Ids only grow, so appending keeps the index sorted.
+		enemy_ids.push_back({enemy.id,handle});
+		timers.schedule(core::seconds_to_ticks(first_decision_delay),core::pool_timer_event(Timer_Kind::Enemy_Decision,handle));
+	}
 
-			std::int32_t start_x = std::int32_t((enemy.position.x - Tank_Size.x / 2.0f + Collision_Offset) * 2.0f);
-			std::int32_t start_y = std::int32_t((enemy.position.y - Tank_Size.y / 2.0f + Collision_Offset) * 2.0f);
-			std::int32_t end_x = std::int32_t((enemy.position.x + Tank_Size.x / 2.0f - Collision_Offset) * 2.0f);
-			std::int32_t end_y = std::int32_t((enemy.position.y + Tank_Size.y / 2.0f - Collision_Offset) * 2.0f);
+	void Game::spawn_enemy_batch() {
+		if(remaining_enemy_count_to_spawn == 0) return;
+		Random_Stream random{{match_seed,Game_Entity_Id},simulation_tick,std::uint32_t(Random_Purpose::Enemy_Spawn)};
+		for(std::uint32_t i = 0;i < enemy_spawn_batch_size && remaining_enemy_count_to_spawn > 0 && enemy_tanks.size() < max_enemy_count_on_screen;i += 1) {
+			spawn_enemy(enemy_spawner_locations[random.next_below(std::uint32_t(enemy_spawner_locations.size()))]);
+			remaining_enemy_count_to_spawn -= 1;
+		}
+		if(remaining_enemy_count_to_spawn > 0) timers.schedule(core::seconds_to_ticks(enemy_spawn_interval),{std::uint32_t(Timer_Kind::Enemy_Spawn),Game_Entity_Id});
+	}
 
-			auto collision_status = check_collision_with_tiles(&enemy.position,Tank_Size,start_x,start_y,end_x,end_y,enemy.dir);
-			if(collision_status.has_value()) {
-				Entity_Direction avaialble_dirs[3] = {};
-				std::size_t avaialble_dir_count = 0;
+	void Game::update_enemy_spawners() {
+		enemy_spawner_locations.clear();
+		auto default_spawners = core::default_enemy_spawner_locations(map_size().x);
+		if(horde_mode) {
+			//Horde spawners are spread evenly over the top row, except for those a tank wouldn't fit into on the current map.
+			auto count = std::min(horde_settings.spawner_count,std::max(std::uint32_t(map_size().x) - 1,1u));
+			auto first_x = default_spawners[0].x;
+			auto last_x = default_spawners[Enemy_Spawner_Location_Count - 1].x;
+			for(std::uint32_t i = 0;i < count;i += 1) {
+				float t = (count > 1) ? float(i) / float(count - 1) : 0.5f;
+				Vec2 position = {first_x + (last_x - first_x) * t,default_spawners[0].y};
+				auto cell = core::tank_navigation_cell(position);
+				if(navigation_footprint_cost(cell) != Flow_Field::Impassable) enemy_spawner_locations.push_back(position);
+			}
+		}
+		if(enemy_spawner_locations.empty()) enemy_spawner_locations.assign(default_spawners.begin(),default_spawners.end());
+	}
 
-				const auto& triple = Entity_Direction_Triples[std::size_t(enemy.dir)];
-				for(auto dir : {triple.dir0,triple.dir1,triple.dir_back}) {
-					auto raycast_result = raycast(enemy.position + Tank_Bullet_Firing_Positions[std::size_t(dir)],dir,true,false,true);
-					if(raycast_result.type == Raycast_Outcome::Type::Tile) avaialble_dirs[avaialble_dir_count++] = dir;
+	void Game::reserve_entity_pools() {
+		bullets.reserve(max_bullet_count);
+		enemy_tanks.reserve(max_enemy_count_on_screen);
+		enemy_ids.reserve(2 * std::size_t(max_enemy_count_on_screen));
+		//Every enemy spawns with an effect and most bullets end in an explosion.
+		spawn_effects.reserve(std::size_t(max_enemy_count_on_screen) + 2);
+		explosions.reserve(max_bullet_count);
+		//A bullet destroys at most one tile, the list is emptied every tick.
+		navigation_changed_cells.reserve(max_bullet_count);
+	}
+
+	void Game::start_stress_benchmark(std::uint32_t max_enemy_count) {
+		stress_runs.clear();
+		max_enemy_count = std::clamp(max_enemy_count,1u,Max_Horde_Entity_Count);
+		//The map's behaviour is loaded up front, so the runs know whether there is one to compare with the built-in AI.
+		load_map(Stress_Map_File_Path);
+		file_io.wait_all();
+		auto add_runs = [this](std::uint32_t count) {
+			stress_runs.push_back({count});
+			if(enemy_behaviour.has_value()) stress_runs.push_back({count,{},0,true});
+		};
+		for(std::uint32_t count = Stress_First_Enemy_Count;count < max_enemy_count;count *= 2) add_runs(count);
+		add_runs(max_enemy_count);
+		current_stress_run = 0;
+		scene = Scene::Stress_Benchmark;
+		begin_stress_run();
+	}
+
+	void Game::begin_stress_run() {
+		const auto& run = stress_runs[current_stress_run];
+		//Every run starts from the same state, so the only thing that changes between runs is the number of enemies.
+		load_map(Stress_Map_File_Path);
+		file_io.wait_all();
+		enemy_behaviour_enabled = run.scripted;
+		bullets.clear();
+		enemy_tanks.clear();
+		enemy_ids.clear();
+		enemy_ai_scheduler.clear();
+		spawn_effects.clear();
+		explosions.clear();
+		timers.clear();
+		timer_tick_fraction = 0.0;
+		eagle.destroyed = false;
+		eagle.position = default_eagle_position();
+		first_player.tank.destroyed = false;
+		first_player.tank.dir = Entity_Direction::Up;
+		first_player.tank.position = eagle.position - Vec2{3.0f,0.0f};
+		//Players aren't updated during the benchmark and no timer makes the player vulnerable, so the targets stay in place.
+		first_player.invulnerable = true;
+		first_player.lifes = Player_Starting_Life_Count;
+		match_seed = Stress_Match_Seed;
+		simulation_tick = 0;
+		next_entity_id = 1;
+		max_enemy_count_on_screen = run.enemy_count;
+		remaining_enemy_count_to_spawn = 0;
+		max_bullet_count = Max_Horde_Entity_Count;
+		reserve_entity_pools();
+		//Granting decisions by measured time would make the simulation depend on the machine, so a fixed number is granted instead, enough to keep up with the requests.
+		enemy_ai_scheduler.set_decision_limit(std::size_t(float(run.enemy_count) * Stress_Tick_Duration / Enemy_Decision_Interval) + 1);
+		stress_run_tick = 0;
+
+		//Placement reads the tiles directly, the fields are built around the placed enemies on the first tick.
+		navigation_dirty = true;
+		Random_Stream random{{match_seed,Game_Entity_Id},std::uint32_t(current_stress_run),std::uint32_t(Random_Purpose::Stress_Placement)};
+		for(std::uint32_t i = 0;i < run.enemy_count;i += 1) {
+			for(std::uint32_t attempt = 0;attempt < Stress_Placement_Attempt_Count;attempt += 1) {
+				Ipoint cell = {std::int32_t(random.next_below(tiles.width() - 1)),std::int32_t(random.next_below(tiles.height() - 1))};
+				if(navigation_footprint_cost(cell) != 1) continue;
+				spawn_enemy({float(cell.x + 1) / 2.0f,float(cell.y + 1) / 2.0f});
+				break;
+			}
+		}
+	}
+
+	void Game::finish_stress_benchmark() {
+		std::string report = "enemies,ai,bullets,navigation_ms,line_of_fire_ms,enemies_ms,bullets_ms,render_ms,total_ms\n";
+		for(const auto& run : stress_runs) {
+			auto to_milliseconds = [](std::chrono::nanoseconds time) { return double(time.count()) / 1000000.0 / double(Stress_Measured_Tick_Count); };
+			const auto& timings = run.total_timings;
+			auto total = timings.navigation + timings.line_of_fire + timings.enemies + timings.bullets + timings.render;
+			char buffer[256] = {};
+			int count = std::snprintf(buffer,sizeof(buffer) - 1,"%" PRIu32 ",%s,%" PRIu64 ",%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",run.enemy_count,run.scripted ? "behaviour" : "native",run.total_bullet_count / Stress_Measured_Tick_Count,
+									  to_milliseconds(timings.navigation),to_milliseconds(timings.line_of_fire),to_milliseconds(timings.enemies),
+									  to_milliseconds(timings.bullets),to_milliseconds(timings.render),to_milliseconds(total));
+			if(count < 0) throw Runtime_Exception("Couldn't create the stress benchmark report.");
+			report += buffer;
+		}
+		std::cout << "[Stress benchmark] Average time per tick:\n" << report << std::flush;
+
+		auto request = file_io.submit_write(Stress_Report_File_Path,std::vector<std::uint8_t>(report.begin(),report.end()),[](File_Completion& completion) {
+			if(!completion.succeeded()) std::cerr << "[Stress benchmark] Couldn't write \"" << completion.file_path << "\"." << std::endl;
+		});
+		file_io.wait(request);
+		enemy_ai_scheduler.set_decision_limit(0);
+		enemy_behaviour_enabled = true;
+		quit = true;
+	}
+
+	void Game::start_allocation_check(std::uint32_t max_enemy_count) {
+		if constexpr(!Allocation_Tracking_Enabled) throw Runtime_Exception("The allocation check needs a build with TANKS_TRACK_ALLOCATIONS enabled.");
+		allocation_check = true;
+		start_stress_benchmark(max_enemy_count);
+	}
+
+	bool Game::allocation_check_failed() const noexcept {
+		return allocation_check_failure;
+	}
+
+	void Game::finish_allocation_frame() {
+		auto frame = core::take_allocation_frame();
+		previous_frame_allocations = frame.total();
+		if(!allocation_check || !allocation_frame_steady || previous_frame_allocations.count == 0) return;
+		std::cerr << "[Allocation check] Tick " << stress_run_tick << " of stress run " << current_stress_run + 1 << " allocated:\n" << core::format_allocation_frame(frame) << std::flush;
+		allocation_check_failure = true;
+		quit = true;
+	}
+
+	Memory_Report Game::memory_report() const noexcept {
+		Memory_Report report{};
+		renderer->report_memory(&report);
+		report.add(Memory_Tag::Tiles,tiles.memory_usage() + map_stream.memory_usage() + core::reserved_bytes(tile_templates));
+		report.add(Memory_Tag::Entities,bullets.memory_usage() + enemy_tanks.memory_usage() + core::reserved_bytes(enemy_ids) + explosions.memory_usage() + spawn_effects.memory_usage() + timers.memory_usage());
+		std::size_t ai_byte_count = core::reserved_bytes(navigation_cell_costs) + core::reserved_bytes(navigation_changed_cells) + core::reserved_bytes(navigation_changed_chunks);
+		for(const auto& field : navigation_fields) ai_byte_count += field.memory_usage();
+		report.add(Memory_Tag::Ai_Maps,ai_byte_count);
+		report.add(Memory_Tag::Scratch,frame_arena.capacity());
+		return report;
+	}
+
+	void Game::set_memory_dump(const char* file_path) {
+		memory_dump_path = file_path;
+		memory_dump_timer = 0.0f;
+	}
+
+	void Game::update_memory_dump(float delta_time) {
+		if(memory_dump_path.empty()) return;
+		memory_dump_timer -= delta_time;
+		if(memory_dump_timer > 0.0f || memory_dump_in_flight) return;
+		memory_dump_timer = Memory_Dump_Interval;
+		auto report = core::format_memory_report(memory_report());
+		memory_dump_in_flight = true;
+		file_io.submit_write(memory_dump_path.c_str(),std::vector<std::uint8_t>(report.begin(),report.end()),[this](File_Completion& completion) {
+			memory_dump_in_flight = false;
+			if(!completion.succeeded()) std::cerr << "[Memory] Couldn't write \"" << completion.file_path << "\"." << std::endl;
+		});
+		//Writing the report allocates, so the frame can't count as a steady one.
+		allocation_frame_steady = false;
+	}
+
+	void Game::update_enemy(Enemy_Update* update,float delta_time) const {
+		Tank& enemy = update->tank;
+		if(update->decide) {
+			auto decision_start = std::chrono::steady_clock::now();
+			decide_enemy_direction(update);
+			update->decision_time = std::chrono::steady_clock::now() - decision_start;
+		}
+
+		//The first shot of a tank also waits for 'Enemy_React_Time' after spawning.
+		if(timers.now() >= enemy.shoot_ready_tick) {
+			auto firing_pos = enemy.position + Tank_Bullet_Firing_Positions[std::size_t(enemy.dir)];
+			if(enemy.hop_count_until_shoot == 0) {
+				Bullet bullet{};
+				bullet.dir = enemy.dir;
+				bullet.position = firing_pos;
+				update->bullets[update->bullet_count++] = bullet;
+				enemy.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown);
+				enemy.hop_count_until_shoot = Enemy_Hop_Count_To_Shoot;
+			}
+			else {
+				if(enemy.ai_wants_to_shoot) {
+					enemy.ai_wants_to_shoot = false;
+					Bullet bullet{};
+					bullet.dir = enemy.dir;
+					bullet.position = firing_pos;
+					update->bullets[update->bullet_count++] = bullet;
+					enemy.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown);
 				}
-				if(avaialble_dir_count > 0) {
-					auto distribution = std::uniform_int_distribution<std::uint32_t>(0,avaialble_dir_count - 1);
-					enemy.dir = avaialble_dirs[distribution(random_engine)];
-					if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+				else {
+					if(line_of_fire(firing_pos,enemy.dir,false) != Raycast_Outcome::Type::None) {
+						Bullet bullet{};
+						bullet.dir = enemy.dir;
+						bullet.position = firing_pos;
+						update->bullets[update->bullet_count++] = bullet;
+						enemy.shoot_ready_tick = timer_deadline(Tank_Shoot_Cooldown);
+					}
 				}
 			}
 		}
-		std::erase_if(enemy_tanks,[](const Tank& tank) { return tank.destroyed; });
+
+		//Steering happens as the tank crosses into another half tile. That is where it is aligned with the grid and can turn without scraping walls.
+		Ipoint crossed_cell = {std::int32_t(std::floor(enemy.position.x * 2.0f)) - 1,std::int32_t(std::floor(enemy.position.y * 2.0f)) - 1};
+		if(crossed_cell.x != enemy.navigation_cell.x || crossed_cell.y != enemy.navigation_cell.y) {
+			enemy.navigation_cell = crossed_cell;
+			auto dir = navigation_direction(core::tank_navigation_cell(enemy.position));
+			if(dir.has_value() && dir.value() != enemy.dir && Random_Stream({match_seed,enemy.id},simulation_tick,std::uint32_t(Random_Purpose::Enemy_Steering)).next_float() <= Navigation_Follow_Chance) {
+				enemy.position = {std::round(enemy.position.x * 2.0f) / 2.0f,std::round(enemy.position.y * 2.0f) / 2.0f};
+				enemy.dir = dir.value();
+				if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+			}
+		}
+
+		enemy.position.x += core::entity_direction_to_vector(enemy.dir).x * Tank_Speed * delta_time;
+		enemy.position.y += core::entity_direction_to_vector(enemy.dir).y * Tank_Speed * delta_time;
+
+		std::int32_t start_x = std::int32_t((enemy.position.x - Tank_Size.x / 2.0f + Collision_Offset) * 2.0f);
+		std::int32_t start_y = std::int32_t((enemy.position.y - Tank_Size.y / 2.0f + Collision_Offset) * 2.0f);
+		std::int32_t end_x = std::int32_t((enemy.position.x + Tank_Size.x / 2.0f - Collision_Offset) * 2.0f);
+		std::int32_t end_y = std::int32_t((enemy.position.y + Tank_Size.y / 2.0f - Collision_Offset) * 2.0f);
+
+		auto collision_status = check_collision_with_tiles(&enemy.position,Tank_Size,start_x,start_y,end_x,end_y,enemy.dir);
+		if(collision_status.has_value()) {
+			auto cell = core::tank_navigation_cell(enemy.position);
+			//The path leads through a destructible wall, so the tank stays put and shoots its way through.
+			auto navigation_dir = navigation_direction(cell);
+			if(navigation_dir.has_value() && navigation_dir.value() == enemy.dir) {
+				enemy.ai_wants_to_shoot = true;
+				return;
+			}
+
+			Entity_Direction avaialble_dirs[3] = {};
+			std::size_t avaialble_dir_count = 0;
+
+			const auto& triple = Entity_Direction_Triples[std::size_t(enemy.dir)];
+			for(auto dir : {triple.dir0,triple.dir1,triple.dir_back}) {
+				auto offset = core::entity_direction_to_vector(dir);
+				if(navigation_footprint_cost({cell.x + std::int32_t(offset.x),cell.y + std::int32_t(offset.y)}) == 1) avaialble_dirs[avaialble_dir_count++] = dir;
+			}
+			if(navigation_dir.has_value()) {
+				enemy.dir = navigation_dir.value();
+				if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+			}
+			else if(avaialble_dir_count > 0) {
+				Random_Stream random{{match_seed,enemy.id},simulation_tick,std::uint32_t(Random_Purpose::Enemy_Unstuck)};
+				enemy.dir = avaialble_dirs[random.next_below(std::uint32_t(avaialble_dir_count))];
+				if(enemy.hop_count_until_shoot > 0) enemy.hop_count_until_shoot -= 1;
+			}
+		}
 	}
 
 	void Game::update_bullets(float delta_time) {
-		Rect screen_rect = {0.0f,0.0f,float(Background_Tile_Count_X),float(Background_Tile_Count_Y)};
-		Urect tile_screen_rect = {0.0f,0.0f,Background_Tile_Count_X * 2,Background_Tile_Count_Y * 2};
+		Allocation_Phase_Scope allocation_phase{Allocation_Phase::Update_Bullets};
+		auto count = bullets.size();
+		//Moving the bullets and testing them against the screen, the eagle and the players are independent per bullet, so they run as vectorized passes first.
+		core::advance_positions(bullets.x.data(),bullets.y.data(),bullets.dir.data(),count,Bullet_Speed * delta_time);
+		Box_Array bullet_boxes{&frame_arena};
+		core::build_boxes(bullets.x.data(),bullets.y.data(),bullets.dir.data(),count,Bullet_Center_Boxes,&bullet_boxes);
 
 		Rect eagle_rect = {eagle.position.x - Eagle_Size.x / 2.0f,eagle.position.y - Eagle_Size.y / 2.0f,Eagle_Size.x,Eagle_Size.y};
-		for(auto& bullet : bullets) {
-			bullet.position += core::entity_direction_to_vector(bullet.dir) * Bullet_Speed * delta_time;
-			const auto& relative_bounding_box = Bullet_Bounding_Boxes[std::size_t(bullet.dir)];
-
-			Rect bullet_rect = {
-				bullet.position.x - Bullet_Size.x / 2.0f + relative_bounding_box.x,
-				bullet.position.y - Bullet_Size.y / 2.0f + relative_bounding_box.y,
-				relative_bounding_box.width,
-				relative_bounding_box.height
-			};
-			if(!screen_rect.overlaps(bullet_rect)) {
-				bullet.destroyed = true;
+		Player* players[] = {&first_player,&second_player};
+		auto map_bounds = map_size();
+		Box targets[] = {
+			{0.0f,0.0f,map_bounds.x,map_bounds.y},
+			core::box_from_rect(eagle_rect),
+			core::box_from_rect({first_player.tank.position.x - Tank_Size.x / 2.0f,first_player.tank.position.y - Tank_Size.y / 2.0f,1.0f,1.0f}),
+			core::box_from_rect({second_player.tank.position.x - Tank_Size.x / 2.0f,second_player.tank.position.y - Tank_Size.y / 2.0f,1.0f,1.0f})
+		};
+		//Overlap flags of every bullet with each target in turn.
+		std::pmr::vector<std::uint8_t> overlaps(4 * count,&frame_arena);
+		for(std::size_t i = 0;i < 4;i += 1) core::overlap_mask(bullet_boxes,targets[i],overlaps.data() + i * count);
+		const auto* on_screen = overlaps.data();
+		const auto* hits_eagle = on_screen + count;
+		const std::uint8_t* hits_player[] = {hits_eagle + count,hits_eagle + 2 * count};
+		Box_Array enemy_boxes{&frame_arena};
+		bool enemy_boxes_built = false;
+
+		//What a bullet hits changes what later bullets can hit, so the outcomes are applied in order.
+		for(std::size_t i = 0;i < count;i += 1) {
+			if(!on_screen[i]) {
+				bullets.destroyed[i] = 1;
 				continue;
 			}
 
-			if(!eagle.destroyed && bullet_rect.overlaps(eagle_rect)) {
+			Vec2 position = {bullets.x[i],bullets.y[i]};
+			if(!eagle.destroyed && hits_eagle[i]) {
 				add_explosion(eagle.position,delta_time);
+				bullets.destroyed[i] = 1;
+				//The benchmark keeps its targets alive so every run keeps exercising the same systems.
+				if(scene == Scene::Stress_Benchmark) continue;
 				eagle.destroyed = true;
-				bullet.destroyed = true;
-				game_lose_timer = 1.0f;
 				continue;
 			}
 
-			for(auto player : {&first_player,&second_player}) {
-				Rect player_rect = {player->tank.position.x - Tank_Size.x / 2.0f,player->tank.position.y - Tank_Size.y / 2.0f,1.0f,1.0f};
-				if(!player->tank.destroyed && bullet_rect.overlaps(player_rect) && !bullet.fired_by_player) {
+			for(std::size_t j = 0;j < 2;j += 1) {
+				auto player = players[j];
+				if(!player->tank.destroyed && hits_player[j][i] && !bullets.fired_by_player[i]) {
 					add_explosion(player->tank.position,delta_time);
-					bullet.destroyed = true;
-					if(player->invulnerability_timer <= 0.0f) {
+					bullets.destroyed[i] = 1;
+					if(!player->invulnerable) {
 						player->tank.destroyed = true;
-						player->respawn_timer = 2.0f;
+						//Only players taking part respawn, the second one stays as it is in single player games.
+						bool playing = player == &first_player || scene == Scene::Game_2player;
+						if(player->lifes > 0 && playing) timers.schedule(core::seconds_to_ticks(Player_Respawn_Time),{std::uint32_t(Timer_Kind::Player_Respawn),std::uint32_t(player == &second_player)});
 					}
 					break;
 				}
 			}
-			if(bullet.destroyed) continue;
-
-			for(auto& enemy_tank : enemy_tanks) {
-				Rect enemy_rect = {enemy_tank.position.x - Tank_Size.x / 2.0f,enemy_tank.position.y - Tank_Size.y / 2.0f,1.0f,1.0f};
-				if(bullet_rect.overlaps(enemy_rect) && bullet.fired_by_player) {
-					add_explosion(enemy_tank.position,delta_time);
-					enemy_tank.destroyed = true;
-					bullet.destroyed = true;
-					break;
+			if(bullets.destroyed[i]) continue;
+
+			//Only player bullets hurt enemies, so the enemy boxes are only built once one is in flight.
+			if(bullets.fired_by_player[i]) {
+				if(!enemy_boxes_built) {
+					enemy_boxes.resize(enemy_tanks.size());
+					for(std::size_t j = 0;j < enemy_tanks.size();j += 1) {
+						enemy_boxes.min_x[j] = enemy_tanks[j].position.x - Tank_Size.x / 2.0f;
+						enemy_boxes.min_y[j] = enemy_tanks[j].position.y - Tank_Size.y / 2.0f;
+						enemy_boxes.max_x[j] = enemy_boxes.min_x[j] + 1.0f;
+						enemy_boxes.max_y[j] = enemy_boxes.min_y[j] + 1.0f;
+					}
+					enemy_boxes_built = true;
+				}
+				auto enemy_index = core::first_overlap(enemy_boxes,bullet_boxes[i]);
+				if(enemy_index < enemy_tanks.size()) {
+					add_explosion(enemy_tanks[enemy_index].position,delta_time);
+					enemy_tanks[enemy_index].destroyed = true;
+					bullets.destroyed[i] = 1;
+					continue;
 				}
 			}
-			if(bullet.destroyed) continue;
 
-			std::int32_t start_x = std::int32_t((bullet.position.x - Bullet_Size.x / 2.0f + relative_bounding_box.x) * 2.0f);
-			std::int32_t start_y = std::int32_t((bullet.position.y - Bullet_Size.y / 2.0f + relative_bounding_box.y) * 2.0f);
-			std::int32_t end_x = std::int32_t((bullet.position.x - Bullet_Size.x / 2.0f + relative_bounding_box.x + relative_bounding_box.width) * 2.0f);
-			std::int32_t end_y = std::int32_t((bullet.position.y - Bullet_Size.y / 2.0f + relative_bounding_box.y + relative_bounding_box.height) * 2.0f);
+			auto dir = Entity_Direction(bullets.dir[i]);
+			auto box = bullet_boxes[i];
+			std::int32_t start_x = std::int32_t(box.min_x * 2.0f);
+			std::int32_t start_y = std::int32_t(box.min_y * 2.0f);
+			std::int32_t end_x = std::int32_t(box.max_x * 2.0f);
+			std::int32_t end_y = std::int32_t(box.max_y * 2.0f);
 
-			auto collision_status = check_collision_with_tiles(&bullet.position,Bullet_Size,start_x,start_y,end_x,end_y,bullet.dir,true);
+			auto collision_status = check_collision_with_tiles(&position,Bullet_Size,start_x,start_y,end_x,end_y,dir,true);
 			if(collision_status.has_value()) {
 				auto coords = collision_status.value();
-				auto& tile = tiles[coords.y * (Background_Tile_Count_X * 2) + coords.x];
-
-				bullet.destroyed = true;
-				if(tile.health == 0) tile.template_index = Invalid_Tile_Index;
-				else tile.health -= 1;
-				switch(bullet.dir) {
-					case Entity_Direction::Right: { add_explosion(bullet.position + Vec2{0.5f,0.0f},delta_time); break; }
-					case Entity_Direction::Down: { add_explosion(bullet.position + Vec2{0.0f,0.5f},delta_time); break; }
-					case Entity_Direction::Left: { add_explosion(bullet.position - Vec2{0.5f,0.0f},delta_time); break; }
-					case Entity_Direction::Up: { add_explosion(bullet.position - Vec2{0.0f,0.5f},delta_time); break; }
+				bullets.destroyed[i] = 1;
+				tiles.damage(coords.x,coords.y);
+				//Only destroying a tile changes its cost, and only ever makes it cheaper. A full list is left for a rebuild rather than grown during the match.
+				if(Tile_Grid::empty(tiles.cell(coords.x,coords.y))) {
+					if(navigation_changed_cells.size() < navigation_changed_cells.capacity()) navigation_changed_cells.push_back(coords);
+					else navigation_dirty = true;
+				}
+				switch(dir) {
+					case Entity_Direction::Right: { add_explosion(position + Vec2{0.5f,0.0f},delta_time); break; }
+					case Entity_Direction::Down: { add_explosion(position + Vec2{0.0f,0.5f},delta_time); break; }
+					case Entity_Direction::Left: { add_explosion(position - Vec2{0.5f,0.0f},delta_time); break; }
+					case Entity_Direction::Up: { add_explosion(position - Vec2{0.0f,0.5f},delta_time); break; }
 				}
 			}
 		}
-		std::erase_if(bullets,[](const Bullet& bullet) { return bullet.destroyed; });
+		bullets.remove_destroyed();
 	}
 
 	void Game::update(float delta_time) {
+		finish_allocation_frame();
+		allocation_frame_steady = false;
+		frame_arena.reset();
+		for(const auto& file_path : file_watcher.take_changed_files()) hot_reload(file_path);
+		file_io.dispatch_completions();
 		if(platform->was_key_pressed(Keycode::F3)) show_fps = !show_fps;
+		if(platform->was_key_pressed(Keycode::F4)) enemy_planner_enabled = !enemy_planner_enabled;
 		switch(scene) {
 			case Scene::Main_Menu: {
 				if(platform->is_key_down(Keycode::Escape))load_map("./assets/maps/map_menu.txt");
@@ -552,6 +1535,7 @@ namespace core {
 						case 0: {
 							current_stage_index = 0;
 							first_player.lifes = Player_Starting_Life_Count;
+							horde_mode = false;
 							scene = Scene::Intro_1player;
 							break;
 						}
@@ -559,22 +1543,30 @@ namespace core {
 							current_stage_index = 0;
 							first_player.lifes = Player_Starting_Life_Count;
 							second_player.lifes = Player_Starting_Life_Count;
+							horde_mode = false;
 							scene = Scene::Intro_2player;
 							break;
 						}
 						case 2: {
+							current_stage_index = 0;
 							first_player.lifes = Player_Starting_Life_Count;
-							scene = Scene::Level_Selection;
+							horde_mode = true;
+							scene = Scene::Intro_1player;
 							break;
 						}
 						case 3: {
-							for(std::uint32_t y = 0;y < Background_Tile_Count_Y * 2;y += 1) {
-								for(std::uint32_t x = 0;x < Background_Tile_Count_X * 2;x += 1) {
-									tiles[y * (Background_Tile_Count_X * 2) + x] = Tile{Invalid_Tile_Index};
-								}
-							}
+							first_player.lifes = Player_Starting_Life_Count;
+							horde_mode = false;
+							scene = Scene::Level_Selection;
+							break;
+						}
+						case 4: {
+							//The new map replaces a streamed one, whose changes are written back first.
+							map_stream.close();
+							tiles.resize(Tile_Grid::Default_Width,Tile_Grid::Default_Height,tile_layout);
+							construction_camera = {};
 							eagle.destroyed = false;
-							eagle.position = {Background_Tile_Count_X / 2.0f,Background_Tile_Count_Y - 2.0f};
+							eagle.position = default_eagle_position();
 							first_player.tank.destroyed = false;
 							first_player.tank.dir = Entity_Direction::Up;
 							first_player.tank.position = eagle.position - Vec2{3.0f,0.0f};
@@ -583,12 +1575,17 @@ namespace core {
 							second_player.tank.position = eagle.position + Vec2{3.0f,0.0f};
 							bullets.clear();
 							enemy_tanks.clear();
+							enemy_ids.clear();
+							enemy_ai_scheduler.clear();
 							spawn_effects.clear();
 							explosions.clear();
+							construction_map_dirty = false;
+							construction_autosave_dirty = false;
+							autosave_timer = Autosave_Interval;
 							scene = Scene::Construction;
 							break;
 						}
-						case 4: {
+						case 5: {
 							quit = true;
 							break;
 						}
@@ -603,23 +1600,31 @@ namespace core {
 					break;
 				}
 
+				//The stage's map is read in the background while the intro screen is being shown.
+				if(skip && !intro_map_requested) {
+					intro_map_requested = true;
+					request_map(streamed_map_path.empty() ? Stage_Map_File_Paths[current_stage_index] : streamed_map_path.c_str());
+				}
+
 				update_timer += delta_time;
 				static constexpr float Intro_Screen_Duration = 2.5f;
-				if(update_timer >= Intro_Screen_Duration) {
+				if(update_timer >= Intro_Screen_Duration && !map_load_pending) {
 					update_timer = 0.0f;
-					if (skip) {
-						switch (current_stage_index) {
-						case 0: load_map("./assets/maps/map1.txt"); break;
-						case 1: load_map("./assets/maps/map2.txt"); break;
-						case 2: load_map("./assets/maps/map3.txt"); break;
-						case 3: load_map("./assets/maps/map4.txt"); break;
-						case 4: load_map("./assets/maps/map5.txt"); break;
-						}
-					}
+					intro_map_requested = false;
 					eagle.destroyed = false;
-					eagle.position = {Background_Tile_Count_X / 2.0f,Background_Tile_Count_Y - 2.0f};
-
-					if(scene == Scene::Intro_1player) {
+					eagle.position = default_eagle_position();
+
+					enemy_spawn_batch_size = 1;
+					enemy_spawn_interval = Enemy_Spawn_Time;
+					max_bullet_count = Default_Max_Bullet_Count;
+					if(horde_mode) {
+						max_enemy_count_on_screen = horde_settings.max_enemy_count_on_screen;
+						remaining_enemy_count_to_spawn = horde_settings.enemy_count_to_spawn;
+						max_bullet_count = horde_settings.max_bullet_count;
+						enemy_spawn_batch_size = horde_settings.spawn_batch_size;
+						enemy_spawn_interval = horde_settings.spawn_interval;
+					}
+					else if(scene == Scene::Intro_1player) {
 						max_enemy_count_on_screen = 3;
 						remaining_enemy_count_to_spawn = 12;
 					}
@@ -627,20 +1632,23 @@ namespace core {
 						max_enemy_count_on_screen = 4;
 						remaining_enemy_count_to_spawn = 16;
 					}
-					enemy_spawn_timer = Enemy_Spawn_Time;
-					game_win_timer = 1.0f;
-					game_lose_timer = 1.0f;
+					enemy_spawner_locations.clear();
+					reserve_entity_pools();
 
 					bullets.clear();
 					enemy_tanks.clear();
+					enemy_ids.clear();
+					enemy_ai_scheduler.clear();
 					spawn_effects.clear();
 					explosions.clear();
+					timers.clear();
+					timer_tick_fraction = 0.0;
+					timers.schedule(core::seconds_to_ticks(Enemy_Spawn_Time),{std::uint32_t(Timer_Kind::Enemy_Spawn),Game_Entity_Id});
 
 					first_player.tank.destroyed = false;
 					first_player.tank.dir = Entity_Direction::Up;
 					first_player.tank.position = eagle.position - Vec2{3.0f,0.0f};
-					first_player.invulnerability_timer = 0.0f;
-					first_player.respawn_timer = 0.0f;
+					first_player.invulnerable = false;
 					if(scene == Scene::Intro_1player) {
 						scene = Scene::Game_1player;
 					}
@@ -648,8 +1656,7 @@ namespace core {
 						second_player.tank.destroyed = false;
 						second_player.tank.dir = Entity_Direction::Up;
 						second_player.tank.position = eagle.position + Vec2{3.0f,0.0f};
-						second_player.invulnerability_timer = 0.0f;
-						second_player.respawn_timer = 0.0f;
+						second_player.invulnerable = false;
 						scene = Scene::Game_2player;
 					}
 				}
@@ -663,31 +1670,24 @@ namespace core {
 					break;
 				}
 
+				simulation_tick += 1;
+				update_map_stream();
+				update_timers(delta_time);
+				//A timer may have ended the stage.
+				if(scene != Scene::Game_1player && scene != Scene::Game_2player) break;
 				update_player(&first_player,delta_time);
 				if(scene == Scene::Game_2player) update_player(&second_player,delta_time);
 
+				auto bullets_start = std::chrono::steady_clock::now();
 				update_bullets(delta_time);
+				frame_timings.bullets = std::chrono::steady_clock::now() - bullets_start;
 				update_enemies(delta_time);
 
-				for(auto& effect : spawn_effects) {
-					if(effect.current_frame >= Spawn_Effect_Layer_Count) continue;
-					effect.timer -= delta_time;
-					if(effect.timer <= 0.0f) {
-						effect.timer = Spawn_Effect_Frame_Duration;
-						effect.current_frame += 1;
-					}
-				}
-				std::erase_if(spawn_effects,[](const Spawn_Effect& effect) { return effect.current_frame >= Spawn_Effect_Layer_Count; });
-
 				bool first_player_lost = first_player.tank.destroyed && first_player.lifes == 0;
 				bool second_player_lost = second_player.tank.destroyed && second_player.lifes == 0;
 				bool lose_cond = (scene == Scene::Game_1player) ? (first_player_lost) : (first_player_lost && second_player_lost);
-				if(eagle.destroyed || lose_cond) {
-					game_lose_timer -= delta_time;
-					if(game_lose_timer <= 0.0f) {
-						game_lose_timer = 0.0f;
-						scene = ((scene == Scene::Game_1player) ? Scene::Game_Over_1player : Scene::Game_Over_2player);
-					}
+				if((eagle.destroyed || lose_cond) && !timers.pending(game_lose_timer)) {
+					game_lose_timer = timers.schedule(core::seconds_to_ticks(Game_End_Delay),{std::uint32_t(Timer_Kind::Game_Lost),Game_Entity_Id});
 				}
 				break;
 			}
@@ -714,12 +1714,12 @@ namespace core {
 							if (current_map_option == 0) current_map_option = Map_Options_Count;
 							current_map_option -= 1;
 							switch (current_map_option) {
-							case 0: load_map("./assets/maps/map1.txt"); break;
-							case 1: load_map("./assets/maps/map2.txt"); break;
-							case 2: load_map("./assets/maps/map3.txt"); break;
-							case 3: load_map("./assets/maps/map4.txt"); break;
-							case 4: load_map("./assets/maps/map5.txt"); break;
-							case 5: load_map("./assets/maps/map_menu.txt"); break;
+							case 0: request_map("./assets/maps/map1.txt"); break;
+							case 1: request_map("./assets/maps/map2.txt"); break;
+							case 2: request_map("./assets/maps/map3.txt"); break;
+							case 3: request_map("./assets/maps/map4.txt"); break;
+							case 4: request_map("./assets/maps/map5.txt"); break;
+							case 5: request_map("./assets/maps/map_menu.txt"); break;
 							default: printf("Something is very worng");
 							}
 							update_timer = 0;
@@ -728,12 +1728,12 @@ namespace core {
 							current_map_option += 1;
 							if (current_map_option > Map_Options_Count) current_map_option = 0;
 							switch (current_map_option) {
-							case 0: load_map("./assets/maps/map1.txt"); break;
-							case 1: load_map("./assets/maps/map2.txt"); break;
-							case 2: load_map("./assets/maps/map3.txt"); break;
-							case 3: load_map("./assets/maps/map4.txt"); break;
-							case 4: load_map("./assets/maps/map5.txt"); break;
-							case 5: load_map("./assets/maps/map_menu.txt"); break;
+							case 0: request_map("./assets/maps/map1.txt"); break;
+							case 1: request_map("./assets/maps/map2.txt"); break;
+							case 2: request_map("./assets/maps/map3.txt"); break;
+							case 3: request_map("./assets/maps/map4.txt"); break;
+							case 4: request_map("./assets/maps/map5.txt"); break;
+							case 5: request_map("./assets/maps/map_menu.txt"); break;
 							default: printf("Something is very worng");
 							}
 							update_timer = 0;
@@ -761,30 +1761,48 @@ namespace core {
 				break;
 			};
 			case Scene::Construction: {
+				if(save_status_timer > 0.0f) save_status_timer -= delta_time;
+				autosave_timer -= delta_time;
+				if(autosave_timer <= 0.0f) {
+					autosave_timer = Autosave_Interval;
+					if(construction_autosave_dirty && saves_in_flight == 0) save_map(map_stream.is_open() ? Streamed_Autosave_File_Path : Autosave_File_Path,true);
+				}
+
 				auto mouse_pos = platform->mouse_position();
 				auto dims = renderer->render_client_rect_dimensions();
 				float tile_width = float(dims.width) / float(Background_Tile_Count_X * 2);
 				float tile_height = float(dims.height) / float(Background_Tile_Count_Y * 2);
 
 				if(!construction_choosing_tile) {
-					if(dims.point_inside(mouse_pos)) {
-						construction_marker_pos.x = std::uint32_t(float(mouse_pos.x - dims.x) / tile_width);
-						construction_marker_pos.y = std::uint32_t(float(mouse_pos.y - dims.y) / tile_height);
+					//Maps larger than the screen are scrolled with the arrow keys.
+					if(platform->is_key_down(Keycode::Right)) construction_camera.x += Construction_Scroll_Speed * delta_time;
+					if(platform->is_key_down(Keycode::Down)) construction_camera.y += Construction_Scroll_Speed * delta_time;
+					if(platform->is_key_down(Keycode::Left)) construction_camera.x -= Construction_Scroll_Speed * delta_time;
+					if(platform->is_key_down(Keycode::Up)) construction_camera.y -= Construction_Scroll_Speed * delta_time;
+					construction_camera = camera_position();
+					update_map_stream();
 
-						if(platform->was_key_pressed(Keycode::Mouse_Left)) {
+					if(dims.point_inside(mouse_pos)) {
+						construction_marker_pos.x = std::uint32_t(float(mouse_pos.x - dims.x) / tile_width + construction_camera.x * 2.0f);
+						construction_marker_pos.y = std::uint32_t(float(mouse_pos.y - dims.y) / tile_height + construction_camera.y * 2.0f);
+						//Maps smaller than the screen end before its edge.
+						auto marker_x = std::int32_t(construction_marker_pos.x);
+						auto marker_y = std::int32_t(construction_marker_pos.y);
+						bool marker_on_map = tiles.contains(marker_x,marker_y);
+
+						if(platform->was_key_pressed(Keycode::Mouse_Left) && marker_on_map) {
 							if(construction_current_tile_template_index != Invalid_Tile_Index) {
-								Tile& tile = tiles[construction_marker_pos.y * (Background_Tile_Count_X * 2) + construction_marker_pos.x];
-								tile.template_index = construction_current_tile_template_index;
-								tile.health = tile_templates[tile.template_index].health;
+								auto index = construction_current_tile_template_index;
+								tiles.set(marker_x,marker_y,{index,tile_templates[index].health},tile_templates);
+								construction_map_dirty = construction_autosave_dirty = true;
 							}
 						}
-						if(platform->was_key_pressed(Keycode::Mouse_Right)) {
-							Tile& tile = tiles[construction_marker_pos.y * (Background_Tile_Count_X * 2) + construction_marker_pos.x];
-							tile.template_index = Invalid_Tile_Index;
+						if(platform->was_key_pressed(Keycode::Mouse_Right) && marker_on_map) {
+							tiles.set(marker_x,marker_y,{Invalid_Tile_Index,0},tile_templates);
+							construction_map_dirty = construction_autosave_dirty = true;
 						}
-						if(platform->was_key_pressed(Keycode::Mouse_Middle)) {
-							Tile& tile = tiles[construction_marker_pos.y * (Background_Tile_Count_X * 2) + construction_marker_pos.x];
-							construction_current_tile_template_index = tile.template_index;
+						if(platform->was_key_pressed(Keycode::Mouse_Middle) && marker_on_map) {
+							construction_current_tile_template_index = Tile_Grid::template_index(tiles.cell(marker_x,marker_y));
 						}
 						if(platform->was_key_pressed(Keycode::E)) construction_choosing_tile = true;
 						if(platform->was_key_pressed(Keycode::Escape)) {
@@ -792,16 +1810,8 @@ namespace core {
 							scene = Scene::Main_Menu;
 						}
 						if(platform->was_key_pressed(Keycode::S)) {
-							try {
-								//save_map("./assets/maps/map5.txt");
-								save_map_on_drive();
-							}
-							catch(const File_Open_Exception& except) {
-								char buffer[1024] = {};
-								std::snprintf(buffer,sizeof(buffer) - 1,"Couldn't save file \"%s\".",except.file_path());
-								platform->error_message_box(buffer);
-							}
-							catch(...) { throw; }
+							//save_map("./assets/maps/map5.txt");
+							save_map_on_drive();
 						}
 						if(platform->was_key_pressed(Keycode::L)) {
 							
@@ -820,18 +1830,21 @@ namespace core {
 							
 						}
 						if(platform->was_key_pressed(Keycode::B)) {
-							tiles[0 * (Background_Tile_Count_X * 2) + 0] = Tile{11,std::uint32_t(-1)};
-							tiles[(Background_Tile_Count_Y * 2 - 1) * (Background_Tile_Count_X * 2) + 0] = Tile{14,std::uint32_t(-1)};
-							tiles[0 * (Background_Tile_Count_X * 2) + (Background_Tile_Count_X * 2 - 1)] = Tile{12,std::uint32_t(-1)};
-							tiles[(Background_Tile_Count_Y * 2 - 1) * (Background_Tile_Count_X * 2) + (Background_Tile_Count_X * 2 - 1)] = Tile{13,std::uint32_t(-1)};
-
-							for(std::uint32_t x = 1;x < Background_Tile_Count_X * 2 - 1;x += 1) {
-								tiles[0 * (Background_Tile_Count_X * 2) + x] = Tile{8,std::uint32_t(-1)};
-								tiles[(Background_Tile_Count_Y * 2 - 1) * (Background_Tile_Count_X * 2) + x] = Tile{10,std::uint32_t(-1)};
+							construction_map_dirty = construction_autosave_dirty = true;
+							auto last_x = std::int32_t(tiles.width()) - 1;
+							auto last_y = std::int32_t(tiles.height()) - 1;
+							tiles.set(0,0,{11,std::uint32_t(-1)},tile_templates);
+							tiles.set(0,last_y,{14,std::uint32_t(-1)},tile_templates);
+							tiles.set(last_x,0,{12,std::uint32_t(-1)},tile_templates);
+							tiles.set(last_x,last_y,{13,std::uint32_t(-1)},tile_templates);
+
+							for(std::int32_t x = 1;x < last_x;x += 1) {
+								tiles.set(x,0,{8,std::uint32_t(-1)},tile_templates);
+								tiles.set(x,last_y,{10,std::uint32_t(-1)},tile_templates);
 							}
-							for(std::uint32_t y = 1;y < Background_Tile_Count_Y * 2 - 1;y += 1) {
-								tiles[y * (Background_Tile_Count_X * 2) + 0] = Tile{7,std::uint32_t(-1)};
-								tiles[y * (Background_Tile_Count_X * 2) + (Background_Tile_Count_X * 2 - 1)] = Tile{9,std::uint32_t(-1)};
+							for(std::int32_t y = 1;y < last_y;y += 1) {
+								tiles.set(0,y,{7,std::uint32_t(-1)},tile_templates);
+								tiles.set(last_x,y,{9,std::uint32_t(-1)},tile_templates);
 							}
 						}
 					}
@@ -891,14 +1904,66 @@ namespace core {
 				}
 				break;
 			}
+			case Scene::Stress_Benchmark: {
+				if(platform->was_key_pressed(Keycode::Escape)) {
+					quit = true;
+					break;
+				}
+
+				//The simulation runs at a fixed step, so it goes through the same states no matter how fast the machine is.
+				simulation_tick += 1;
+				update_timers(Stress_Tick_Duration);
+				auto bullets_start = std::chrono::steady_clock::now();
+				update_bullets(Stress_Tick_Duration);
+				frame_timings.bullets = std::chrono::steady_clock::now() - bullets_start;
+				update_enemies(Stress_Tick_Duration);
+
+				//The render time is the one of the previous frame, which was drawn with the same number of enemies.
+				auto& run = stress_runs[current_stress_run];
+				if(stress_run_tick >= Stress_Warmup_Tick_Count) {
+					run.total_timings.navigation += frame_timings.navigation;
+					run.total_timings.line_of_fire += frame_timings.line_of_fire;
+					run.total_timings.enemies += frame_timings.enemies;
+					run.total_timings.bullets += frame_timings.bullets;
+					run.total_timings.render += frame_timings.render;
+					run.total_bullet_count += bullets.size();
+				}
+				stress_run_tick += 1;
+				//Frames that start or finish a run load maps and write the report, they are left out.
+				allocation_frame_steady = stress_run_tick > Stress_Warmup_Tick_Count && stress_run_tick < Stress_Warmup_Tick_Count + Stress_Measured_Tick_Count;
+				if(stress_run_tick >= Stress_Warmup_Tick_Count + Stress_Measured_Tick_Count) {
+					current_stress_run += 1;
+					if(current_stress_run < stress_runs.size()) begin_stress_run();
+					else finish_stress_benchmark();
+				}
+				break;
+			}
 		}
+		update_memory_dump(delta_time);
 	}
 
 	void Game::render(float delta_time) {
+		Allocation_Phase_Scope allocation_phase{Allocation_Phase::Render};
+		auto render_start = std::chrono::steady_clock::now();
+		defer[&]{ frame_timings.render = std::chrono::steady_clock::now() - render_start; };
 		if(show_fps) {
 			char buffer[64] = {};
 			std::snprintf(buffer,sizeof(buffer) - 1,"FPS: %f",1.0f / delta_time);
 			renderer->draw_text({0.125f,0.125f,1},{0.25f,0.25f},{1,1,1},buffer);
+			if constexpr(Allocation_Tracking_Enabled) {
+				std::snprintf(buffer,sizeof(buffer) - 1,"Allocations: %" PRIu64 " (%" PRIu64 " bytes)",previous_frame_allocations.count,previous_frame_allocations.byte_count);
+				renderer->draw_text({0.125f,0.375f,1},{0.25f,0.25f},{1,1,1},buffer);
+			}
+			//Kibibytes, lines drawn below the frame rate and allocations.
+			auto report = memory_report();
+			float y = Allocation_Tracking_Enabled ? 0.625f : 0.375f;
+			std::snprintf(buffer,sizeof(buffer) - 1,"Memory: %zu KiB CPU, %zu KiB GPU",report.cpu_bytes() / 1024,report.gpu_bytes() / 1024);
+			renderer->draw_text({0.125f,y,1},{0.25f,0.25f},{1,1,1},buffer);
+			for(std::size_t i = 0;i < std::size_t(Memory_Tag::Count);i += 1) {
+				y += 0.25f;
+				std::snprintf(buffer,sizeof(buffer) - 1,"%s: %zu KiB",core::memory_tag_name(Memory_Tag(i)),report.bytes(Memory_Tag(i)) / 1024);
+				renderer->draw_text({0.125f,y,1},{0.1875f,0.1875f},{1,1,1},buffer);
+			}
 		}
 		switch(scene) {
 			case Scene::Main_Menu: {
@@ -935,32 +2000,30 @@ namespace core {
 				break;
 			}
 			case Scene::Game_1player:
-			case Scene::Game_2player: {
+			case Scene::Game_2player:
+			case Scene::Stress_Benchmark: {
+				renderer->set_camera(camera_position());
 				render_map();
-				for(const auto& bullet : bullets) {
-					renderer->draw_sprite({bullet.position.x,bullet.position.y},{1.0f,1.0f},core::entity_direction_to_rotation(bullet.dir),entity_sprites,Bullet_Sprite_Layer_Index);
+				for(std::size_t i = 0;i < bullets.size();i += 1) {
+					renderer->draw_sprite({bullets.x[i],bullets.y[i]},{1.0f,1.0f},core::entity_direction_to_rotation(Entity_Direction(bullets.dir[i])),entity_sprites,Bullet_Sprite_Layer_Index);
 				}
-				for(auto& explosion : explosions) {
-					if(explosion.sprite_index != -1) renderer->draw_sprite(explosion.position,explosion.size,0,explosion_sprite,explosion.sprite_index);
-					explosion.sprite_index = 8 * explosion.texture_serie + (7 - (int)(explosion.timer * 8));
-					explosion.timer -= delta_time;
-					if(explosion.timer < 0) {
-						explosion.destroyed = 1;
-					}
+				for(const auto& explosion : explosions) {
+					auto elapsed = double(timers.now() - explosion.start_tick) / Timer_Ticks_Per_Second;
+					auto frame = std::min(int(elapsed / double(Explosion_Duration) * 8.0),7);
+					renderer->draw_sprite(explosion.position,explosion.size,0,explosion_sprite,8 * explosion.texture_serie + frame);
 				}
-				std::erase_if(explosions,[](const Explosion& explosion) { return explosion.destroyed; });
 
 				if(!eagle.destroyed) renderer->draw_sprite({eagle.position.x,eagle.position.y,0.5f},Eagle_Size,0.0f,entity_sprites,Eagle_Sprite_Layer_Index);
 
 				if(!first_player.tank.destroyed) {
 					auto rotation = core::entity_direction_to_rotation(first_player.tank.dir);
-					bool is_protected = first_player.invulnerability_timer > 0.0f;
+					bool is_protected = first_player.invulnerable;
 					renderer->draw_sprite({first_player.tank.position.x,first_player.tank.position.y,0.5f},Tank_Size,rotation,{1,1,1,1},is_protected,entity_sprites,Player_Tank_Sprite_Layer_Index);
 					if(is_protected) renderer->draw_sprite({first_player.tank.position.x,first_player.tank.position.y,0.5f},Tank_Size,rotation,construction_place_marker);
 				}
 				if(scene == Scene::Game_2player && !second_player.tank.destroyed) {
 					auto rotation = core::entity_direction_to_rotation(second_player.tank.dir);
-					bool is_protected = second_player.invulnerability_timer > 0.0f;
+					bool is_protected = second_player.invulnerable;
 					renderer->draw_sprite({second_player.tank.position.x,second_player.tank.position.y,0.5f},Tank_Size,rotation,{1,1,1,1},is_protected,entity_sprites,Second_Player_Tank_Sprite_Layer_Index);
 					if(is_protected) renderer->draw_sprite({second_player.tank.position.x,second_player.tank.position.y,0.5f},Tank_Size,rotation,construction_place_marker);
 				}
@@ -969,8 +2032,10 @@ namespace core {
 					renderer->draw_sprite({enemy_tank.position.x,enemy_tank.position.y,0.5f},Tank_Size,core::entity_direction_to_rotation(enemy_tank.dir),entity_sprites,Enemy_Tank_Sprite_Layer_Index);
 				}
 				for(const auto& effect : spawn_effects) {
-					renderer->draw_sprite({effect.position.x,effect.position.y,0.9f},{1,1},0,spawn_effect_sprite_atlas,effect.current_frame);
+					auto frame = std::min(std::uint32_t((timers.now() - effect.start_tick) / core::seconds_to_ticks(Spawn_Effect_Frame_Duration)),Spawn_Effect_Layer_Count - 1);
+					renderer->draw_sprite({effect.position.x,effect.position.y,0.9f},{1,1},0,spawn_effect_sprite_atlas,frame);
 				}
+				renderer->set_camera({});
 
 				renderer->draw_sprite({0.25f,Background_Tile_Count_Y - 0.25f,1.0f},{0.5f,0.5f},0,entity_sprites,Player_Tank_Sprite_Layer_Index);
 				char text_buffer[32] = {};
@@ -987,6 +2052,14 @@ namespace core {
 				renderer->draw_sprite({8.25f,Background_Tile_Count_Y - 0.25f,1.0f},{0.5f,0.5f},0,entity_sprites,Enemy_Tank_Sprite_Layer_Index);
 				count = std::snprintf(text_buffer,sizeof(text_buffer) - 1,"x%" PRIu32,remaining_enemy_count_to_spawn);
 				if(count > 0) renderer->draw_text({8.75f,Background_Tile_Count_Y - 0.25f,1.0f},{0.5f,0.5f},{1,1,1},text_buffer);
+
+				if(enemy_planner_enabled) renderer->draw_text({Background_Tile_Count_X - 2.5f,Background_Tile_Count_Y - 0.375f,1.0f},{0.25f,0.25f},{1,1,0},"AI planner");
+				if(scene == Scene::Stress_Benchmark && current_stress_run < stress_runs.size()) {
+					char stress_buffer[128] = {};
+					count = std::snprintf(stress_buffer,sizeof(stress_buffer) - 1,"Stress benchmark: run %zu/%zu, %zu enemies, %zu bullets",
+										  current_stress_run + 1,stress_runs.size(),enemy_tanks.size(),bullets.size());
+					if(count > 0) renderer->draw_text({0.125f,0.5f,1.0f},{0.25f,0.25f},{1,1,0},stress_buffer);
+				}
 				break;
 			}
 			case Scene::Outro_1player:
@@ -1008,8 +2081,9 @@ namespace core {
 			}
 			case Scene::Construction: {
 				if(!construction_choosing_tile) {
+					renderer->set_camera(camera_position());
 					render_map();
-					for(const auto& pos : Enemy_Spawner_Locations) {
+					for(const auto& pos : core::default_enemy_spawner_locations(map_size().x)) {
 						renderer->draw_sprite({pos.x,pos.y,0.9f},{1.0f,1.0f},0.0f,spawn_effect_sprite_atlas,3);
 					}
 
@@ -1017,6 +2091,10 @@ namespace core {
 					renderer->draw_sprite({first_player.tank.position.x,first_player.tank.position.y,0.5f},Tank_Size,0.0f,entity_sprites,Player_Tank_Sprite_Layer_Index);
 					renderer->draw_sprite({second_player.tank.position.x,second_player.tank.position.y,0.5f},Tank_Size,0.0f,entity_sprites,Second_Player_Tank_Sprite_Layer_Index);
 					renderer->draw_sprite({float(construction_marker_pos.x) * 0.5f + 0.25f,float(construction_marker_pos.y) * 0.5f + 0.25f,1.0f},{0.5f,0.5f},0,construction_place_marker);
+					renderer->set_camera({});
+					if(saves_in_flight > 0) renderer->draw_text({0.125f,Background_Tile_Count_Y - 0.375f,1.0f},{0.25f,0.25f},{1,1,1},"Saving...");
+					else if(save_status_timer > 0.0f) renderer->draw_text({0.125f,Background_Tile_Count_Y - 0.375f,1.0f},{0.25f,0.25f},{1,1,1},save_status_text);
+					else if(construction_map_dirty) renderer->draw_text({0.125f,Background_Tile_Count_Y - 0.375f,1.0f},{0.25f,0.25f},{1,1,1},"Unsaved changes.");
 				}
 				else {
 					Vec2 offset = {};
@@ -1069,6 +2147,16 @@ namespace core {
 		}
 	}
 
+	void Game::set_tile_layout(Tile_Layout layout) {
+		tile_layout = layout;
+		tiles.change_layout(layout);
+	}
+
+	void Game::set_streamed_map(const char* file_path,std::size_t memory_cap) {
+		streamed_map_path = file_path;
+		streamed_map_memory_cap = memory_cap;
+	}
+
 	bool Game::quit_requested() const noexcept {
 		return quit;
 	}
@@ -1076,53 +2164,219 @@ namespace core {
 	void Game::add_spawn_effect(Vec2 position) {
 		Spawn_Effect effect{};
 		effect.position = position;
-		effect.timer = Spawn_Effect_Frame_Duration;
-		spawn_effects.push_back(effect);
+		effect.start_tick = timers.now();
+		auto handle = spawn_effects.insert(effect);
+		timers.schedule(core::seconds_to_ticks(Spawn_Effect_Frame_Duration) * Spawn_Effect_Layer_Count,core::pool_timer_event(Timer_Kind::Spawn_Effect_Expired,handle));
 	}
 
 	void Game::add_explosion(Vec2 position,float delta_time) {
-		explosions.push_back({{position.x,position.y,0.6f},{1.0f,1.0f},1.0f,0,0,((int)(delta_time * 16384) % 8)});
+		auto handle = explosions.insert({{position.x,position.y,0.6f},{1.0f,1.0f},timers.now(),((int)(delta_time * 16384) % 8)});
+		timers.schedule(core::seconds_to_ticks(Explosion_Duration),core::pool_timer_event(Timer_Kind::Explosion_Expired,handle));
 	}
 
-	void Game::save_map(const char* file_path) {
-		static char name_buffer[256] = {};
-		std::strcpy(name_buffer,file_path);
-
-		std::ofstream file{name_buffer,std::ios::binary};
-		if(!file.is_open()) throw File_Open_Exception(name_buffer);
+	//Autosaves go to their own file, so the map the user is editing stays unsaved. Saving that map makes the autosave pointless though.
+	static void clear_save_flags(bool autosave,bool* map_dirty,bool* autosave_dirty) noexcept {
+		*autosave_dirty = false;
+		if(!autosave) *map_dirty = false;
+	}
 
-		for(std::uint32_t y = 0;y < Background_Tile_Count_Y * 2;y += 1) {
-			for(std::uint32_t x = 0;x < Background_Tile_Count_X * 2;x += 1) {
-				const auto& tile = tiles[y * (Background_Tile_Count_X * 2) + x];
-				file << tile.template_index << " " << tile.health;
-				if((x + 1) < (Background_Tile_Count_X * 2)) file << " ";
+	void Game::save_map(const char* file_path,bool autosave) {
+		bool streamed = core::is_streamed_map_path(file_path);
+		auto save_key = core::normalized_file_path(file_path);
+		if(map_stream.is_open()) {
+			//Most of a streamed map is only in its file, it can't be converted to the text format without loading all of it.
+			if(!streamed) {
+				char buffer[1024] = {};
+				std::snprintf(buffer,sizeof(buffer) - 1,"Couldn't save file \"%s\", streamed maps are saved as \"%s\" files.",file_path,Map_Stream::File_Extension);
+				platform->error_message_box(buffer);
+				return;
+			}
+			//The stream edits its own file in place, saving over it only has to write the modified chunks back.
+			if(save_key == core::normalized_file_path(map_stream.path().c_str())) {
+				map_stream.flush();
+				core::clear_save_flags(autosave,&construction_map_dirty,&construction_autosave_dirty);
+				save_status_text = autosave ? "Autosaved." : "Map saved.";
+				save_status_timer = Save_Status_Duration;
+				return;
 			}
-			file << "\n";
 		}
-		return;
+		saves_in_flight += 1;
+		map_saves[save_key].in_flight += 1;
+		core::clear_save_flags(autosave,&construction_map_dirty,&construction_autosave_dirty);
+		auto on_written = [this,autosave,save_key](File_Completion& completion) {
+			saves_in_flight -= 1;
+			auto& record = map_saves[save_key];
+			record.in_flight -= 1;
+			if(completion.succeeded()) {
+				std::error_code error_code{};
+				record.write_time = std::filesystem::last_write_time(completion.file_path,error_code);
+				save_status_text = autosave ? "Autosaved." : "Map saved.";
+				save_status_timer = Save_Status_Duration;
+				return;
+			}
+			//The map has to be written again since it didn't reach the drive.
+			if(autosave) construction_autosave_dirty = true;
+			else construction_map_dirty = construction_autosave_dirty = true;
+			char buffer[1024] = {};
+			std::snprintf(buffer,sizeof(buffer) - 1,"Couldn't save file \"%s\".",completion.file_path.c_str());
+			platform->error_message_box(buffer);
+		};
+		//Chunks of a streamed map may be evicted and written back to its file while a worker reads them, so its copy is taken right away.
+		if(map_stream.is_open()) {
+			file_io.submit_write(file_path,map_stream.snapshot(),on_written);
+			return;
+		}
+		//The editor keeps running while the snapshot is encoded and written on a worker thread.
+		auto snapshot = std::make_shared<const Tile_Grid>(tiles);
+		file_io.submit_write(file_path,[snapshot,streamed]{ return streamed ? Map_Stream::encode(*snapshot) : core::encode_map(*snapshot); },on_written);
 	}
 
 	void Game::load_map(const char* file_path) {
-		static char name_buffer[256] = {};
-		std::strcpy(name_buffer,file_path);
+		file_io.wait(request_map(file_path));
+	}
 
-		std::ifstream file{name_buffer,std::ios::binary};
-		if(!file.is_open()) throw File_Open_Exception(name_buffer);
+	File_Request_Id Game::request_map(const char* file_path,bool reload) {
+		//Modified chunks of a streamed map are written back before another map replaces it.
+		map_stream.close();
+		if(core::is_streamed_map_path(file_path)) {
+			//Opening only maps the file, chunks are loaded as the match needs them. The file isn't watched, the stream writes to it itself.
+			map_stream.open(file_path,&tiles,streamed_map_memory_cap);
+			//Every chunk is listed at most once per stream update, more than that between two navigation updates rebuilds the fields.
+			navigation_changed_chunks.clear();
+			navigation_changed_chunks.reserve(std::size_t(tiles.chunk_columns()) * tiles.chunk_rows());
+			current_map_path = file_path;
+			map_load_pending = false;
+			//Completions of maps requested earlier are ignored, request ids start at 1.
+			latest_map_request = 0;
+			navigation_dirty = true;
+			acquire_level_sprites();
+			request_behaviour(core::behaviour_path_for_map(file_path));
+			return latest_behaviour_request;
+		}
+		map_load_pending = true;
+		current_map_path = file_path;
+		file_watcher.watch(file_path);
+
+		//The map is parsed on the worker thread and swapped into 'tiles' between frames.
+		auto parsed_tiles = std::make_shared<Tile_Grid>();
+		latest_map_request = file_io.submit_read(file_path,[this,parsed_tiles,reload](File_Completion& completion) {
+			//A newer map may have been requested while this one was being read.
+			if(completion.id != latest_map_request) return;
+			map_load_pending = false;
+			if(!completion.succeeded()) {
+				//The file may be caught in the middle of being saved. The next write will trigger another reload.
+				if(!reload) core::throw_file_completion_error(completion);
+				std::cerr << "[Hot reload] Couldn't reload \"" << completion.file_path << "\"." << std::endl;
+				return;
+			}
+			tiles = std::move(*parsed_tiles);
+			//Otherwise the templates fill in the flags once they are loaded.
+			if(tile_templates_loaded) tiles.refresh_templates(tile_templates);
+			navigation_dirty = true;
+		},[parsed_tiles,layout = tile_layout](File_Completion& completion) {
+			*parsed_tiles = core::parse_map(completion.data,layout);
+		});
+		//The level stays the same, so do its sprites and its behaviour, which is watched on its own.
+		if(reload) return latest_map_request;
+		acquire_level_sprites();
+		request_behaviour(core::behaviour_path_for_map(file_path));
+		return latest_map_request;
+	}
 
-		for(std::uint32_t y = 0;y < Background_Tile_Count_Y * 2;y += 1) {
-			for(std::uint32_t x = 0;x < Background_Tile_Count_X * 2;x += 1) {
-				auto& tile = tiles[y * (Background_Tile_Count_X * 2) + x];
-				file >> tile.template_index >> tile.health;
+	void Game::request_behaviour(const std::string& file_path) {
+		current_behaviour_path = file_path;
+		file_watcher.watch(file_path.c_str());
+
+		//Compiled on the worker thread, a behaviour that doesn't compile leaves the map with the built-in AI.
+		auto program = std::make_shared<Behaviour_Program>();
+		latest_behaviour_request = file_io.submit_read(file_path.c_str(),[this,program](File_Completion& completion) {
+			if(completion.id != latest_behaviour_request) return;
+			if(!completion.succeeded()) {
+				if(completion.error != File_Completion::Error::Open) std::cerr << "[Behaviour] Couldn't load \"" << completion.file_path << "\", using the built-in AI." << std::endl;
+				enemy_behaviour.reset();
+				return;
 			}
+			enemy_behaviour = std::move(*program);
+		},[program](File_Completion& completion) {
+			*program = Behaviour_Program::compile(completion.data);
+		});
+	}
+
+	void Game::hot_reload(const std::string& file_path) {
+		for(const auto& asset : hot_reload_sprites) {
+			if(file_path != asset.file_path) continue;
+			auto image = std::make_shared<Decoded_Image>();
+			file_io.submit_read(asset.file_path,[this,asset,image](File_Completion& completion) {
+				//The file may be caught in the middle of being saved. The next write will trigger another reload.
+				if(!completion.succeeded()) {
+					std::cerr << "[Hot reload] Couldn't reload \"" << completion.file_path << "\"." << std::endl;
+					return;
+				}
+				renderer->reload_sprite(*asset.sprite,*image);
+			},[image,tile_dimension = asset.tile_dimension](File_Completion& completion) {
+				*image = Renderer::decode_image(completion.file_path.c_str(),completion.data.data(),completion.data.size(),tile_dimension);
+			});
+			return;
+		}
+		if(file_path == Tiles_Info_File_Path) {
+			auto templates = std::make_shared<std::vector<Tile_Template>>();
+			file_io.submit_read(Tiles_Info_File_Path,[this,templates](File_Completion& completion) {
+				if(!completion.succeeded()) {
+					std::cerr << "[Hot reload] Couldn't reload \"" << completion.file_path << "\"." << std::endl;
+					return;
+				}
+				tile_templates = std::move(*templates);
+				tile_templates_loaded = true;
+				//Tiles that refer to templates which no longer exist are cleared.
+				tiles.refresh_templates(tile_templates);
+				if(construction_current_tile_template_index >= tile_templates.size()) construction_current_tile_template_index = Invalid_Tile_Index;
+				navigation_dirty = true;
+			},[templates](File_Completion& completion) {
+				*templates = core::parse_tile_templates(completion.data);
+			});
+			return;
+		}
+		if(file_path == Horde_Settings_File_Path) {
+			auto settings = std::make_shared<Horde_Settings>();
+			file_io.submit_read(Horde_Settings_File_Path,[this,settings](File_Completion& completion) {
+				if(!completion.succeeded()) {
+					std::cerr << "[Hot reload] Couldn't reload \"" << completion.file_path << "\"." << std::endl;
+					return;
+				}
+				//Takes effect from the next stage on.
+				horde_settings = *settings;
+			},[settings](File_Completion& completion) {
+				*settings = core::parse_horde_settings(completion.data);
+			});
+			return;
+		}
+		if(file_path == current_behaviour_path) {
+			request_behaviour(file_path);
+			return;
+		}
+		if(file_path != current_map_path) return;
+		//The notification may come from a save of the editor, reloading then would throw away whatever was edited after it started.
+		if(auto found = map_saves.find(core::normalized_file_path(file_path.c_str()));found != map_saves.end()) {
+			std::error_code error_code{};
+			if(found->second.in_flight > 0 || std::filesystem::last_write_time(file_path,error_code) == found->second.write_time) return;
 		}
+		//A reload that replaces a first load still in flight has to succeed, otherwise the match would start on the previous level's tiles.
+		request_map(current_map_path.c_str(),!map_load_pending);
 	}
 
 	void Game::render_map() {
-		for(std::uint32_t y = 0;y < Background_Tile_Count_Y * 2;y += 1) {
-			for(std::uint32_t x = 0;x < Background_Tile_Count_X * 2;x += 1) {
-				const Tile& tile = tiles[y * (Background_Tile_Count_X * 2) + x];
-				if(tile.template_index == Invalid_Tile_Index) continue;
-				const auto& tile_template = tile_templates[tile.template_index];
+		//Only the half tiles on screen are drawn, the range is clamped to the map once.
+		auto camera = camera_position();
+		auto first_x = std::int32_t(camera.x * 2.0f);
+		auto first_y = std::int32_t(camera.y * 2.0f);
+		auto end_x = std::min(first_x + std::int32_t(Background_Tile_Count_X * 2) + 1,std::int32_t(tiles.width()));
+		auto end_y = std::min(first_y + std::int32_t(Background_Tile_Count_Y * 2) + 1,std::int32_t(tiles.height()));
+		for(std::int32_t y = first_y;y < end_y;y += 1) {
+			auto row = tiles.cursor(first_x,y);
+			for(std::int32_t x = first_x;x < end_x;x += 1,row.next_x()) {
+				auto cell = row.cell();
+				if(Tile_Grid::empty(cell)) continue;
+				const auto& tile_template = tile_templates[Tile_Grid::template_index(cell)];
 				renderer->draw_sprite({0.25f + x * 0.5f,0.25f + y * 0.5f,core::tile_flag_to_z_order(tile_template.flag)},{0.5f,0.5f},tile_template.rotation,tiles_texture,tile_template.tile_layer_index);
 			}
 		}
@@ -2,11 +2,31 @@
 #define GAME_HPP
 
 #include <list>
+#include <string>
 #include <vector>
-#include <random>
+#include <chrono>
 #include <cstddef>
 #include <optional>
+#include <filesystem>
+#include <unordered_map>
 #include "platform.hpp"
+#include "file_io.hpp"
+#include "file_watcher.hpp"
+#include "flow_field.hpp"
+#include "line_of_fire.hpp"
+#include "ai_scheduler.hpp"
+#include "thread_pool.hpp"
+#include "random.hpp"
+#include "planner.hpp"
+#include "behaviour.hpp"
+#include "timer_wheel.hpp"
+#include "entity_kernels.hpp"
+#include "pool.hpp"
+#include "frame_arena.hpp"
+#include "tile_grid.hpp"
+#include "map_stream.hpp"
+#include "allocation_tracker.hpp"
+#include "memory_telemetry.hpp"
 #include "renderer.hpp"
 
 
@@ -26,33 +46,8 @@ namespace core {
 		Level_Selected,
 		Game_Over_1player,
 		Game_Over_2player,
-		Victory_Screen
-	};
-
-	enum struct Tile_Flag {
-		Solid,
-		Below,
-		Above,
-		Bulletpass
-	};
-	[[nodiscard]] inline float tile_flag_to_z_order(Tile_Flag flag) {
-		switch(flag) {
-			case Tile_Flag::Above: return 0.75f;
-			case Tile_Flag::Bulletpass:
-			case Tile_Flag::Below: return -0.25f;
-			default: return 0.0f;
-		}
-	}
-
-	struct Tile_Template {
-		std::uint32_t tile_layer_index;
-		std::uint32_t health;
-		float rotation;
-		Tile_Flag flag;
-	};
-	struct Tile {
-		std::uint32_t template_index;
-		std::uint32_t health;
+		Victory_Screen,
+		Stress_Benchmark
 	};
 
 	enum class Entity_Direction { Right,Down,Left,Up };
@@ -81,15 +76,38 @@ namespace core {
 		}
 	}
 
+	/*	Level of detail of the enemy AI, enemies far from every target think and move less often.
+		Determinism: the tier is chosen from the state at the start of the tick, and the ticks a reduced enemy is updated on depend only on the tick and the enemy's id.
+		Neither depends on timing or on how the update is split between threads, so the same inputs always give the same game. Decisions granted by 'Ai_Scheduler' update an enemy
+		as well, so under a time budget they are as reproducible as the budget is. The result differs from updating every enemy at full rate, which is the point. */
+	enum class Ai_Lod : std::uint8_t {
+		//Updated every tick, exactly as without level of detail.
+		Full,
+		//Updated every second tick with the time of both ticks integrated in one step.
+		Reduced,
+		//Updated every fourth tick.
+		Distant
+	};
+
 	struct Tank {
 		Vec2 position;
 		Entity_Direction dir;
 		bool destroyed;
-		float shoot_cooldown;
-		float ai_dir_change_timer;
-		float ai_react_timer;
+		//Tick of 'Game::timers' from which the tank may shoot again.
+		std::uint64_t shoot_ready_tick;
+		//Seconds until the next decision, chosen when deciding and scheduled once the decision is applied.
+		float ai_decision_delay;
 		std::uint32_t hop_count_until_shoot;
 		bool ai_wants_to_shoot;
+		//Keys the random streams of the tank as well as its AI requests.
+		std::uint32_t id;
+		//Half tile the tank was last steered in, steering happens again once the tank crosses into another one.
+		Ipoint navigation_cell;
+		Ai_Lod ai_lod;
+		//Time since the last update, integrated at once by enemies that skip ticks.
+		float ai_lod_elapsed;
+		//Keeps the tank at full rate until this tick after it got close to a target or came under fire.
+		std::uint64_t ai_lod_hold_tick;
 	};
 	struct Bullet {
 		Vec2 position;
@@ -97,31 +115,91 @@ namespace core {
 		bool fired_by_player;
 		bool destroyed;
 	};
+	//Bullets stored as structure of arrays, so their per-frame passes run over packed coordinates.
+	struct Bullet_Array {
+		std::vector<float> x;
+		std::vector<float> y;
+		//'Entity_Direction' values.
+		std::vector<std::uint8_t> dir;
+		std::vector<std::uint8_t> fired_by_player;
+		std::vector<std::uint8_t> destroyed;
+
+		//Dense indices of the bullets, which move as others are removed.
+		Pool_Slots slots;
+
+		void reserve(std::size_t capacity);
+		Pool_Handle push_back(const Bullet& bullet);
+		void clear() noexcept;
+		//Drops destroyed bullets, the last bullet takes the place of each dropped one.
+		void remove_destroyed() noexcept;
+		[[nodiscard]] std::size_t size() const noexcept { return x.size(); }
+		[[nodiscard]] std::size_t memory_usage() const noexcept;
+		[[nodiscard]] Bullet operator[](std::size_t index) const noexcept { return {{x[index],y[index]},Entity_Direction(dir[index]),fired_by_player[index] != 0,destroyed[index] != 0}; }
+	};
 	struct Eagle {
 		Vec2 position;
 		bool destroyed;
 	};
+	//Effects are removed by a timer once they played, their frame follows from the tick they started on.
 	struct Spawn_Effect {
 		Vec2 position;
-		std::uint32_t current_frame;
-		float timer;
+		std::uint64_t start_tick;
 	};
 	struct Explosion {
 		Vec3 position;
 		Vec2 size;
-		float timer;
-		int sprite_index;
-		bool destroyed;
+		std::uint64_t start_tick;
 		int texture_serie;
 	};
 	struct Player {
 		Tank tank;
-		float respawn_timer;
 		std::uint32_t lifes;
-		float invulnerability_timer;
+		//Cleared by a timer after respawning.
+		bool invulnerable;
+	};
+	//Finds an enemy by id, the pool moves enemies around as others are removed.
+	struct Enemy_Id_Entry {
+		std::uint32_t id;
+		Pool_Handle handle;
+	};
+	//Result of updating one enemy during the decide phase, committed afterwards in the apply phase.
+	struct Enemy_Update {
+		Tank tank;
+		//An enemy fires at most twice per update, once when deciding on a direction and once afterwards.
+		Bullet bullets[2];
+		std::uint32_t bullet_count;
+		//Enemies skipped by their level of detail this tick stay as they are.
+		bool active;
+		bool decide;
+		std::chrono::nanoseconds decision_time;
+	};
+	//Horde mode limits, read from "./assets/horde.txt". Defaults are used when the file is missing.
+	struct Horde_Settings {
+		std::uint32_t max_enemy_count_on_screen = 500;
+		std::uint32_t enemy_count_to_spawn = 5000;
+		std::uint32_t max_bullet_count = 4096;
+		std::uint32_t spawner_count = 12;
+		//Enemies spawned at once every 'spawn_interval' seconds.
+		std::uint32_t spawn_batch_size = 8;
+		float spawn_interval = 0.5f;
+	};
+	//Time spent in each part of the game during the last frame.
+	struct Frame_Timings {
+		std::chrono::nanoseconds navigation;
+		std::chrono::nanoseconds line_of_fire;
+		std::chrono::nanoseconds enemies;
+		std::chrono::nanoseconds bullets;
+		std::chrono::nanoseconds render;
+	};
+	struct Stress_Run {
+		std::uint32_t enemy_count;
+		Frame_Timings total_timings;
+		std::uint64_t total_bullet_count;
+		//Enemies run the map's behaviour file instead of the built-in AI.
+		bool scripted;
 	};
 	struct Raycast_Outcome {
-		enum class Type { None,Tile,Player1,Player2,Eagle };
+		enum class Type : std::uint8_t { None,Tile,Player1,Player2,Eagle };
 		Type type;
 		Vec2 impact_point;
 		[[nodiscard]] bool hit_target() const noexcept { return type == Type::Player1 || type == Type::Player2 || type == Type::Eagle; }
@@ -132,28 +210,100 @@ namespace core {
 		Game(const Game&) = delete;
 		Game& operator=(const Game&) = delete;
 		Game(Renderer* _renderer,Platform* _platform);
+		~Game();
 
 		void update(float delta_time);
 		void render(float delta_time);
 		[[nodiscard]] bool quit_requested() const noexcept;
+		//Runs the game with 'max_enemy_count' enemies and fewer at a fixed time step without any input, prints the time spent per subsystem and quits.
+		void start_stress_benchmark(std::uint32_t max_enemy_count);
+		//Runs the stress benchmark and quits at the first frame after warming up that allocates, printing what allocated. Needs allocation tracking.
+		void start_allocation_check(std::uint32_t max_enemy_count);
+		[[nodiscard]] bool allocation_check_failed() const noexcept;
+		//Memory held by each subsystem right now, shown by the F3 overlay.
+		[[nodiscard]] Memory_Report memory_report() const noexcept;
+		//Writes 'memory_report' as CSV to 'file_path' every few seconds, replacing the previous report.
+		void set_memory_dump(const char* file_path);
+		//Layout of the tile grid for the loaded map and the ones loaded later.
+		void set_tile_layout(Tile_Layout layout);
+		//Plays every stage on the map in 'file_path', streamed from the drive with at most 'memory_cap' bytes of its chunks in memory.
+		void set_streamed_map(const char* file_path,std::size_t memory_cap);
 	private:
 		void update_player(Player* player,float delta_time);
+		void respawn_player(Player* player);
+		//Advances 'timers' by the time of one tick and handles every timer that fired.
+		void update_timers(float delta_time);
+		[[nodiscard]] std::uint64_t timer_deadline(float seconds) const noexcept;
+		//Zero once 'tick' has passed.
+		[[nodiscard]] float seconds_until(std::uint64_t tick) const noexcept;
+		//Size of the loaded map in tiles.
+		[[nodiscard]] Vec2 map_size() const noexcept;
+		//Bottom middle of the map.
+		[[nodiscard]] Vec2 default_eagle_position() const noexcept;
+		//Top-left corner of the part of the map on screen, in tiles. It follows the first player, or 'construction_camera' in the editor.
+		[[nodiscard]] Vec2 camera_position() const noexcept;
+		//Requests the chunks of a streamed map around the camera and the entities, and prefetches the ones tanks and bullets head into.
+		void update_map_stream();
+		void spawn_enemy(Vec2 position);
+		void spawn_enemy_batch();
+		void update_enemy_spawners();
+		//Sizes the entity pools for the current limits, so they don't allocate during the match.
+		void reserve_entity_pools();
+		void begin_stress_run();
+		void finish_stress_benchmark();
+		//Takes the allocations of the frame that just ended, its update and render, and checks them if the frame was a steady one.
+		void finish_allocation_frame();
+		void update_memory_dump(float delta_time);
 		void update_enemies(float delta_time);
 		void update_bullets(float delta_time);
-		std::optional<Ipoint> check_collision_with_tiles(Vec2* out_position,Vec2 collider_size,std::int32_t start_x,std::int32_t start_y,std::int32_t end_x,std::int32_t end_y,Entity_Direction dir,bool is_bullet = false);
+		void update_navigation();
+		//Looks for the eagle and the players in the directions the tank can turn to. Run through 'enemy_ai_scheduler'.
+		void decide_enemy_direction(Enemy_Update* update) const;
+		void update_enemy(Enemy_Update* update,float delta_time) const;
+		//Picks the level of detail of 'enemy' for this tick and extends its hold.
+		[[nodiscard]] Ai_Lod choose_ai_lod(Tank* enemy) const;
+		//Copies the player bullets into 'frame_arena' sorted by tile row, enemies near them are updated at full rate. The planner reads them too.
+		void collect_player_bullets();
+		//Copies the surroundings of 'enemy' for 'plan_move'.
+		void build_planner_snapshot(const Tank& enemy,Planner_Window* window,Planner_State* state) const;
+		void update_line_of_fire();
+		//Approximates 'raycast' against targets with 'include_bulletpass_tiles' off, answered by 'lines_of_fire' as set up by 'update_line_of_fire'.
+		//Tiles are tested the same way, but targets are sampled at half tile centers rather than along the ray itself,
+		//so a ray passing within a quarter tile of a target's edge can get the other answer.
+		[[nodiscard]] Raycast_Outcome::Type line_of_fire(Vec2 origin,Entity_Direction dir,bool through_tiles) const noexcept;
+		//Direction that brings a tank in 'cell' closer to the nearest target, if any.
+		[[nodiscard]] std::optional<Entity_Direction> navigation_direction(Ipoint cell) const;
+		//Field of the live target closest to 'cell' and the distance to it, or nullptr if no target can be reached.
+		[[nodiscard]] const Flow_Field* nearest_navigation_field(Ipoint cell,std::uint32_t* out_distance) const;
+		//Cost for a tank whose top-left half tile is 'cell', read from the tiles so it holds outside of the navigation window too.
+		[[nodiscard]] std::uint8_t navigation_footprint_cost(Ipoint cell) const;
+		std::optional<Ipoint> check_collision_with_tiles(Vec2* out_position,Vec2 collider_size,std::int32_t start_x,std::int32_t start_y,std::int32_t end_x,std::int32_t end_y,Entity_Direction dir,bool is_bullet = false) const;
 		[[nodiscard]] Raycast_Outcome raycast(Vec2 origin,Entity_Direction dir,bool include_bulletpass_tiles,bool skip_tiles,bool skip_targets);
 
 		void add_spawn_effect(Vec2 position);
 		void add_explosion(Vec2 position,float delta_time);
-		void save_map(const char* file_path);
+		//Doesn't block, the result is reported through 'save_status_text' or an error message box.
+		void save_map(const char* file_path,bool autosave = false);
 		void load_map(const char* file_path);
+		//A failed 'reload' of the current map is only logged and leaves 'tiles' as they are, a failed first load of a level throws.
+		File_Request_Id request_map(const char* file_path,bool reload = false);
+		//Maps without a behaviour file use the built-in AI.
+		void request_behaviour(const std::string& file_path);
+		//Called for every watched file that changed on the drive.
+		void hot_reload(const std::string& file_path);
+		//Takes new references to the sprites of the level about to be played and drops the ones of the previous level.
+		void acquire_level_sprites();
 		void render_map();
 		void load_map_from_drive();
 		void save_map_on_drive();
-		static inline constexpr std::uint32_t Invalid_Tile_Index = std::uint32_t(-1);
+		static inline constexpr std::uint32_t Invalid_Tile_Index = Tile_Grid::Invalid_Template_Index;
+		friend class Enemy_Behaviour_World;
 
 		Renderer* renderer;
 		Platform* platform;
+		Async_File_Io file_io;
+		File_Watcher file_watcher;
+		Thread_Pool simulation_workers;
 		Scene scene;
 		std::size_t current_main_menu_option;
 		std::size_t current_map_option=0;
@@ -165,31 +315,121 @@ namespace core {
 		Sprite_Index spawn_effect_sprite_atlas;
 		Sprite_Index explosion_sprite;
 		Point construction_marker_pos;
+		Vec2 construction_camera = {};
 		bool construction_choosing_tile;
 		Point construction_tile_choice_marker_pos;
 		std::uint32_t construction_current_tile_template_index;
 		std::vector<Tile_Template> tile_templates;
+		//Until "./assets/tiles.txt" has been read, every tile would look like it refers to a missing template.
+		bool tile_templates_loaded = false;
 		bool show_fps;
 		bool quit;
-		Tile tiles[(Background_Tile_Count_X * 2) * (Background_Tile_Count_Y * 2)];
+		Tile_Grid tiles;
+		Tile_Layout tile_layout = Tile_Layout::Row_Major;
+		//Maps whose path ends with 'Map_Stream::File_Extension' are streamed into 'tiles'. Declared after it, so it's closed before 'tiles' is destroyed.
+		Map_Stream map_stream;
+		std::string streamed_map_path;
+		std::size_t streamed_map_memory_cap = Map_Stream::Default_Memory_Cap;
 		Eagle eagle;
-		std::vector<Bullet> bullets;
-		std::vector<Tank> enemy_tanks;
-		std::vector<Explosion> explosions;
-		float game_lose_timer;
-		std::vector<Spawn_Effect> spawn_effects;
-		std::minstd_rand0 random_engine;
-		std::uniform_int_distribution<std::size_t> enamy_spawn_point_random_dist;
-		std::uniform_real_distribution<float> enemy_action_duration_dist;
-		std::uniform_real_distribution<float> chance_0_1_dist;
+		Bullet_Array bullets;
+		Pool<Tank> enemy_tanks;
+		//Sorted by id, entries of removed enemies find nothing until they are dropped.
+		std::vector<Enemy_Id_Entry> enemy_ids;
+		Pool<Explosion> explosions;
+		Timer_Handle game_lose_timer;
+		Pool<Spawn_Effect> spawn_effects;
+		std::uint32_t match_seed;
+		//Counts simulation steps, random streams are indexed by it.
+		std::uint32_t simulation_tick = 0;
 		std::uint32_t max_enemy_count_on_screen;
 		std::uint32_t remaining_enemy_count_to_spawn;
-		float enemy_spawn_timer;
-		float game_win_timer;
+		std::uint32_t enemy_spawn_batch_size = 1;
+		float enemy_spawn_interval = 0.0f;
+		//Filled once the navigation fields are up to date, since spawners inside walls are left out.
+		std::vector<Vec2> enemy_spawner_locations;
+		//Enemy shots over the cap are dropped.
+		std::uint32_t max_bullet_count = 0;
+		bool horde_mode = false;
+		Horde_Settings horde_settings;
+		Timer_Handle game_win_timer;
 		std::size_t current_stage_index;
 		Player first_player;
 		Player second_player;
 		bool skip = true;
+		bool intro_map_requested = false;
+		bool map_load_pending = false;
+		File_Request_Id latest_map_request = 0;
+		std::string current_map_path;
+		struct Hot_Reload_Sprite {
+			const char* file_path;
+			Sprite_Index* sprite;
+			//0 for sprites that aren't atlases.
+			std::uint32_t tile_dimension;
+			//Only needed while a level is loaded, see 'acquire_level_sprites'. The others are loaded at startup.
+			bool per_level;
+		};
+		std::vector<Hot_Reload_Sprite> hot_reload_sprites;
+		bool level_sprites_acquired = false;
+		std::uint32_t saves_in_flight = 0;
+		struct Map_Save_Record {
+			std::uint32_t in_flight;
+			std::filesystem::file_time_type write_time;
+		};
+		//Maps written by the editor itself, by normalized path. Their change notifications must not reload the map over edits made since.
+		std::unordered_map<std::string,Map_Save_Record> map_saves;
+		//Edits that didn't reach the file the user saves to.
+		bool construction_map_dirty = false;
+		//Edits made since the last autosave or save.
+		bool construction_autosave_dirty = false;
+		float autosave_timer = 0.0f;
+		float save_status_timer = 0.0f;
+		const char* save_status_text = "";
+		//Distance fields toward the eagle, the first and the second player, shared by all enemy tanks. They cover 'navigation_window' only.
+		Flow_Field navigation_fields[3];
+		Ipoint navigation_targets[3] = {};
+		//Half tiles around the entities, see 'update_navigation'.
+		Irect navigation_window = {};
+		std::vector<std::uint8_t> navigation_cell_costs;
+		//Half tiles whose tile was destroyed and streamed chunks loaded or evicted since the last update, their distances are updated without rebuilding the fields.
+		std::vector<Ipoint> navigation_changed_cells;
+		std::vector<std::uint32_t> navigation_changed_chunks;
+		//Set when the fields have to be rebuilt, e.g. when a new map is loaded.
+		bool navigation_dirty = true;
+		Ai_Scheduler enemy_ai_scheduler;
+		//First target a ray would hit, rebuilt every tick from the few rows and columns the targets cover.
+		Line_Of_Fire lines_of_fire;
+		Raycast_Outcome::Type line_of_fire_types[Line_Of_Fire::Max_Target_Count] = {};
+		std::uint32_t next_entity_id = 1;
+		//Entity timers, advanced only while a match is being simulated.
+		Timer_Wheel timers;
+		//Fraction of a tick the last update didn't reach.
+		double timer_tick_fraction = 0.0;
+		//Copied into 'frame_arena' by 'collect_player_bullets', so only valid during the tick.
+		const Bullet* player_bullets = nullptr;
+		std::size_t player_bullet_count = 0;
+		//Short-lived data of the current tick, everything in it is freed at the start of the next one.
+		Frame_Arena frame_arena;
+		//Enemies plan their moves with rollouts instead of the probability table when enabled. Toggled with F4.
+		bool enemy_planner_enabled = false;
+		Planner_Settings enemy_planner_settings;
+		//Behaviour of the current map's enemies, compiled when the map is loaded.
+		std::optional<Behaviour_Program> enemy_behaviour;
+		bool enemy_behaviour_enabled = true;
+		std::string current_behaviour_path;
+		File_Request_Id latest_behaviour_request = 0;
+		Frame_Timings frame_timings = {};
+		std::vector<Stress_Run> stress_runs;
+		std::size_t current_stress_run = 0;
+		std::uint32_t stress_run_tick = 0;
+		bool allocation_check = false;
+		//Set by updates after the warm-up of a stress run, whose frames must not allocate during the check.
+		bool allocation_frame_steady = false;
+		bool allocation_check_failure = false;
+		//Shown with the frame rate when tracking is compiled in.
+		Allocation_Counts previous_frame_allocations = {};
+		std::string memory_dump_path;
+		float memory_dump_timer = 0.0f;
+		bool memory_dump_in_flight = false;
 	};
 }
 #endif
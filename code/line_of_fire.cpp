@@ -0,0 +1,89 @@
+#include <cmath>
+#include <algorithm>
+#include "line_of_fire.hpp"
+#include "exceptions.hpp"
+
+namespace core {
+	void Line_Of_Fire::update(const Tile_Grid& tiles,const Rect* _targets,std::size_t _target_count,const Map_Stream* map_stream) {
+		if(_target_count > Max_Target_Count) throw Runtime_Exception("Too many line of fire targets.");
+		grid_width = std::int32_t(tiles.width());
+		grid_height = std::int32_t(tiles.height());
+		target_count = _target_count;
+		for(std::size_t i = 0;i < target_count;i += 1) {
+			const auto& rect = _targets[i];
+			auto& target = targets[i];
+			target.first_x = std::max(std::int32_t(std::ceil(rect.x * 2.0f - 0.5f)),0);
+			target.first_y = std::max(std::int32_t(std::ceil(rect.y * 2.0f - 0.5f)),0);
+			target.end_x = std::min(std::int32_t(std::ceil((rect.x + rect.width) * 2.0f - 0.5f)),grid_width);
+			target.end_y = std::min(std::int32_t(std::ceil((rect.y + rect.height) * 2.0f - 0.5f)),grid_height);
+			if(target.end_x - target.first_x > Max_Target_Span || target.end_y - target.first_y > Max_Target_Span) throw Runtime_Exception("Line of fire target is too large.");
+			//Targets outside of the map can't be hit, they keep their index.
+			if(target.first_x >= target.end_x || target.first_y >= target.end_y) {
+				target.end_x = target.first_x;
+				target.end_y = target.first_y;
+				continue;
+			}
+
+			//Rays reaching the target from each side, walked outward from its edge until a solid tile stops them.
+			auto passable = [map_stream](const Tile_Grid::Cursor& walk) {
+				return !(walk.cell() & Tile_Grid::Solid_Bit) && (!map_stream || map_stream->is_resident(walk.x(),walk.y()));
+			};
+			for(std::int32_t y = target.first_y;y < target.end_y;y += 1) {
+				auto walk = tiles.cursor(target.first_x - 1,y);
+				for(;walk.x() >= 0 && passable(walk);walk.previous_x()) {}
+				target.reach[0][y - target.first_y] = walk.x() + 1;
+				walk = tiles.cursor(target.end_x,y);
+				for(;walk.x() < grid_width && passable(walk);walk.next_x()) {}
+				target.reach[2][y - target.first_y] = walk.x() - 1;
+			}
+			for(std::int32_t x = target.first_x;x < target.end_x;x += 1) {
+				auto walk = tiles.cursor(x,target.first_y - 1);
+				for(;walk.y() >= 0 && passable(walk);walk.previous_y()) {}
+				target.reach[1][x - target.first_x] = walk.y() + 1;
+				walk = tiles.cursor(x,target.end_y);
+				for(;walk.y() < grid_height && passable(walk);walk.next_y()) {}
+				target.reach[3][x - target.first_x] = walk.y() - 1;
+			}
+		}
+	}
+
+	std::uint32_t Line_Of_Fire::first_target(Ipoint cell,std::uint8_t dir,bool through_tiles) const noexcept {
+		if(cell.x < 0 || cell.y < 0 || cell.x >= grid_width || cell.y >= grid_height) return No_Target;
+		bool horizontal = (dir & 1) == 0;
+		bool forward = dir < 2;
+		//Along the ray and across it.
+		auto along = horizontal ? cell.x : cell.y;
+		auto across = horizontal ? cell.y : cell.x;
+
+		std::uint32_t nearest = No_Target;
+		std::int32_t nearest_entry = 0;
+		for(std::size_t i = 0;i < target_count;i += 1) {
+			const auto& target = targets[i];
+			auto first_across = horizontal ? target.first_y : target.first_x;
+			auto end_across = horizontal ? target.end_y : target.end_x;
+			auto first_along = horizontal ? target.first_x : target.first_y;
+			auto end_along = horizontal ? target.end_x : target.end_y;
+			if(across < first_across || across >= end_across) continue;
+			//First half tile of the target on the ray, the ray may start inside of it.
+			std::int32_t entry = 0;
+			if(forward) {
+				if(end_along <= along) continue;
+				entry = std::max(first_along,along);
+			}
+			else {
+				if(first_along > along) continue;
+				entry = std::min(end_along - 1,along);
+			}
+			//Ties are overlapping targets, the earlier one wins.
+			bool nearer = forward ? entry < nearest_entry : entry > nearest_entry;
+			if(nearest != No_Target && !nearer) continue;
+			if(!through_tiles && entry != along) {
+				auto reach = target.reach[dir][across - first_across];
+				if(forward ? along < reach : along > reach) continue;
+			}
+			nearest = std::uint32_t(i);
+			nearest_entry = entry;
+		}
+		return nearest;
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef LINE_OF_FIRE_HPP
+#define LINE_OF_FIRE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include "math.hpp"
+#include "tile_grid.hpp"
+#include "map_stream.hpp"
+
+namespace core {
+	/*	Answers which target a ray leaving a half tile reaches first, for a few targets at once. A half tile belongs to a target when its center is
+		inside the target, a ray stops at the first solid tile unless it goes through tiles. Only the rows and columns the targets cover are walked,
+		up to the first solid tile on each side, so the cost follows the distance to the nearest walls rather than the size of the map.
+		Directions are numbered like 'Entity_Direction': right, down, left, up. */
+	class Line_Of_Fire {
+	public:
+		static inline constexpr std::uint32_t Max_Target_Count = 3;
+		//Half tiles a target may cover along either axis.
+		static inline constexpr std::int32_t Max_Target_Span = 4;
+		static inline constexpr std::uint32_t No_Target = std::uint32_t(-1);
+
+		//'targets' are in tiles. Where targets overlap, the earlier one is hit. Half tiles of chunks 'map_stream' hasn't loaded stop rays like solid
+		//tiles, their tiles are unknown.
+		void update(const Tile_Grid& tiles,const Rect* targets,std::size_t target_count,const Map_Stream* map_stream = nullptr);
+		//Index of the target a ray from 'cell' going in 'dir' reaches first, 'No_Target' if there is none.
+		[[nodiscard]] std::uint32_t first_target(Ipoint cell,std::uint8_t dir,bool through_tiles) const noexcept;
+	private:
+		struct Target {
+			//Half tiles covered, the ends are exclusive.
+			std::int32_t first_x;
+			std::int32_t first_y;
+			std::int32_t end_x;
+			std::int32_t end_y;
+			//Per direction and covered row or column, the furthest half tile a ray can start from and still reach the target without crossing a solid tile.
+			std::int32_t reach[4][Max_Target_Span];
+		};
+
+		Target targets[Max_Target_Count] = {};
+		std::size_t target_count = 0;
+		std::int32_t grid_width = 0;
+		std::int32_t grid_height = 0;
+	};
+}
+
+#endif
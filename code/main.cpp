@@ -1,22 +1,92 @@
 #include <cstdio>
+#include <string>
 #include <vector>
+#include <cstring>
+#include <optional>
+#include <charconv>
 #include <random>
 #include <chrono>
 #include <iostream>
 #include <exception>
 #include "game.hpp"
 #include "platform.hpp"
+#include "tile_benchmark.hpp"
+#include "ai_benchmark.hpp"
 #include "renderer.hpp"
+#include "entity_kernels.hpp"
 #include "exceptions.hpp"
 
-int main() {
+static constexpr std::uint32_t Default_Stress_Enemy_Count = 16000;
+static constexpr std::uint32_t Default_Allocation_Check_Enemy_Count = 1000;
+
+int main(int argc,char** argv) {
     core::Platform platform = {};
     try {
+        //'--stress [max enemy count]' runs the stress benchmark instead of the game and quits once it's done.
+        std::optional<std::uint32_t> stress_enemy_count{};
+        //'--allocation-check [max enemy count]' does the same and fails once a frame allocates after warming up. Needs TANKS_TRACK_ALLOCATIONS.
+        bool allocation_check = false;
+        //'--tile-layout morton' stores the cells of map chunks in Z-order.
+        auto tile_layout = core::Tile_Layout::Row_Major;
+        //'--stream-map [path] [megabytes]' plays every stage on a map streamed from the drive, keeping at most that much of it in memory.
+        const char* streamed_map_path = nullptr;
+        std::size_t streamed_map_memory_cap = core::Map_Stream::Default_Memory_Cap;
+        //'--memory-dump [path]' writes the memory held per subsystem to that file every few seconds.
+        const char* memory_dump_path = nullptr;
+        for(int i = 1;i < argc;i += 1) {
+            //'--tile-benchmark' compares the tile layouts and quits, it doesn't need a window.
+            if(std::strcmp(argv[i],"--tile-benchmark") == 0) {
+                std::cout << "[Tile benchmark] Fastest of several repetitions:\n" << core::run_tile_layout_benchmark() << std::flush;
+                return 0;
+            }
+            //'--ai-benchmark' times the navigation and line of fire passes on a map of the largest size and quits, same as above.
+            if(std::strcmp(argv[i],"--ai-benchmark") == 0) {
+                std::cout << "[AI benchmark] Fastest of several repetitions:\n" << core::run_ai_benchmark() << std::flush;
+                return 0;
+            }
+            //'--decode-benchmark' times the bitmap decoder and quits, same as above.
+            if(std::strcmp(argv[i],"--decode-benchmark") == 0) {
+                std::cout << "[Decode benchmark] Fastest of several repetitions:\n" << core::run_bitmap_decode_benchmark() << std::flush;
+                return 0;
+            }
+            //'--kernel-check' compares the SIMD entity and matrix kernels with their scalar versions and fails on any difference.
+            if(std::strcmp(argv[i],"--kernel-check") == 0) {
+                std::string report;
+                bool passed = core::check_entity_kernels(&report);
+                passed = core::check_math_kernels(&report) && passed;
+                std::cout << "[Kernel check] Mismatching cases per kernel:\n" << report << std::flush;
+                return passed ? 0 : 1;
+            }
+            if(std::strcmp(argv[i],"--tile-layout") == 0 && i + 1 < argc && std::strcmp(argv[i + 1],"morton") == 0) tile_layout = core::Tile_Layout::Morton;
+            if(std::strcmp(argv[i],"--stream-map") == 0 && i + 1 < argc) {
+                streamed_map_path = argv[i + 1];
+                if(i + 2 < argc) {
+                    std::uint32_t megabytes = 0;
+                    auto result = std::from_chars(argv[i + 2],argv[i + 2] + std::strlen(argv[i + 2]),megabytes);
+                    if(result.ec == std::errc() && megabytes > 0) streamed_map_memory_cap = std::size_t(megabytes) << 20;
+                }
+            }
+            if(std::strcmp(argv[i],"--memory-dump") == 0 && i + 1 < argc) memory_dump_path = argv[i + 1];
+            allocation_check = allocation_check || std::strcmp(argv[i],"--allocation-check") == 0;
+            if(std::strcmp(argv[i],"--stress") != 0 && std::strcmp(argv[i],"--allocation-check") != 0) continue;
+            stress_enemy_count = allocation_check ? Default_Allocation_Check_Enemy_Count : Default_Stress_Enemy_Count;
+            if(i + 1 < argc) {
+                std::uint32_t count = 0;
+                auto result = std::from_chars(argv[i + 1],argv[i + 1] + std::strlen(argv[i + 1]),count);
+                if(result.ec == std::errc() && count > 0) stress_enemy_count = count;
+            }
+        }
+
         platform.create_main_window("Tanks",1024,768);
         
         auto renderer = platform.create_renderer();
 
         core::Game game{&renderer,&platform};
+        game.set_tile_layout(tile_layout);
+        if(streamed_map_path) game.set_streamed_map(streamed_map_path,streamed_map_memory_cap);
+        if(memory_dump_path) game.set_memory_dump(memory_dump_path);
+        if(allocation_check) game.start_allocation_check(stress_enemy_count.value());
+        else if(stress_enemy_count.has_value()) game.start_stress_benchmark(stress_enemy_count.value());
 
         auto start_time = std::chrono::steady_clock::now();
         while(!platform.window_closed() && !game.quit_requested()) {
@@ -33,7 +103,7 @@ int main() {
             platform.swap_window_buffers();
         }
 
-        return 0;
+        return game.allocation_check_failed() ? 1 : 0;
     }
     catch(const core::Runtime_Exception& except) {
         platform.error_message_box(except.message());
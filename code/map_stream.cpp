@@ -0,0 +1,321 @@
+#include <cstring>
+#include <algorithm>
+#include "map_stream.hpp"
+#include "exceptions.hpp"
+#include "memory_telemetry.hpp"
+#include "defer.hpp"
+
+#if defined(_WIN32)
+	#define WIN32_LEAN_AND_MEAN
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+namespace core {
+	//"TMAP" read as a little-endian number, values in the file are stored in the byte order of the machine.
+	static constexpr std::uint32_t Map_File_Magic = 0x50414D54;
+	static constexpr std::uint32_t Map_File_Version = 1;
+	static constexpr std::size_t Chunk_Byte_Count = Tile_Grid::Chunk_Cell_Count * sizeof(std::uint16_t);
+	//The header takes the place of one chunk, so no chunk straddles two pages of memory.
+	static constexpr std::size_t Header_Byte_Count = Chunk_Byte_Count;
+
+	struct Map_File_Header {
+		std::uint32_t magic;
+		std::uint32_t version;
+		//In half tiles.
+		std::uint32_t width;
+		std::uint32_t height;
+	};
+
+	//Cells are stored with the bits of 'Tile_Grid::Empty_Cell' flipped, so chunks without tiles are all zeros.
+	static void encode_chunk(const std::uint16_t* cells,std::uint8_t* bytes) noexcept {
+		for(std::uint32_t i = 0;i < Tile_Grid::Chunk_Cell_Count;i += 1) {
+			auto value = std::uint16_t(cells[i] ^ Tile_Grid::Empty_Cell);
+			std::memcpy(bytes + i * sizeof(value),&value,sizeof(value));
+		}
+	}
+	static void decode_chunk(const std::uint8_t* bytes,std::uint16_t* cells) noexcept {
+		for(std::uint32_t i = 0;i < Tile_Grid::Chunk_Cell_Count;i += 1) {
+			std::uint16_t value = 0;
+			std::memcpy(&value,bytes + i * sizeof(value),sizeof(value));
+			cells[i] = std::uint16_t(value ^ Tile_Grid::Empty_Cell);
+		}
+	}
+
+	Map_Stream::Map_Stream() noexcept : file_path(),mapped_bytes(),mapped_size(),tiles(),max_loaded_count(),loaded_count(),update_count(),most_recent(No_Chunk),least_recent(No_Chunk),
+										chunk_states(),requested_chunks(),prefetched_chunks(),changed_slots() {}
+
+	Map_Stream::~Map_Stream() {
+		close();
+	}
+
+	std::vector<std::uint8_t> Map_Stream::encode(const Tile_Grid& tiles) {
+		auto chunk_count = std::size_t(tiles.chunk_columns()) * tiles.chunk_rows();
+		std::vector<std::uint8_t> bytes(Header_Byte_Count + chunk_count * Chunk_Byte_Count);
+		Map_File_Header header{Map_File_Magic,Map_File_Version,tiles.width(),tiles.height()};
+		std::memcpy(bytes.data(),&header,sizeof(header));
+		std::uint16_t cells[Tile_Grid::Chunk_Cell_Count];
+		for(std::size_t slot = 0;slot < chunk_count;slot += 1) {
+			tiles.copy_chunk(std::uint32_t(slot % tiles.chunk_columns()),std::uint32_t(slot / tiles.chunk_columns()),cells);
+			core::encode_chunk(cells,bytes.data() + Header_Byte_Count + slot * Chunk_Byte_Count);
+		}
+		return bytes;
+	}
+
+	std::vector<std::uint8_t> Map_Stream::snapshot() const {
+		if(!is_open()) return {};
+		std::vector<std::uint8_t> bytes(Header_Byte_Count + chunk_states.size() * Chunk_Byte_Count);
+		std::memcpy(bytes.data(),mapped_bytes,Header_Byte_Count);
+		std::uint16_t cells[Tile_Grid::Chunk_Cell_Count];
+		for(std::uint32_t slot = 0;slot < chunk_states.size();slot += 1) {
+			auto* chunk = bytes.data() + Header_Byte_Count + std::size_t(slot) * Chunk_Byte_Count;
+			if(!chunk_states[slot].loaded) {
+				std::memcpy(chunk,chunk_bytes(slot),Chunk_Byte_Count);
+				continue;
+			}
+			tiles->copy_chunk(slot % tiles->chunk_columns(),slot / tiles->chunk_columns(),cells);
+			core::encode_chunk(cells,chunk);
+		}
+		return bytes;
+	}
+
+	void Map_Stream::open(const char* _file_path,Tile_Grid* _tiles,std::size_t memory_cap) {
+		close();
+		file_path = _file_path;
+#if defined(_WIN32)
+		HANDLE file = CreateFileA(file_path.c_str(),GENERIC_READ | GENERIC_WRITE,FILE_SHARE_READ,nullptr,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,nullptr);
+		if(file == INVALID_HANDLE_VALUE) throw File_Open_Exception(file_path.c_str());
+		defer[&]{ CloseHandle(file); };
+		LARGE_INTEGER file_size{};
+		if(!GetFileSizeEx(file,&file_size)) throw File_Read_Exception(file_path.c_str(),0);
+		if(std::uint64_t(file_size.QuadPart) < Header_Byte_Count) throw File_Exception(file_path.c_str(),"Invalid streamed map");
+		HANDLE mapping = CreateFileMappingA(file,nullptr,PAGE_READWRITE,0,0,nullptr);
+		if(mapping == nullptr) throw File_Exception(file_path.c_str(),"Couldn't map the file into memory");
+		defer[&]{ CloseHandle(mapping); };
+		//The view keeps the file open after its handles are closed.
+		void* bytes = MapViewOfFile(mapping,FILE_MAP_READ | FILE_MAP_WRITE,0,0,0);
+		if(bytes == nullptr) throw File_Exception(file_path.c_str(),"Couldn't map the file into memory");
+		mapped_size = std::size_t(file_size.QuadPart);
+#else
+		int file = ::open(file_path.c_str(),O_RDWR);
+		if(file < 0) throw File_Open_Exception(file_path.c_str());
+		defer[&]{ ::close(file); };
+		struct stat file_info{};
+		if(fstat(file,&file_info) != 0) throw File_Read_Exception(file_path.c_str(),0);
+		if(std::uint64_t(file_info.st_size) < Header_Byte_Count) throw File_Exception(file_path.c_str(),"Invalid streamed map");
+		//The mapping keeps the file open after its descriptor is closed.
+		void* bytes = mmap(nullptr,std::size_t(file_info.st_size),PROT_READ | PROT_WRITE,MAP_SHARED,file,0);
+		if(bytes == MAP_FAILED) throw File_Exception(file_path.c_str(),"Couldn't map the file into memory");
+		mapped_size = std::size_t(file_info.st_size);
+#endif
+		mapped_bytes = static_cast<std::uint8_t*>(bytes);
+
+		Map_File_Header header{};
+		std::memcpy(&header,mapped_bytes,sizeof(header));
+		bool valid = header.magic == Map_File_Magic && header.version == Map_File_Version;
+		valid = valid && header.width > 0 && header.height > 0 && header.width <= Tile_Grid::Max_Dimension && header.height <= Tile_Grid::Max_Dimension;
+		if(valid) {
+			_tiles->resize(header.width,header.height,_tiles->layout());
+			valid = mapped_size >= Header_Byte_Count + std::size_t(_tiles->chunk_columns()) * _tiles->chunk_rows() * Chunk_Byte_Count;
+		}
+		if(!valid) {
+			close();
+			throw File_Exception(file_path.c_str(),"Invalid streamed map");
+		}
+
+		tiles = _tiles;
+		max_loaded_count = std::max<std::size_t>(memory_cap / Chunk_Byte_Count,1);
+		loaded_count = 0;
+		//Requests are compared with the current update, which never matches the zeroed stamps of chunks not requested yet.
+		update_count = 1;
+		most_recent = No_Chunk;
+		least_recent = No_Chunk;
+		auto chunk_count = std::size_t(tiles->chunk_columns()) * tiles->chunk_rows();
+		chunk_states.assign(chunk_count,{No_Chunk,No_Chunk,0,0,0,false});
+		//Every chunk is listed at most once per update, so requests never allocate during the match.
+		requested_chunks.clear();
+		requested_chunks.reserve(chunk_count);
+		prefetched_chunks.clear();
+		prefetched_chunks.reserve(chunk_count);
+		changed_slots.clear();
+		changed_slots.reserve(chunk_count);
+	}
+
+	void Map_Stream::close() noexcept {
+		if(!is_open()) return;
+		if(tiles) {
+			for(auto slot = most_recent;slot != No_Chunk;slot = chunk_states[slot].next) write_back(slot);
+		}
+#if defined(_WIN32)
+		UnmapViewOfFile(mapped_bytes);
+#else
+		munmap(mapped_bytes,mapped_size);
+#endif
+		mapped_bytes = nullptr;
+		mapped_size = 0;
+		tiles = nullptr;
+		loaded_count = 0;
+		most_recent = No_Chunk;
+		least_recent = No_Chunk;
+		chunk_states.clear();
+		requested_chunks.clear();
+		prefetched_chunks.clear();
+		changed_slots.clear();
+	}
+
+	template<typename Visit>
+	void Map_Stream::for_each_chunk(Irect area,Visit visit) {
+		if(!is_open()) return;
+		auto first_x = std::max(area.x,0);
+		auto first_y = std::max(area.y,0);
+		auto last_x = std::min(area.x + area.width,std::int32_t(tiles->width())) - 1;
+		auto last_y = std::min(area.y + area.height,std::int32_t(tiles->height())) - 1;
+		if(first_x > last_x || first_y > last_y) return;
+		for(auto chunk_y = std::uint32_t(first_y) >> Tile_Grid::Chunk_Shift;chunk_y <= (std::uint32_t(last_y) >> Tile_Grid::Chunk_Shift);chunk_y += 1) {
+			for(auto chunk_x = std::uint32_t(first_x) >> Tile_Grid::Chunk_Shift;chunk_x <= (std::uint32_t(last_x) >> Tile_Grid::Chunk_Shift);chunk_x += 1) {
+				visit(chunk_y * tiles->chunk_columns() + chunk_x);
+			}
+		}
+	}
+
+	void Map_Stream::request(Irect area) {
+		for_each_chunk(area,[this](std::uint32_t slot) {
+			auto& state = chunk_states[slot];
+			if(state.requested_update == update_count) return;
+			state.requested_update = update_count;
+			requested_chunks.push_back(slot);
+		});
+	}
+
+	void Map_Stream::prefetch(Irect area) {
+		for_each_chunk(area,[this](std::uint32_t slot) {
+			auto& state = chunk_states[slot];
+			if(state.prefetched_update == update_count) return;
+			state.prefetched_update = update_count;
+			prefetched_chunks.push_back(slot);
+		});
+	}
+
+	std::size_t Map_Stream::update(const std::vector<Tile_Template>& templates) {
+		changed_slots.clear();
+		if(!is_open()) return 0;
+		//Loaded chunks move to the front of the list, requested ones ahead of prefetched ones. Evicting from the back then drops the chunks
+		//nobody asked for first and prefetched ones next.
+		for(auto slot : prefetched_chunks) {
+			if(!chunk_states[slot].loaded) continue;
+			unlink(slot);
+			link_first(slot);
+		}
+		for(auto slot : requested_chunks) {
+			if(!chunk_states[slot].loaded) continue;
+			unlink(slot);
+			link_first(slot);
+		}
+		auto can_evict = [this](bool keep_prefetched) {
+			if(least_recent == No_Chunk) return false;
+			const auto& state = chunk_states[least_recent];
+			return state.requested_update != update_count && (!keep_prefetched || state.prefetched_update != update_count);
+		};
+
+		std::size_t changed_count = 0;
+		for(auto slot : requested_chunks) {
+			if(chunk_states[slot].loaded) continue;
+			for(;loaded_count >= max_loaded_count && can_evict(false);changed_count += 1) evict(least_recent);
+			load(slot,templates);
+			changed_count += 1;
+		}
+		for(auto slot : prefetched_chunks) {
+			if(chunk_states[slot].loaded) continue;
+			if(loaded_count >= max_loaded_count) {
+				if(!can_evict(true)) break;
+				evict(least_recent);
+				changed_count += 1;
+			}
+			load(slot,templates);
+			changed_count += 1;
+		}
+		//Chunks loaded over the cap are dropped once they are no longer requested.
+		for(;loaded_count > max_loaded_count && can_evict(false);changed_count += 1) evict(least_recent);
+
+		requested_chunks.clear();
+		prefetched_chunks.clear();
+		update_count += 1;
+		return changed_count;
+	}
+
+	void Map_Stream::flush() noexcept {
+		if(!is_open()) return;
+		for(auto slot = most_recent;slot != No_Chunk;slot = chunk_states[slot].next) write_back(slot);
+		//Only starts writing the pages to the drive, the mapping stays usable meanwhile.
+#if defined(_WIN32)
+		FlushViewOfFile(mapped_bytes,0);
+#else
+		msync(mapped_bytes,mapped_size,MS_ASYNC);
+#endif
+	}
+
+	std::size_t Map_Stream::memory_usage() const noexcept {
+		return file_path.capacity() + core::reserved_bytes(chunk_states) + core::reserved_bytes(requested_chunks) + core::reserved_bytes(prefetched_chunks) + core::reserved_bytes(changed_slots);
+	}
+
+	void Map_Stream::load(std::uint32_t slot,const std::vector<Tile_Template>& templates) {
+		std::uint16_t cells[Tile_Grid::Chunk_Cell_Count];
+		core::decode_chunk(chunk_bytes(slot),cells);
+		tiles->load_chunk(slot % tiles->chunk_columns(),slot / tiles->chunk_columns(),cells,templates);
+		chunk_states[slot].loaded = true;
+		link_first(slot);
+		loaded_count += 1;
+		mark_changed(slot);
+	}
+
+	void Map_Stream::evict(std::uint32_t slot) noexcept {
+		write_back(slot);
+		tiles->unload_chunk(slot % tiles->chunk_columns(),slot / tiles->chunk_columns());
+		unlink(slot);
+		chunk_states[slot].loaded = false;
+		loaded_count -= 1;
+		mark_changed(slot);
+	}
+
+	void Map_Stream::mark_changed(std::uint32_t slot) noexcept {
+		auto& state = chunk_states[slot];
+		if(state.changed_update == update_count) return;
+		state.changed_update = update_count;
+		changed_slots.push_back(slot);
+	}
+
+	void Map_Stream::write_back(std::uint32_t slot) noexcept {
+		std::uint16_t cells[Tile_Grid::Chunk_Cell_Count];
+		if(tiles->store_chunk(slot % tiles->chunk_columns(),slot / tiles->chunk_columns(),cells)) core::encode_chunk(cells,chunk_bytes(slot));
+	}
+
+	void Map_Stream::link_first(std::uint32_t slot) noexcept {
+		auto& state = chunk_states[slot];
+		state.previous = No_Chunk;
+		state.next = most_recent;
+		if(most_recent != No_Chunk) chunk_states[most_recent].previous = slot;
+		else least_recent = slot;
+		most_recent = slot;
+	}
+
+	void Map_Stream::unlink(std::uint32_t slot) noexcept {
+		auto& state = chunk_states[slot];
+		if(state.previous != No_Chunk) chunk_states[state.previous].next = state.next;
+		else most_recent = state.next;
+		if(state.next != No_Chunk) chunk_states[state.next].previous = state.previous;
+		else least_recent = state.previous;
+		state.previous = No_Chunk;
+		state.next = No_Chunk;
+	}
+
+	std::uint8_t* Map_Stream::chunk_bytes(std::uint32_t slot) const noexcept {
+		return mapped_bytes + Header_Byte_Count + std::size_t(slot) * Chunk_Byte_Count;
+	}
+}
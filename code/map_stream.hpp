@@ -0,0 +1,100 @@
+#ifndef MAP_STREAM_HPP
+#define MAP_STREAM_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "math.hpp"
+#include "tile_grid.hpp"
+
+namespace core {
+	/*	Plays maps larger than the memory by keeping only the chunks in use in 'Tile_Grid', the whole map stays in its file which is mapped into
+		the address space. The file holds a header and then every chunk of the map in the order of the grid's slots, so a chunk is found by its
+		position alone and the file doesn't have to be read to be opened.
+		Every tick the game requests the areas around the camera and its entities and prefetches the areas tanks are driving into. 'update'
+		loads the requested chunks and evicts the least recently requested ones to stay under the memory cap, writing the modified ones back
+		to the file. Chunks requested in the current tick are never evicted, so the cap only gives way when they alone exceed it, prefetched
+		chunks are only loaded while there is room. */
+	class Map_Stream {
+	public:
+		static inline constexpr const char* File_Extension = ".chunks";
+		static inline constexpr std::size_t Default_Memory_Cap = std::size_t(64) << 20;
+
+		Map_Stream() noexcept;
+		Map_Stream(const Map_Stream&) = delete;
+		Map_Stream& operator=(const Map_Stream&) = delete;
+		~Map_Stream();
+
+		//The whole grid in the format of streamed maps, e.g. to save a map built in the editor.
+		[[nodiscard]] static std::vector<std::uint8_t> encode(const Tile_Grid& tiles);
+		//The whole open map in the same format, loaded chunks are taken from the grid and the others from the file. Empty if no file is open.
+		[[nodiscard]] std::vector<std::uint8_t> snapshot() const;
+
+		//Maps the file and resizes 'tiles' to the size of the map in it, with no chunk loaded. 'tiles' must stay alive until 'close'.
+		void open(const char* file_path,Tile_Grid* tiles,std::size_t memory_cap = Default_Memory_Cap);
+		//Writes the modified chunks back and unmaps the file, loaded chunks stay in the grid. Does nothing if no file is open.
+		void close() noexcept;
+		[[nodiscard]] bool is_open() const noexcept { return mapped_bytes != nullptr; }
+		[[nodiscard]] const std::string& path() const noexcept { return file_path; }
+		//Whether the tiles of the half tile at 'x','y' are in the grid, which is always the case when no file is open. The half tile must be on the map.
+		[[nodiscard]] bool is_resident(std::int32_t x,std::int32_t y) const noexcept {
+			if(!is_open()) return true;
+			return chunk_states[(std::uint32_t(y) >> Tile_Grid::Chunk_Shift) * tiles->chunk_columns() + (std::uint32_t(x) >> Tile_Grid::Chunk_Shift)].loaded;
+		}
+		//Chunks overlapping 'area', given in half tiles, are loaded by the next 'update'.
+		void request(Irect area);
+		//Same as 'request', but the chunks are only loaded if they fit under the memory cap.
+		void prefetch(Irect area);
+		//Returns the number of chunks loaded and evicted, the tiles of the grid changed if it isn't zero.
+		std::size_t update(const std::vector<Tile_Template>& templates);
+		//Chunks the last 'update' loaded or evicted, each listed once. Chunk 'slot' is in column 'slot % chunk_columns()' of the grid's chunks.
+		[[nodiscard]] const std::vector<std::uint32_t>& changed_chunks() const noexcept { return changed_slots; }
+		//Writes every modified chunk back without evicting it.
+		void flush() noexcept;
+		[[nodiscard]] std::size_t loaded_chunk_count() const noexcept { return loaded_count; }
+		//Bookkeeping of the stream, the loaded chunks are part of the grid and the mapped file isn't counted.
+		[[nodiscard]] std::size_t memory_usage() const noexcept;
+	private:
+		static inline constexpr std::uint32_t No_Chunk = std::uint32_t(-1);
+
+		//Per chunk of the map, loaded chunks are linked from the most to the least recently requested one.
+		struct Chunk_State {
+			std::uint32_t previous;
+			std::uint32_t next;
+			//Value of 'update_count' when the chunk was last requested or prefetched.
+			std::uint32_t requested_update;
+			std::uint32_t prefetched_update;
+			//Value of 'update_count' when the chunk was last loaded or evicted.
+			std::uint32_t changed_update;
+			bool loaded;
+		};
+
+		//Calls 'visit' with the slot of every chunk overlapping 'area'.
+		template<typename Visit>
+		void for_each_chunk(Irect area,Visit visit);
+		void load(std::uint32_t slot,const std::vector<Tile_Template>& templates);
+		void evict(std::uint32_t slot) noexcept;
+		void write_back(std::uint32_t slot) noexcept;
+		void mark_changed(std::uint32_t slot) noexcept;
+		void link_first(std::uint32_t slot) noexcept;
+		void unlink(std::uint32_t slot) noexcept;
+		[[nodiscard]] std::uint8_t* chunk_bytes(std::uint32_t slot) const noexcept;
+
+		std::string file_path;
+		std::uint8_t* mapped_bytes;
+		std::size_t mapped_size;
+		Tile_Grid* tiles;
+		std::size_t max_loaded_count;
+		std::size_t loaded_count;
+		std::uint32_t update_count;
+		std::uint32_t most_recent;
+		std::uint32_t least_recent;
+		std::vector<Chunk_State> chunk_states;
+		std::vector<std::uint32_t> requested_chunks;
+		std::vector<std::uint32_t> prefetched_chunks;
+		std::vector<std::uint32_t> changed_slots;
+	};
+}
+
+#endif
@@ -1,36 +1,115 @@
 #include <cmath>
+#include <cstdio>
+#include <vector>
+#include <cstring>
 #include "math.hpp"
+#include "random.hpp"
+#include "exceptions.hpp"
 
 #if defined(_MSC_VER) && !defined(__clang__)
 	#include <intrin.h>
 #endif
+#if defined(CORE_SSE2)
+	#include <emmintrin.h>
+#endif
+#if defined(CORE_X86)
+	#include <immintrin.h>
+#endif
 
 namespace core {
-	Mat4::Mat4(float v) noexcept : data() {
-		operator()(0,0) = v;
-		operator()(1,1) = v;
-		operator()(2,2) = v;
-		operator()(3,3) = v;
+	//Column 'x' of the product is the columns of 'a' weighted by the elements of column 'x' of 'b', summed from the first column on.
+	static void multiply_scalar(const Mat4& a,const Mat4& b,Mat4* out) noexcept {
+		for(std::size_t x = 0;x < 4;x += 1) {
+			for(std::size_t y = 0;y < 4;y += 1) {
+				out->data[x * 4 + y] = a(0,y) * b(x,0) + a(1,y) * b(x,1) + a(2,y) * b(x,2) + a(3,y) * b(x,3);
+			}
+		}
+	}
+
+	static void multiply_batch_scalar(const Mat4& a,const Mat4* b,Mat4* out,std::size_t count) noexcept {
+		for(std::size_t i = 0;i < count;i += 1) {
+			//'out' may alias 'b', so every product is made on the side.
+			Mat4 result;
+			core::multiply_scalar(a,b[i],&result);
+			out[i] = result;
+		}
 	}
 
-	float& Mat4::operator()(std::size_t x,std::size_t y) noexcept {
-		return data[x * 4 + y];
+#if defined(CORE_SSE2)
+	static void multiply_sse2(const Mat4& a,const Mat4& b,Mat4* out) noexcept {
+		const __m128 a0 = _mm_load_ps(a.data);
+		const __m128 a1 = _mm_load_ps(a.data + 4);
+		const __m128 a2 = _mm_load_ps(a.data + 8);
+		const __m128 a3 = _mm_load_ps(a.data + 12);
+		__m128 columns[4];
+		for(std::size_t x = 0;x < 4;x += 1) {
+			const float* column = b.data + x * 4;
+			__m128 sum = _mm_mul_ps(a0,_mm_set1_ps(column[0]));
+			sum = _mm_add_ps(sum,_mm_mul_ps(a1,_mm_set1_ps(column[1])));
+			sum = _mm_add_ps(sum,_mm_mul_ps(a2,_mm_set1_ps(column[2])));
+			columns[x] = _mm_add_ps(sum,_mm_mul_ps(a3,_mm_set1_ps(column[3])));
+		}
+		for(std::size_t x = 0;x < 4;x += 1) _mm_store_ps(out->data + x * 4,columns[x]);
 	}
 
-	const float& Mat4::operator()(std::size_t x,std::size_t y) const noexcept {
-		return data[x * 4 + y];
+	static void multiply_batch_sse2(const Mat4& a,const Mat4* b,Mat4* out,std::size_t count) noexcept {
+		for(std::size_t i = 0;i < count;i += 1) core::multiply_sse2(a,b[i],out + i);
 	}
+#endif
 
-	Mat4 operator*(const Mat4& a,const Mat4& b) noexcept {
-		Mat4 result{};
-		for(std::size_t x = 0;x < 4;x += 1) {
-			for(std::size_t y = 0;y < 4;y += 1) {
-				result(x,y) = a(0,y) * b(x,0) + a(1,y) * b(x,1) + a(2,y) * b(x,2) + a(3,y) * b(x,3);
+#if defined(CORE_X86)
+	//Two columns of the product at a time, the columns of 'a' are repeated in both halves of the registers.
+	CORE_TARGET_AVX2 static void multiply_batch_avx2(const Mat4& a,const Mat4* b,Mat4* out,std::size_t count) noexcept {
+		const __m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.data));
+		const __m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.data + 4));
+		const __m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.data + 8));
+		const __m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(a.data + 12));
+		for(std::size_t i = 0;i < count;i += 1) {
+			__m256 columns[2];
+			for(std::size_t half = 0;half < 2;half += 1) {
+				//Elements of columns 'x' and 'x + 1' of 'b', each spread over the half of the register it weights.
+				__m256 pair = _mm256_loadu_ps(b[i].data + half * 8);
+				__m256 sum = _mm256_mul_ps(a0,_mm256_permute_ps(pair,0x00));
+				sum = _mm256_add_ps(sum,_mm256_mul_ps(a1,_mm256_permute_ps(pair,0x55)));
+				sum = _mm256_add_ps(sum,_mm256_mul_ps(a2,_mm256_permute_ps(pair,0xAA)));
+				columns[half] = _mm256_add_ps(sum,_mm256_mul_ps(a3,_mm256_permute_ps(pair,0xFF)));
 			}
+			_mm256_storeu_ps(out[i].data,columns[0]);
+			_mm256_storeu_ps(out[i].data + 8,columns[1]);
 		}
+	}
+#endif
+
+	using Multiply_Batch_Kernel = void(*)(const Mat4&,const Mat4*,Mat4*,std::size_t) noexcept;
+	[[nodiscard]] static Multiply_Batch_Kernel multiply_batch_kernel() noexcept {
+		static const Multiply_Batch_Kernel kernel = []() -> Multiply_Batch_Kernel {
+#if defined(CORE_X86)
+			if(core::cpu_supports_avx2()) return &core::multiply_batch_avx2;
+#endif
+#if defined(CORE_SSE2)
+			return &core::multiply_batch_sse2;
+#else
+			return &core::multiply_batch_scalar;
+#endif
+		}();
+		return kernel;
+	}
+
+	Mat4 operator*(const Mat4& a,const Mat4& b) noexcept {
+		//A single product is too small to be worth an indirect call, so it's always SSE2.
+		Mat4 result;
+#if defined(CORE_SSE2)
+		core::multiply_sse2(a,b,&result);
+#else
+		core::multiply_scalar(a,b,&result);
+#endif
 		return result;
 	}
 
+	void multiply(const Mat4& a,const Mat4* b,Mat4* out,std::size_t count) noexcept {
+		core::multiply_batch_kernel()(a,b,out,count);
+	}
+
 	Mat4 orthographic(float left,float right,float top,float bottom,float near,float far) noexcept {
 		Mat4 result{};
 		result(0,0) = 2.0f / (right - left);
@@ -43,14 +122,6 @@ namespace core {
 		return result;
 	}
 
-	Mat4 translate(float x,float y,float z) noexcept {
-		Mat4 result{1.0f};
-		result(3,0) = x;
-		result(3,1) = y;
-		result(3,2) = z;
-		return result;
-	}
-
 	Mat4 rotate(float z) noexcept {
 		Mat4 result{};
 		result(0,0) = std::cos(z);
@@ -62,11 +133,22 @@ namespace core {
 		return result;
 	}
 
-	Mat4 scale(float x,float y,float z) noexcept {
+	Mat4 sprite_transform(Vec3 position,Vec2 size,float rotation) noexcept {
+		//Most sprites aren't rotated, those skip the trigonometry.
+		float cosine = 1.0f,sine = 0.0f;
+		if(rotation != 0.0f) {
+			cosine = std::cos(rotation);
+			sine = std::sin(rotation);
+		}
 		Mat4 result{};
-		result(0,0) = x;
-		result(1,1) = y;
-		result(2,2) = z;
+		result(0,0) = cosine * size.x;
+		result(0,1) = sine * size.x;
+		result(1,0) = -sine * size.y;
+		result(1,1) = cosine * size.y;
+		result(2,2) = 1.0f;
+		result(3,0) = position.x;
+		result(3,1) = position.y;
+		result(3,2) = position.z;
 		result(3,3) = 1.0f;
 		return result;
 	}
@@ -97,4 +179,159 @@ namespace core {
 		return __builtin_ctzl(value);
 #endif
 	}
+
+	[[nodiscard]] static std::uint32_t morton_encode_shifts(std::uint32_t x,std::uint32_t y) noexcept {
+		auto spread = [](std::uint32_t value) {
+			value = (value | (value << 8)) & 0x00FF00FFu;
+			value = (value | (value << 4)) & 0x0F0F0F0Fu;
+			value = (value | (value << 2)) & 0x33333333u;
+			value = (value | (value << 1)) & 0x55555555u;
+			return value;
+		};
+		return spread(x) | (spread(y) << 1);
+	}
+	[[nodiscard]] static Point morton_decode_shifts(std::uint32_t code) noexcept {
+		auto compact = [](std::uint32_t value) {
+			value &= 0x55555555u;
+			value = (value | (value >> 1)) & 0x33333333u;
+			value = (value | (value >> 2)) & 0x0F0F0F0Fu;
+			value = (value | (value >> 4)) & 0x00FF00FFu;
+			value = (value | (value >> 8)) & 0x0000FFFFu;
+			return value;
+		};
+		return {compact(code),compact(code >> 1)};
+	}
+#if defined(CORE_X86)
+	CORE_TARGET_BMI2 static std::uint32_t morton_encode_bmi2(std::uint32_t x,std::uint32_t y) noexcept {
+		return _pdep_u32(x,0x55555555u) | _pdep_u32(y,0xAAAAAAAAu);
+	}
+	CORE_TARGET_BMI2 static Point morton_decode_bmi2(std::uint32_t code) noexcept {
+		return {_pext_u32(code,0x55555555u),_pext_u32(code,0xAAAAAAAAu)};
+	}
+#endif
+
+	struct Morton_Kernels {
+		std::uint32_t(*encode)(std::uint32_t,std::uint32_t) noexcept;
+		Point(*decode)(std::uint32_t) noexcept;
+	};
+	[[nodiscard]] static const Morton_Kernels& morton_kernels() noexcept {
+		static const Morton_Kernels kernels = []() -> Morton_Kernels {
+#if defined(CORE_X86)
+			if(core::cpu_supports_bmi2()) return {&core::morton_encode_bmi2,&core::morton_decode_bmi2};
+#endif
+			return {&core::morton_encode_shifts,&core::morton_decode_shifts};
+		}();
+		return kernels;
+	}
+
+	std::uint32_t morton_encode(std::uint32_t x,std::uint32_t y) noexcept {
+		return core::morton_kernels().encode(x,y);
+	}
+
+	Point morton_decode(std::uint32_t code) noexcept {
+		return core::morton_kernels().decode(code);
+	}
+
+	bool cpu_supports_avx2() noexcept {
+#if defined(CORE_X86)
+		//The answer can't change while the program is running so we only ask the CPU once.
+		static const bool supported = []{
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4] = {};
+			__cpuid(info,0);
+			if(info[0] < 7) return false;
+			__cpuid(info,1);
+			//AVX2 registers are only usable if the operating system saves them during context switches (OSXSAVE + XCR0).
+			if((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+			if((_xgetbv(0) & 0x6) != 0x6) return false;
+			__cpuidex(info,7,0);
+			return (info[1] & (1 << 5)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("avx2") != 0;
+#endif
+		}();
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	bool cpu_supports_bmi2() noexcept {
+#if defined(CORE_X86)
+		static const bool supported = []{
+#if defined(_MSC_VER) && !defined(__clang__)
+			int info[4] = {};
+			__cpuid(info,0);
+			if(info[0] < 7) return false;
+			__cpuidex(info,7,0);
+			return (info[1] & (1 << 8)) != 0;
+#else
+			__builtin_cpu_init();
+			return __builtin_cpu_supports("bmi2") != 0;
+#endif
+		}();
+		return supported;
+#else
+		return false;
+#endif
+	}
+
+	bool check_math_kernels(std::string* out_report) {
+		using Kernel = void(*)(const Mat4&,const Mat4*,Mat4*,std::size_t) noexcept;
+		struct Kernel_Variant {
+			const char* name;
+			bool supported;
+			Kernel kernel;
+		};
+		//Builds without SIMD only have the scalar version, so there is nothing to compare.
+		const Kernel_Variant variants[] = {
+#if defined(CORE_SSE2)
+			{"sse2",true,&core::multiply_batch_sse2},
+#endif
+#if defined(CORE_X86)
+			{"avx2",core::cpu_supports_avx2(),&core::multiply_batch_avx2},
+#endif
+		};
+
+		//Empty batches, single products, short runs and long runs.
+		const std::size_t counts[] = {0,1,2,3,4,5,7,8,9,255,256};
+		bool passed = true;
+		for(const auto& [variant,supported,kernel] : variants) {
+			if(!supported) continue;
+			std::size_t mismatches = 0;
+			std::size_t case_count = 0;
+			Random_Stream random{{0,0},0,0};
+			for(auto count : counts) {
+				for(std::uint32_t repetition = 0;repetition < 8;repetition += 1) {
+					case_count += 1;
+					//Half of the products are sprite matrices moved by a camera, like in the renderer, the rest are random.
+					auto random_matrix = [&random,repetition](Mat4* out) {
+						if(repetition % 2 == 0) {
+							*out = core::sprite_transform({random.next_float() * 64.0f,random.next_float() * 64.0f,random.next_float()},{random.next_float() * 4.0f,random.next_float() * 4.0f},random.next_float() * 2.0f * PI);
+							return;
+						}
+						for(auto& element : out->data) element = random.next_float() * 64.0f - 32.0f;
+					};
+					Mat4 a;
+					if(repetition % 2 == 0) a = core::translate(random.next_float() * -64.0f,random.next_float() * -64.0f,0.0f);
+					else random_matrix(&a);
+					std::vector<Mat4> b(count),expected(count),product(count);
+					for(auto& matrix : b) random_matrix(&matrix);
+					core::multiply_batch_scalar(a,b.data(),expected.data(),count);
+					kernel(a,b.data(),product.data(),count);
+					//The renderer multiplies in place, so that is checked as well.
+					kernel(a,b.data(),b.data(),count);
+					if(count > 0 && (std::memcmp(product.data(),expected.data(),count * sizeof(Mat4)) != 0 || std::memcmp(b.data(),expected.data(),count * sizeof(Mat4)) != 0)) mismatches += 1;
+				}
+			}
+
+			char buffer[256] = {};
+			int length = std::snprintf(buffer,sizeof(buffer) - 1,"multiply,%s,%zu,%zu\n",variant,case_count,mismatches);
+			if(length < 0) throw Runtime_Exception("Couldn't create the math kernel report.");
+			*out_report += buffer;
+			passed = passed && mismatches == 0;
+		}
+		return passed;
+	}
 }
@@ -1,26 +1,43 @@
 #ifndef MATH_HPP
 #define MATH_HPP
 
+#include <string>
 #include <cstdint>
 #include <cstddef>
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+	#define CORE_X86 1
+#endif
+//SSE2 is part of x86-64, 32-bit builds only get it when the compiler is told to target it.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define CORE_SSE2 1
+#endif
+//MSVC lets us use any intrinsic without changing the target of the whole translation unit, GCC and Clang need a per-function attribute.
+#if defined(_MSC_VER) && !defined(__clang__)
+	#define CORE_TARGET_AVX2
+	#define CORE_TARGET_BMI2
+#else
+	#define CORE_TARGET_AVX2 __attribute__((target("avx2")))
+	#define CORE_TARGET_BMI2 __attribute__((target("bmi2")))
+#endif
+
 namespace core {
 	static inline constexpr float PI = 3.1415927f;
 	struct Vec2 {
 		float x;
 		float y;
 
-		[[nodiscard]] Vec2 operator+(Vec2 v) { return {x + v.x,y + v.y}; }
-		[[nodiscard]] Vec2 operator-(Vec2 v) { return {x - v.x,y - v.y}; }
-		[[nodiscard]] Vec2 operator*(float v) { return {x * v,y * v}; }
-		[[nodiscard]] Vec2 operator/(float v) { return {x / v,y / v}; }
+		[[nodiscard]] constexpr Vec2 operator+(Vec2 v) const noexcept { return {x + v.x,y + v.y}; }
+		[[nodiscard]] constexpr Vec2 operator-(Vec2 v) const noexcept { return {x - v.x,y - v.y}; }
+		[[nodiscard]] constexpr Vec2 operator*(float v) const noexcept { return {x * v,y * v}; }
+		[[nodiscard]] constexpr Vec2 operator/(float v) const noexcept { return {x / v,y / v}; }
 
-		Vec2& operator+=(const Vec2& v) {
+		constexpr Vec2& operator+=(const Vec2& v) noexcept {
 			x += v.x;
 			y += v.y;
 			return *this;
 		}
-		Vec2& operator-=(const Vec2& v) {
+		constexpr Vec2& operator-=(const Vec2& v) noexcept {
 			x -= v.x;
 			y -= v.y;
 			return *this;
@@ -30,7 +47,7 @@ namespace core {
 		float x;
 		float y;
 		float z;
-		[[nodiscard]] explicit operator Vec2() { return { x,y }; }
+		[[nodiscard]] constexpr explicit operator Vec2() const noexcept { return { x,y }; }
 	};
 	struct Vec4 {
 		float x;
@@ -43,10 +60,10 @@ namespace core {
 		float y;
 		float width;
 		float height;
-		[[nodiscard]] bool point_inside(Vec2 point) const noexcept {
+		[[nodiscard]] constexpr bool point_inside(Vec2 point) const noexcept {
 			return point.x >= x && point.x <= (x + width) && point.y >= y && point.y <= (y + height);
 		}
-		[[nodiscard]] bool overlaps(const Rect& other) const noexcept {
+		[[nodiscard]] constexpr bool overlaps(const Rect& other) const noexcept {
 			return (x + width) > other.x && x < (other.x + other.width) && (y + height) > other.y && y < (other.y + other.height);
 		}
 	};
@@ -86,24 +103,58 @@ namespace core {
 		std::uint32_t width;
 		std::uint32_t height;
 	};
-	struct Mat4 {
+	//Column-major, '(x,y)' is the element in column 'x' and row 'y'. Aligned so SIMD code can load whole columns.
+	struct alignas(16) Mat4 {
 		float data[16];
 		Mat4() = default;
-		explicit Mat4(float v) noexcept;
-		[[nodiscard]] float& operator()(std::size_t x,std::size_t y) noexcept;
-		[[nodiscard]] const float& operator()(std::size_t x,std::size_t y) const noexcept;
+		constexpr explicit Mat4(float v) noexcept : data() {
+			data[0] = v;
+			data[5] = v;
+			data[10] = v;
+			data[15] = v;
+		}
+		[[nodiscard]] constexpr float& operator()(std::size_t x,std::size_t y) noexcept { return data[x * 4 + y]; }
+		[[nodiscard]] constexpr const float& operator()(std::size_t x,std::size_t y) const noexcept { return data[x * 4 + y]; }
 	};
+	//Uses SSE2 where available. Every version does the same float operations in the same order, so results are bit-identical.
 	[[nodiscard]] Mat4 operator*(const Mat4& a,const Mat4& b) noexcept;
+	//Sets 'out[i]' to 'a * b[i]', with AVX2 picked at runtime on CPUs that have it. 'out' may be 'b'.
+	void multiply(const Mat4& a,const Mat4* b,Mat4* out,std::size_t count) noexcept;
 	[[nodiscard]] Mat4 orthographic(float left,float right,float top,float bottom,float near,float far) noexcept;
-	[[nodiscard]] Mat4 translate(float x,float y,float z) noexcept;
+	[[nodiscard]] constexpr Mat4 translate(float x,float y,float z) noexcept {
+		Mat4 result{1.0f};
+		result(3,0) = x;
+		result(3,1) = y;
+		result(3,2) = z;
+		return result;
+	}
 	[[nodiscard]] Mat4 rotate(float z) noexcept;
-	[[nodiscard]] Mat4 scale(float x,float y,float z) noexcept;
+	[[nodiscard]] constexpr Mat4 scale(float x,float y,float z) noexcept {
+		Mat4 result{};
+		result(0,0) = x;
+		result(1,1) = y;
+		result(2,2) = z;
+		result(3,3) = 1.0f;
+		return result;
+	}
+	//Same as 'translate(position) * rotate(rotation) * scale(size.x,size.y,1)', built directly instead of through two products.
+	[[nodiscard]] Mat4 sprite_transform(Vec3 position,Vec2 size,float rotation) noexcept;
 
 	[[nodiscard]] float magnitude(Vec2 v);
 	[[nodiscard]] Vec2 normalize(Vec2 v);
 	[[nodiscard]] float dot(Vec2 a,Vec2 b);
 	[[nodiscard]] float distance(Vec2 a,Vec2 b);
 	[[nodiscard]] std::uint32_t leading_zeroes(std::uint32_t value);
+	[[nodiscard]] bool cpu_supports_avx2() noexcept;
+	[[nodiscard]] bool cpu_supports_bmi2() noexcept;
+	//Compares every SIMD version of 'multiply' the CPU supports with the scalar one bit for bit, on random inputs.
+	//Appends a row per variant to 'out_report', in the CSV format of 'check_entity_kernels'. Returns false if any case differed.
+	[[nodiscard]] bool check_math_kernels(std::string* out_report);
+
+	//Z-order code of a point, the bits of 'x' and 'y' interleaved with those of 'x' in the even positions. Both have to fit in 16 bits.
+	//Uses pdep and pext on CPUs with BMI2, picked at runtime, and shifts elsewhere. Both give the same codes.
+	[[nodiscard]] std::uint32_t morton_encode(std::uint32_t x,std::uint32_t y) noexcept;
+	[[nodiscard]] Point morton_decode(std::uint32_t code) noexcept;
 }
 
 #endif
@@ -0,0 +1,50 @@
+#include <cstdio>
+#include "memory_telemetry.hpp"
+#include "exceptions.hpp"
+
+namespace core {
+	const char* memory_tag_name(Memory_Tag tag) noexcept {
+		switch(tag) {
+			case Memory_Tag::Sprite_Staging: return "sprite_staging";
+			case Memory_Tag::Renderer: return "renderer";
+			case Memory_Tag::Tiles: return "tiles";
+			case Memory_Tag::Entities: return "entities";
+			case Memory_Tag::Ai_Maps: return "ai_maps";
+			case Memory_Tag::Scratch: return "scratch";
+			case Memory_Tag::Textures: return "textures";
+			case Memory_Tag::Gpu_Buffers: return "gpu_buffers";
+			default: return "unknown";
+		}
+	}
+
+	std::size_t Memory_Report::cpu_bytes() const noexcept {
+		std::size_t total = 0;
+		for(std::size_t i = 0;i < std::size_t(Memory_Tag::Count);i += 1) {
+			if(!core::memory_tag_on_gpu(Memory_Tag(i))) total += byte_counts[i];
+		}
+		return total;
+	}
+
+	std::size_t Memory_Report::gpu_bytes() const noexcept {
+		std::size_t total = 0;
+		for(std::size_t i = 0;i < std::size_t(Memory_Tag::Count);i += 1) {
+			if(core::memory_tag_on_gpu(Memory_Tag(i))) total += byte_counts[i];
+		}
+		return total;
+	}
+
+	std::string format_memory_report(const Memory_Report& report) {
+		std::string text = "tag,memory,bytes\n";
+		char buffer[128] = {};
+		for(std::size_t i = 0;i < std::size_t(Memory_Tag::Count);i += 1) {
+			auto tag = Memory_Tag(i);
+			int count = std::snprintf(buffer,sizeof(buffer) - 1,"%s,%s,%zu\n",core::memory_tag_name(tag),core::memory_tag_on_gpu(tag) ? "gpu" : "cpu",report.bytes(tag));
+			if(count < 0) throw Runtime_Exception("Couldn't create the memory report.");
+			text += buffer;
+		}
+		int count = std::snprintf(buffer,sizeof(buffer) - 1,"total,cpu,%zu\ntotal,gpu,%zu\n",report.cpu_bytes(),report.gpu_bytes());
+		if(count < 0) throw Runtime_Exception("Couldn't create the memory report.");
+		text += buffer;
+		return text;
+	}
+}
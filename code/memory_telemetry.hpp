@@ -0,0 +1,55 @@
+#ifndef MEMORY_TELEMETRY_HPP
+#define MEMORY_TELEMETRY_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+	//What memory is used for. 'Textures' and 'Gpu_Buffers' are memory of the graphics card, the rest memory of the process.
+	enum class Memory_Tag : std::uint8_t {
+		//Per-sprite copies of the quads queued for drawing.
+		Sprite_Staging,
+		//Sprite bookkeeping, layer hashes and the font.
+		Renderer,
+		Tiles,
+		//Entity pools and the bullet arrays.
+		Entities,
+		//Navigation fields and costs, the line of fire and the threat map.
+		Ai_Maps,
+		//The frame arena and per-tick work lists.
+		Scratch,
+		Textures,
+		Gpu_Buffers,
+		Count
+	};
+	[[nodiscard]] const char* memory_tag_name(Memory_Tag tag) noexcept;
+	[[nodiscard]] inline bool memory_tag_on_gpu(Memory_Tag tag) noexcept { return tag == Memory_Tag::Textures || tag == Memory_Tag::Gpu_Buffers; }
+
+	/*	Bytes held per 'Memory_Tag' at the time the report was made. Subsystems add what their containers have reserved, capacity rather than
+		size, and the sizes they requested from OpenGL, so taking a report costs nothing while it isn't asked for and doesn't allocate. The
+		driver's own overhead and memory-mapped files aren't counted. */
+	struct Memory_Report {
+		std::size_t byte_counts[std::size_t(Memory_Tag::Count)];
+
+		void add(Memory_Tag tag,std::size_t byte_count) noexcept { byte_counts[std::size_t(tag)] += byte_count; }
+		[[nodiscard]] std::size_t bytes(Memory_Tag tag) const noexcept { return byte_counts[std::size_t(tag)]; }
+		[[nodiscard]] std::size_t cpu_bytes() const noexcept;
+		[[nodiscard]] std::size_t gpu_bytes() const noexcept;
+	};
+	//CSV with a line per tag, for the dump file.
+	[[nodiscard]] std::string format_memory_report(const Memory_Report& report);
+
+	template<typename T,typename Allocator>
+	[[nodiscard]] std::size_t reserved_bytes(const std::vector<T,Allocator>& values) noexcept {
+		return values.capacity() * sizeof(T);
+	}
+	//Estimate for node-based hash tables: a node per element holding it and a link, and a pointer per bucket.
+	template<typename Map>
+	[[nodiscard]] std::size_t hash_table_bytes(const Map& map) noexcept {
+		return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void*)) + map.bucket_count() * sizeof(void*);
+	}
+}
+
+#endif
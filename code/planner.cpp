@@ -0,0 +1,174 @@
+#include <cmath>
+#include <algorithm>
+#include "planner.hpp"
+
+namespace core {
+	static constexpr std::uint32_t Planner_Candidate_Count = 8;
+	static constexpr float Planner_Tank_Collision_Offset = 0.1f;
+	static constexpr float Planner_Firing_Distance = 0.6f;
+	static constexpr float Planner_Death_Penalty = 80.0f;
+	static constexpr float Planner_Tile_Reward = 1.0f;
+	static constexpr float Planner_Distance_Weight = 0.5f;
+	//Unreachable cells and cells outside of the window count as this far, so one bad rollout doesn't outweigh all the others.
+	static constexpr std::uint32_t Planner_Max_Distance = 128;
+	//Rollouts commit to the candidate move for as long as an enemy commits to a decision, then continue with a random policy.
+	static constexpr float Planner_Decision_Interval = 0.15f;
+	static constexpr float Planner_Follow_Chance = 0.5f;
+	static constexpr float Planner_Shoot_Chance = 0.3f;
+
+	[[nodiscard]] static Vec2 direction_vector(std::uint8_t dir) noexcept {
+		static constexpr Vec2 Direction_Vectors[] = {{1.0f,0.0f},{0.0f,1.0f},{-1.0f,0.0f},{0.0f,-1.0f}};
+		return Direction_Vectors[dir];
+	}
+
+	[[nodiscard]] static bool window_cell(const Planner_Window& window,std::int32_t map_x,std::int32_t map_y,Ipoint* out_local) noexcept {
+		out_local->x = map_x - window.origin.x;
+		out_local->y = map_y - window.origin.y;
+		return out_local->x >= 0 && out_local->y >= 0 && out_local->x < Planner_Window::Size && out_local->y < Planner_Window::Size;
+	}
+
+	[[nodiscard]] static bool test_bit(const std::uint32_t* rows,Ipoint local) noexcept {
+		return (rows[local.y] >> local.x) & 1u;
+	}
+
+	[[nodiscard]] static bool tank_fits(const Planner_Window& window,const Planner_State& state,Vec2 position) noexcept {
+		auto start_x = std::int32_t(std::floor((position.x - 0.5f + Planner_Tank_Collision_Offset) * 2.0f));
+		auto start_y = std::int32_t(std::floor((position.y - 0.5f + Planner_Tank_Collision_Offset) * 2.0f));
+		auto end_x = std::int32_t(std::floor((position.x + 0.5f - Planner_Tank_Collision_Offset) * 2.0f));
+		auto end_y = std::int32_t(std::floor((position.y + 0.5f - Planner_Tank_Collision_Offset) * 2.0f));
+		for(std::int32_t y = start_y;y <= end_y;y += 1) {
+			for(std::int32_t x = start_x;x <= end_x;x += 1) {
+				Ipoint local{};
+				if(!core::window_cell(window,x,y,&local) || core::test_bit(state.tank_blocking,local)) return false;
+			}
+		}
+		return true;
+	}
+
+	[[nodiscard]] static bool inside_tank(Vec2 tank_position,Vec2 point) noexcept {
+		return Rect{tank_position.x - 0.5f,tank_position.y - 0.5f,1.0f,1.0f}.point_inside(point);
+	}
+
+	[[nodiscard]] static std::uint32_t target_distance(const Planner_Window& window,Vec2 tank_position,std::int32_t offset_x = 0,std::int32_t offset_y = 0) noexcept {
+		Ipoint local{};
+		auto cell_x = std::int32_t(std::lround(tank_position.x * 2.0f)) - 1 + offset_x;
+		auto cell_y = std::int32_t(std::lround(tank_position.y * 2.0f)) - 1 + offset_y;
+		if(!core::window_cell(window,cell_x,cell_y,&local)) return std::uint32_t(-1);
+		return window.target_distances[local.y * Planner_Window::Size + local.x];
+	}
+
+	static void remove_bullet(Planner_State* state,std::uint32_t index) noexcept {
+		state->bullet_count -= 1;
+		state->bullets[index] = state->bullets[state->bullet_count];
+	}
+
+	//Moves a bullet half a tile at most, so it can't skip over a half tile. Returns false once the bullet is gone.
+	[[nodiscard]] static bool advance_bullet(const Planner_Window& window,Planner_State* state,Planner_Bullet* bullet,float distance) noexcept {
+		bullet->position += core::direction_vector(bullet->dir) * distance;
+		Ipoint local{};
+		if(!core::window_cell(window,std::int32_t(std::floor(bullet->position.x * 2.0f)),std::int32_t(std::floor(bullet->position.y * 2.0f)),&local)) return false;
+
+		if(bullet->own) {
+			for(std::uint32_t i = 0;i < state->target_count;i += 1) {
+				if(!core::inside_tank(state->targets[i],bullet->position)) continue;
+				state->score += state->target_values[i];
+				state->target_count -= 1;
+				state->targets[i] = state->targets[state->target_count];
+				state->target_values[i] = state->target_values[state->target_count];
+				return false;
+			}
+		}
+		else if(!state->tank_destroyed && core::inside_tank(state->tank_position,bullet->position)) {
+			state->tank_destroyed = true;
+			state->score -= Planner_Death_Penalty;
+			return false;
+		}
+
+		if(core::test_bit(state->bullet_blocking,local)) {
+			//Tiles are assumed to break on the first hit, the window doesn't keep their health.
+			if(core::test_bit(state->destructible,local)) {
+				auto mask = ~(1u << local.x);
+				state->tank_blocking[local.y] &= mask;
+				state->bullet_blocking[local.y] &= mask;
+				state->destructible[local.y] &= mask;
+				if(bullet->own) state->score += Planner_Tile_Reward;
+			}
+			return false;
+		}
+		return true;
+	}
+
+	static void simulate_step(const Planner_Window& window,Planner_State* state,Planner_Move move,const Planner_Settings& settings) noexcept {
+		state->shoot_cooldown -= settings.step;
+		state->tank_dir = move.dir;
+		if(move.shoot && state->shoot_cooldown <= 0.0f && state->bullet_count < Planner_State::Max_Bullet_Count) {
+			state->bullets[state->bullet_count++] = {state->tank_position + core::direction_vector(move.dir) * Planner_Firing_Distance,move.dir,true};
+			state->shoot_cooldown = settings.shoot_cooldown;
+		}
+		auto new_position = state->tank_position + core::direction_vector(move.dir) * (settings.tank_speed * settings.step);
+		if(core::tank_fits(window,*state,new_position)) state->tank_position = new_position;
+
+		float bullet_distance = settings.bullet_speed * settings.step;
+		auto substep_count = std::max(std::uint32_t(std::ceil(bullet_distance * 2.0f)),1u);
+		float substep_distance = bullet_distance / float(substep_count);
+		for(std::uint32_t i = 0;i < state->bullet_count;) {
+			bool alive = true;
+			for(std::uint32_t substep = 0;substep < substep_count && alive;substep += 1) alive = core::advance_bullet(window,state,&state->bullets[i],substep_distance);
+			if(alive) i += 1;
+			else core::remove_bullet(state,i);
+		}
+	}
+
+	[[nodiscard]] static float rollout(const Planner_Window& window,Planner_State state,Planner_Move first_move,const Planner_Settings& settings,Random_Stream* random) noexcept {
+		auto step_count = std::uint32_t(settings.horizon / settings.step);
+		auto decision_step_count = std::max(std::uint32_t(Planner_Decision_Interval / settings.step),1u);
+		Planner_Move move = first_move;
+		for(std::uint32_t step = 0;step < step_count && !state.tank_destroyed && state.target_count > 0;step += 1) {
+			if(step >= decision_step_count && step % decision_step_count == 0) {
+				//The policy mostly follows the navigation field, like the enemies themselves do.
+				move.dir = std::uint8_t(random->next_below(4));
+				if(random->next_float() <= Planner_Follow_Chance) {
+					auto best_distance = core::target_distance(window,state.tank_position);
+					for(std::uint8_t dir = 0;dir < 4;dir += 1) {
+						auto offset = core::direction_vector(dir);
+						auto distance = core::target_distance(window,state.tank_position,std::int32_t(offset.x),std::int32_t(offset.y));
+						if(distance < best_distance) {
+							best_distance = distance;
+							move.dir = dir;
+						}
+					}
+				}
+				move.shoot = random->next_float() <= Planner_Shoot_Chance;
+			}
+			core::simulate_step(window,&state,move,settings);
+		}
+		if(!state.tank_destroyed) state.score -= float(std::min(core::target_distance(window,state.tank_position),Planner_Max_Distance)) * Planner_Distance_Weight;
+		return state.score;
+	}
+
+	Planner_Move plan_move(const Planner_Window& window,const Planner_State& state,const Planner_Settings& settings,Random_Stream* random) noexcept {
+		float total_scores[Planner_Candidate_Count] = {};
+		std::uint32_t rollout_counts[Planner_Candidate_Count] = {};
+		auto start = std::chrono::steady_clock::now();
+		//Candidates are rolled out in rounds, so all of them have been tried equally often whenever the budget runs out.
+		for(std::uint32_t rollout_index = 0;rollout_index < settings.max_rollout_count;rollout_index += 1) {
+			auto candidate = rollout_index % Planner_Candidate_Count;
+			if(candidate == 0 && rollout_index > 0 && settings.time_budget.count() > 0 && std::chrono::steady_clock::now() - start >= settings.time_budget) break;
+			Planner_Move move = {std::uint8_t(candidate / 2),(candidate % 2) == 1};
+			total_scores[candidate] += core::rollout(window,state,move,settings,random);
+			rollout_counts[candidate] += 1;
+		}
+
+		Planner_Move best_move = {state.tank_dir,false};
+		float best_score = -INFINITY;
+		for(std::uint32_t candidate = 0;candidate < Planner_Candidate_Count;candidate += 1) {
+			if(rollout_counts[candidate] == 0) continue;
+			float score = total_scores[candidate] / float(rollout_counts[candidate]);
+			if(score > best_score) {
+				best_score = score;
+				best_move = {std::uint8_t(candidate / 2),(candidate % 2) == 1};
+			}
+		}
+		return best_move;
+	}
+}
@@ -0,0 +1,69 @@
+#ifndef PLANNER_HPP
+#define PLANNER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include "math.hpp"
+#include "random.hpp"
+
+namespace core {
+	/*	Monte Carlo lookahead for a single tank. The world around the tank is copied into a fixed-size window, so forking it for a rollout is a plain copy
+		of a few hundred bytes and nothing is allocated while planning. Directions are numbered like 'Entity_Direction': right, down, left, up. */
+	struct Planner_Window {
+		//In half tiles, the window is centered on the tank.
+		static inline constexpr std::int32_t Size = 32;
+		//Half tile of the map in the top-left corner of the window.
+		Ipoint origin;
+		//Navigation distance to the nearest target, read-only during planning so it isn't part of the forked state.
+		std::uint32_t target_distances[Size * Size];
+	};
+
+	struct Planner_Bullet {
+		Vec2 position;
+		std::uint8_t dir;
+		//Fired by the planning tank, otherwise it is a player bullet that can hit the tank.
+		bool own;
+	};
+
+	struct Planner_State {
+		static inline constexpr std::uint32_t Max_Bullet_Count = 16;
+		static inline constexpr std::uint32_t Max_Target_Count = 3;
+		//One bit per half tile, a row per word. Cells outside of the map are blocking.
+		std::uint32_t tank_blocking[Planner_Window::Size];
+		std::uint32_t bullet_blocking[Planner_Window::Size];
+		std::uint32_t destructible[Planner_Window::Size];
+		//All positions are in tiles, relative to the map like in the game.
+		Vec2 tank_position;
+		std::uint8_t tank_dir;
+		bool tank_destroyed;
+		float shoot_cooldown;
+		Vec2 targets[Max_Target_Count];
+		float target_values[Max_Target_Count];
+		std::uint32_t target_count;
+		Planner_Bullet bullets[Max_Bullet_Count];
+		std::uint32_t bullet_count;
+		float score;
+	};
+
+	struct Planner_Move {
+		std::uint8_t dir;
+		bool shoot;
+	};
+
+	struct Planner_Settings {
+		float tank_speed;
+		float bullet_speed;
+		float shoot_cooldown;
+		//How far ahead every rollout looks, in seconds.
+		float horizon;
+		float step;
+		//Rollouts stop at whichever limit comes first. A zero budget only counts rollouts, which makes plans reproducible.
+		std::uint32_t max_rollout_count;
+		std::chrono::microseconds time_budget;
+	};
+
+	//Tries every direction with and without shooting and returns the one whose random rollouts scored best on average.
+	[[nodiscard]] Planner_Move plan_move(const Planner_Window& window,const Planner_State& state,const Planner_Settings& settings,Random_Stream* random) noexcept;
+}
+
+#endif
@@ -0,0 +1,60 @@
+#include "pool.hpp"
+#include "memory_telemetry.hpp"
+
+namespace core {
+	void Pool_Slots::reserve(std::size_t _capacity) {
+		capacity = _capacity;
+		slots.reserve(capacity);
+		dense_slots.reserve(capacity);
+	}
+
+	Pool_Handle Pool_Slots::add() {
+		if(full()) return {};
+		std::uint32_t slot = first_free_slot;
+		if(slot == Invalid_Index) {
+			slot = std::uint32_t(slots.size());
+			slots.push_back({Invalid_Index,1});
+		}
+		else first_free_slot = slots[slot].dense_index;
+
+		dense_slots.push_back(slot);
+		slots[slot].dense_index = std::uint32_t(dense_slots.size() - 1);
+		return {slot,slots[slot].generation};
+	}
+
+	std::uint32_t Pool_Slots::find(Pool_Handle handle) const noexcept {
+		//Freed slots already carry the generation of their next entity, which no handle has yet.
+		if(handle.index >= slots.size() || slots[handle.index].generation != handle.generation) return Invalid_Index;
+		return slots[handle.index].dense_index;
+	}
+
+	Pool_Handle Pool_Slots::handle(std::size_t dense_index) const noexcept {
+		auto slot = dense_slots[dense_index];
+		return {slot,slots[slot].generation};
+	}
+
+	void Pool_Slots::remove_at(std::size_t dense_index) noexcept {
+		auto slot = dense_slots[dense_index];
+		auto last_slot = dense_slots.back();
+		dense_slots[dense_index] = last_slot;
+		slots[last_slot].dense_index = std::uint32_t(dense_index);
+		dense_slots.pop_back();
+		release(slot);
+	}
+
+	void Pool_Slots::clear() noexcept {
+		for(auto slot : dense_slots) release(slot);
+		dense_slots.clear();
+	}
+
+	std::size_t Pool_Slots::memory_usage() const noexcept {
+		return core::reserved_bytes(slots) + core::reserved_bytes(dense_slots);
+	}
+
+	void Pool_Slots::release(std::uint32_t slot) noexcept {
+		slots[slot].generation += 1;
+		if(slots[slot].generation == 0) slots[slot].generation = 1;
+		slots[slot].dense_index = first_free_slot;
+		first_free_slot = slot;
+	}
+}
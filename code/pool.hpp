@@ -0,0 +1,131 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+namespace core {
+	//Refers to an entity in a pool. Handles of removed entities stay safe to use, they just don't find anything anymore.
+	struct Pool_Handle {
+		std::uint32_t index = 0;
+		//Zero never refers to an entity, so a default handle finds nothing.
+		std::uint32_t generation = 0;
+	};
+
+	/*	Maps stable handles to the dense indices of a pool's entities. The owner stores the entities in dense arrays of any layout and keeps them in step
+		with the calls below, so passes over the entities run over packed memory while handles keep referring to the same entity as others move around.
+		Adding, finding and removing one entity are O(1). Once reserved, at most that many entities are alive and adding more fails, so nothing is
+		allocated anymore. */
+	class Pool_Slots {
+	public:
+		static inline constexpr std::uint32_t Invalid_Index = std::uint32_t(-1);
+
+		//Also the most entities the pool holds from then on.
+		void reserve(std::size_t capacity);
+		//The new entity goes to the end of the dense arrays. Fails if the pool is full.
+		Pool_Handle add();
+		//Dense index of the entity, 'Invalid_Index' once it was removed.
+		[[nodiscard]] std::uint32_t find(Pool_Handle handle) const noexcept;
+		[[nodiscard]] Pool_Handle handle(std::size_t dense_index) const noexcept;
+		//The last entity moves into the place of the removed one.
+		void remove_at(std::size_t dense_index) noexcept;
+		//Removes the entities 'removed(dense_index)' is true for, the last entity takes the place of each removed one. 'move(from,to)' is called for every
+		//entity moving and has to move whatever 'removed' reads as well, the moved entity is tested next.
+		template<typename Removed,typename Move>
+		void remove_if(Removed removed,Move move);
+		void clear() noexcept;
+		[[nodiscard]] std::size_t size() const noexcept { return dense_slots.size(); }
+		[[nodiscard]] bool full() const noexcept { return dense_slots.size() >= capacity; }
+		[[nodiscard]] std::size_t memory_usage() const noexcept;
+	private:
+		struct Slot {
+			//Next free slot while the slot is free.
+			std::uint32_t dense_index;
+			std::uint32_t generation;
+		};
+
+		void release(std::uint32_t slot) noexcept;
+
+		std::vector<Slot> slots;
+		//Slot of every entity in dense order.
+		std::vector<std::uint32_t> dense_slots;
+		std::uint32_t first_free_slot = Invalid_Index;
+		//Unlimited until reserved.
+		std::size_t capacity = std::size_t(-1);
+	};
+
+	template<typename Removed,typename Move>
+	void Pool_Slots::remove_if(Removed removed,Move move) {
+		for(std::size_t i = 0;i < dense_slots.size();) {
+			if(!removed(i)) {
+				i += 1;
+				continue;
+			}
+			if(i + 1 != dense_slots.size()) move(dense_slots.size() - 1,i);
+			remove_at(i);
+		}
+	}
+
+	//Entities of one type stored densely and referred to by handles, see 'Pool_Slots'.
+	template<typename T>
+	class Pool {
+	public:
+		void reserve(std::size_t capacity) {
+			slots.reserve(capacity);
+			items.reserve(capacity);
+		}
+		//Returns a handle that finds nothing if the pool is full.
+		Pool_Handle insert(const T& item) {
+			if(slots.full()) return {};
+			items.push_back(item);
+			return slots.add();
+		}
+		[[nodiscard]] T* find(Pool_Handle handle) noexcept {
+			auto index = slots.find(handle);
+			return (index != Pool_Slots::Invalid_Index) ? &items[index] : nullptr;
+		}
+		[[nodiscard]] const T* find(Pool_Handle handle) const noexcept {
+			auto index = slots.find(handle);
+			return (index != Pool_Slots::Invalid_Index) ? &items[index] : nullptr;
+		}
+		[[nodiscard]] Pool_Handle handle(std::size_t index) const noexcept { return slots.handle(index); }
+		//Index of the entity, 'Pool_Slots::Invalid_Index' once it was removed.
+		[[nodiscard]] std::uint32_t index(Pool_Handle handle) const noexcept { return slots.find(handle); }
+		//The last entity takes the place of the removed one. Returns false if the entity was already gone.
+		bool remove(Pool_Handle handle) noexcept {
+			auto index = slots.find(handle);
+			if(index == Pool_Slots::Invalid_Index) return false;
+			slots.remove_at(index);
+			if(index + 1 != items.size()) items[index] = std::move(items.back());
+			items.pop_back();
+			return true;
+		}
+		//Removes the entities 'predicate' is true for, the last entity takes the place of each removed one.
+		template<typename Predicate>
+		void remove_if(Predicate predicate) {
+			slots.remove_if([&](std::size_t index) { return predicate(items[index]); },[&](std::size_t from,std::size_t to) { items[to] = std::move(items[from]); });
+			items.erase(items.begin() + std::ptrdiff_t(slots.size()),items.end());
+		}
+		void clear() noexcept {
+			slots.clear();
+			items.clear();
+		}
+		[[nodiscard]] std::size_t size() const noexcept { return items.size(); }
+		[[nodiscard]] bool empty() const noexcept { return items.empty(); }
+		[[nodiscard]] bool full() const noexcept { return slots.full(); }
+		[[nodiscard]] std::size_t memory_usage() const noexcept { return slots.memory_usage() + items.capacity() * sizeof(T); }
+		[[nodiscard]] T& operator[](std::size_t index) noexcept { return items[index]; }
+		[[nodiscard]] const T& operator[](std::size_t index) const noexcept { return items[index]; }
+		[[nodiscard]] auto begin() noexcept { return items.begin(); }
+		[[nodiscard]] auto end() noexcept { return items.end(); }
+		[[nodiscard]] auto begin() const noexcept { return items.begin(); }
+		[[nodiscard]] auto end() const noexcept { return items.end(); }
+	private:
+		Pool_Slots slots;
+		std::vector<T> items;
+	};
+}
+
+#endif
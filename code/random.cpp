@@ -0,0 +1,120 @@
+#include "math.hpp"
+#include "random.hpp"
+
+#if defined(CORE_SSE2)
+	#include <emmintrin.h>
+#endif
+
+namespace core {
+	static constexpr std::uint32_t Philox_Multiplier_0 = 0xD2511F53;
+	static constexpr std::uint32_t Philox_Multiplier_1 = 0xCD9E8D57;
+	static constexpr std::uint32_t Philox_Key_Bump_0 = 0x9E3779B9;
+	static constexpr std::uint32_t Philox_Key_Bump_1 = 0xBB67AE85;
+	static constexpr std::uint32_t Philox_Round_Count = 10;
+
+	Random_Block philox4x32(Random_Key key,std::uint32_t tick,std::uint32_t purpose,std::uint32_t block_index) noexcept {
+		std::uint32_t c0 = block_index,c1 = tick,c2 = purpose,c3 = 0;
+		std::uint32_t k0 = key.match_seed,k1 = key.entity_id;
+		for(std::uint32_t round = 0;round < Philox_Round_Count;round += 1) {
+			std::uint64_t product0 = std::uint64_t(Philox_Multiplier_0) * c0;
+			std::uint64_t product1 = std::uint64_t(Philox_Multiplier_1) * c2;
+			std::uint32_t new_c0 = std::uint32_t(product1 >> 32) ^ c1 ^ k0;
+			std::uint32_t new_c2 = std::uint32_t(product0 >> 32) ^ c3 ^ k1;
+			c1 = std::uint32_t(product1);
+			c3 = std::uint32_t(product0);
+			c0 = new_c0;
+			c2 = new_c2;
+			k0 += Philox_Key_Bump_0;
+			k1 += Philox_Key_Bump_1;
+		}
+		return {c0,c1,c2,c3};
+	}
+
+	std::uint32_t Random_Stream::next_u32() noexcept {
+		if(used_count == 4) {
+			block = core::philox4x32(key,tick,purpose,block_index);
+			block_index += 1;
+			used_count = 0;
+		}
+		return block[used_count++];
+	}
+
+	std::uint32_t Random_Stream::next_below(std::uint32_t bound) noexcept {
+		//Multiply and shift instead of modulo, the bias is negligible for the small bounds used in the game.
+		return std::uint32_t((std::uint64_t(next_u32()) * bound) >> 32);
+	}
+
+#if defined(CORE_SSE2)
+	//Computes four consecutive blocks at once, lane i holds block 'first_block_index' + i. Outputs are stored block after block like the scalar version.
+	static void philox4x32_sse2(Random_Key key,std::uint32_t tick,std::uint32_t purpose,std::uint32_t first_block_index,std::uint32_t* out) noexcept {
+		__m128i c0 = _mm_add_epi32(_mm_set1_epi32(int(first_block_index)),_mm_setr_epi32(0,1,2,3));
+		__m128i c1 = _mm_set1_epi32(int(tick));
+		__m128i c2 = _mm_set1_epi32(int(purpose));
+		__m128i c3 = _mm_setzero_si128();
+		std::uint32_t k0 = key.match_seed,k1 = key.entity_id;
+		const __m128i multiplier0 = _mm_set1_epi32(int(Philox_Multiplier_0));
+		const __m128i multiplier1 = _mm_set1_epi32(int(Philox_Multiplier_1));
+
+		//SSE2 only multiplies the even lanes into 64-bit products, the odd lanes are shifted down and multiplied separately.
+		auto multiply_hi_lo = [](__m128i a,__m128i multiplier,__m128i* hi,__m128i* lo) {
+			__m128i even = _mm_shuffle_epi32(_mm_mul_epu32(a,multiplier),_MM_SHUFFLE(3,1,2,0));
+			__m128i odd = _mm_shuffle_epi32(_mm_mul_epu32(_mm_srli_epi64(a,32),multiplier),_MM_SHUFFLE(3,1,2,0));
+			*lo = _mm_unpacklo_epi32(even,odd);
+			*hi = _mm_unpackhi_epi32(even,odd);
+		};
+		for(std::uint32_t round = 0;round < Philox_Round_Count;round += 1) {
+			__m128i hi0,lo0,hi1,lo1;
+			multiply_hi_lo(c0,multiplier0,&hi0,&lo0);
+			multiply_hi_lo(c2,multiplier1,&hi1,&lo1);
+			c0 = _mm_xor_si128(_mm_xor_si128(hi1,c1),_mm_set1_epi32(int(k0)));
+			c2 = _mm_xor_si128(_mm_xor_si128(hi0,c3),_mm_set1_epi32(int(k1)));
+			c1 = lo1;
+			c3 = lo0;
+			k0 += Philox_Key_Bump_0;
+			k1 += Philox_Key_Bump_1;
+		}
+
+		//Transpose from one word per register to one block per register.
+		__m128i t0 = _mm_unpacklo_epi32(c0,c1);
+		__m128i t1 = _mm_unpacklo_epi32(c2,c3);
+		__m128i t2 = _mm_unpackhi_epi32(c0,c1);
+		__m128i t3 = _mm_unpackhi_epi32(c2,c3);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 0),_mm_unpacklo_epi64(t0,t1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4),_mm_unpackhi_epi64(t0,t1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8),_mm_unpacklo_epi64(t2,t3));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12),_mm_unpackhi_epi64(t2,t3));
+	}
+#endif
+
+	void fill_random_u32(Random_Key key,std::uint32_t tick,std::uint32_t purpose,std::uint32_t* out,std::size_t count) noexcept {
+		std::size_t i = 0;
+		std::uint32_t block_index = 0;
+#if defined(CORE_SSE2)
+		for(;i + 16 <= count;i += 16,block_index += 4) core::philox4x32_sse2(key,tick,purpose,block_index,out + i);
+#endif
+		for(;i < count;block_index += 1) {
+			auto block = core::philox4x32(key,tick,purpose,block_index);
+			for(std::size_t j = 0;j < 4 && i < count;j += 1,i += 1) out[i] = block[j];
+		}
+	}
+
+	void fill_random_floats(Random_Key key,std::uint32_t tick,std::uint32_t purpose,float* out,std::size_t count) noexcept {
+		std::size_t i = 0;
+		std::uint32_t block_index = 0;
+#if defined(CORE_SSE2)
+		alignas(16) std::uint32_t values[16];
+		const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+		for(;i + 16 <= count;i += 16,block_index += 4) {
+			core::philox4x32_sse2(key,tick,purpose,block_index,values);
+			for(std::size_t j = 0;j < 16;j += 4) {
+				__m128i bits = _mm_srli_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(values + j)),8);
+				_mm_storeu_ps(out + i + j,_mm_mul_ps(_mm_cvtepi32_ps(bits),scale));
+			}
+		}
+#endif
+		for(;i < count;block_index += 1) {
+			auto block = core::philox4x32(key,tick,purpose,block_index);
+			for(std::size_t j = 0;j < 4 && i < count;j += 1,i += 1) out[i] = core::random_u32_to_float(block[j]);
+		}
+	}
+}
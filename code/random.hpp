@@ -0,0 +1,45 @@
+#ifndef RANDOM_HPP
+#define RANDOM_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace core {
+	/*	Counter-based random numbers (Philox4x32-10). Every output is a pure function of a key and a counter, there is no state to share.
+		Systems key their numbers by match seed and entity id and count by tick and purpose, so they can draw in any order or in parallel and still get the same results. */
+	struct Random_Key {
+		std::uint32_t match_seed;
+		std::uint32_t entity_id;
+	};
+	using Random_Block = std::array<std::uint32_t,4>;
+
+	//Block 'block_index' of the stream identified by 'key', 'tick' and 'purpose'.
+	[[nodiscard]] Random_Block philox4x32(Random_Key key,std::uint32_t tick,std::uint32_t purpose,std::uint32_t block_index) noexcept;
+	//Maps the top 24 bits to [0, 1), exactly representable so SIMD and scalar code agree.
+	[[nodiscard]] inline float random_u32_to_float(std::uint32_t value) noexcept { return float(value >> 8) * (1.0f / 16777216.0f); }
+
+	//Sequential view of one (key, tick, purpose) stream. Cheap to create, meant to live for the duration of a single decision.
+	class Random_Stream {
+	public:
+		Random_Stream(Random_Key _key,std::uint32_t _tick,std::uint32_t _purpose) noexcept : key(_key),tick(_tick),purpose(_purpose),block_index(),block(),used_count(4) {}
+		[[nodiscard]] std::uint32_t next_u32() noexcept;
+		//In [0, 1).
+		[[nodiscard]] float next_float() noexcept { return core::random_u32_to_float(next_u32()); }
+		//In [0, 'bound'), 'bound' must not be 0.
+		[[nodiscard]] std::uint32_t next_below(std::uint32_t bound) noexcept;
+	private:
+		Random_Key key;
+		std::uint32_t tick;
+		std::uint32_t purpose;
+		std::uint32_t block_index;
+		Random_Block block;
+		std::uint32_t used_count;
+	};
+
+	//Fill 'out' with the first 'count' values of a stream, the same values 'Random_Stream' would return. Uses SSE2 to compute four blocks at once where available.
+	void fill_random_u32(Random_Key key,std::uint32_t tick,std::uint32_t purpose,std::uint32_t* out,std::size_t count) noexcept;
+	void fill_random_floats(Random_Key key,std::uint32_t tick,std::uint32_t purpose,float* out,std::size_t count) noexcept;
+}
+
+#endif
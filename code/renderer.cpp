@@ -1,24 +1,41 @@
 #include <new>
+#include <list>
+#include <chrono>
+#include <memory>
 #include <cctype>
 #include <cstdio>
 #include <vector>
+#include <string>
 #include <cstring>
+#include <utility>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <optional>
+#include <algorithm>
 #include <cinttypes>
 #include <filesystem>
+#include <unordered_map>
 #include "defer.hpp"
 #include "opengl.hpp"
 #include "renderer.hpp"
 #include "platform.hpp"
+#include "random.hpp"
+#include "file_io.hpp"
 #include "exceptions.hpp"
+#include "memory_telemetry.hpp"
+
+#if defined(CORE_SSE2)
+	#include <emmintrin.h>
+#endif
+#if defined(CORE_X86)
+	#include <immintrin.h>
+#endif
 
 namespace core {
 	//Using 'std140' layout in shaders, requires every member be aligned to 16 bytes.
+	//Matrices are kept apart in 'Sprite::matrices', so that a whole batch of them is moved by the camera with a single 'multiply'.
 	struct Object_Data {
-		alignas(16) Mat4 matrix;
 		alignas(16) std::uint32_t texture_index;
 		alignas(16) Vec4 multiply_color;
 		alignas(16) std::uint32_t effect_id;
@@ -26,13 +43,32 @@ namespace core {
 
 	struct Sprite {
 		bool has_value;
+		//Non-resident sprites only know their layout, the texture is read from 'file_path' the first time they are drawn.
+		bool resident;
+		//The file is being read and decoded in the background, the placeholder is drawn in the meantime.
+		bool load_pending;
+		//Set when the file couldn't be read or decoded, the placeholder is kept until the file is hot-reloaded.
+		bool load_failed;
+		//Pinned sprites are never evicted, e.g. the placeholder itself and the font.
+		bool pinned;
 		GLuint texture_id;
 		std::uint32_t generation;
+		std::uint32_t reference_count;
 		GLuint scene_data_uniform_buffer;
+		//Relative to the map until the sprite is flushed, the camera is applied to all of them at once then.
+		std::vector<Mat4> matrices;
 		std::vector<Object_Data> object_datas;
 		std::size_t current_object_data_index;
 		std::uint32_t array_layers;
 		std::uint32_t layer_size;
+		Dimensions layer_dimensions;
+		//Used to find out which layers have to be uploaded again when the image file changes.
+		std::vector<std::uint64_t> layer_hashes;
+		std::string file_path;
+		std::size_t resident_byte_count;
+		std::uint64_t last_used_frame;
+		//Position in 'Renderer_Internal_Data::lru_sprites', only valid while the sprite is resident and not pinned.
+		std::list<std::size_t>::iterator lru_position;
 	};
 
 	struct Font_Character_Info {
@@ -45,14 +81,29 @@ namespace core {
 		GLuint shader_program;
 		GLuint sprite_vertex_array_id;
 		GLuint sprite_buffer_id;
+		std::size_t sprite_buffer_byte_count;
 		std::vector<Sprite> sprites;
 		std::size_t object_data_uniform_buffer_size;
+		//Number of quads that fit into the uniform buffer of a sprite, each takes a matrix and an 'Object_Data'.
+		std::size_t object_data_capacity;
 		Sprite_Index font_sprite;
 		std::vector<Font_Character_Info> font_character_infos;
 		std::uint32_t font_largest_y_baseline_offset;
 		GLint time_uniform_location;
 		float time;
 		Urect render_rect;
+		//Keys are normalized paths, see 'normalized_file_path'.
+		std::unordered_map<std::string,std::size_t> sprite_indices_by_path;
+		std::vector<std::size_t> free_sprite_indices;
+		//Resident sprites that can be evicted, the least recently drawn one first.
+		std::list<std::size_t> lru_sprites;
+		std::size_t resident_texture_byte_count;
+		std::size_t texture_memory_budget;
+		std::uint64_t frame_index;
+		Vec2 camera;
+		//Drawn in place of sprites whose texture is still being loaded.
+		Sprite_Index placeholder_sprite;
+		Async_File_Io* file_io;
 	};
 
 	static constexpr const char Vertex_Shader_Source_Format[] = R"xxx(
@@ -65,16 +116,16 @@ namespace core {
 		out flat uint out_effect_id;
 		uniform mat4 projection_matrix;
 		struct Object_Data {
-			mat4 matrix;
 			uint texture_index;
 			vec4 multiply_color;
 			uint effect_id;
 		};
 		layout(std140,binding = 0) uniform Scene_Data {
+			mat4[%zu] matrices;
 			Object_Data[%zu] object_datas;
 		};
 		void main() {
-			gl_Position = projection_matrix * object_datas[gl_InstanceID].matrix * vec4(position,1.0);
+			gl_Position = projection_matrix * matrices[gl_InstanceID] * vec4(position,1.0);
 			out_tex_coords = tex_coords;
 			out_texture_index = object_datas[gl_InstanceID].texture_index;
 			out_multiply_color = object_datas[gl_InstanceID].multiply_color;
@@ -147,9 +198,98 @@ namespace core {
 					 "\n" << message << "\n" << std::endl;
 	}
 
+	[[nodiscard]] static std::vector<std::uint8_t> read_whole_file(const char* file_path) {
+		static char static_file_path[2048];
+		std::strcpy(static_file_path,file_path);
+
+		auto file = std::ifstream(file_path,std::ios::binary);
+		if(!file.is_open()) throw File_Open_Exception(static_file_path);
+
+		std::error_code error_code{};
+		std::size_t file_size = std::size_t(std::filesystem::file_size(file_path,error_code));
+		if(error_code) throw File_Exception(static_file_path,"Couldn't query the file size");
+
+		std::vector<std::uint8_t> bytes{};
+		bytes.resize(file_size);
+		if(!file.read(reinterpret_cast<char*>(bytes.data()),std::streamsize(file_size))) throw File_Read_Exception(static_file_path,file_size);
+		return bytes;
+	}
+
+	//Reads just enough of a bitmap to know the layout of the texture it will become, so sprites can be registered without decoding them.
+	[[nodiscard]] static Dimensions read_bitmap_dimensions(const char* file_path) {
+		static char static_file_path[2048];
+		std::strcpy(static_file_path,file_path);
+
+		auto file = std::ifstream(file_path,std::ios::binary);
+		if(!file.is_open()) throw File_Open_Exception(static_file_path);
+
+		//'BITMAPFILEHEADER' is 14 bytes, width and height are the 2nd and 3rd field of the info header that follows.
+		std::uint8_t header[26] = {};
+		if(!file.read(reinterpret_cast<char*>(header),sizeof(header))) throw File_Read_Exception(static_file_path,sizeof(header));
+		if(header[0] != 'B' || header[1] != 'M') throw File_Exception(static_file_path,"Invalid bitmap signature");
+
+		std::int32_t width = 0,height = 0;
+		std::memcpy(&width,&header[18],sizeof(width));
+		std::memcpy(&height,&header[22],sizeof(height));
+		if(width <= 0) throw Runtime_Exception("Width must be > 0");
+		if(height <= 0) throw Runtime_Exception("Height must be > 0");
+		return {std::uint32_t(width),std::uint32_t(height)};
+	}
+
+	//Draws every quad queued for the sprite using instancing.
+	static void flush_sprite(Sprite& sprite,Vec2 camera) {
+		if(sprite.current_object_data_index == 0) return;
+		const Mat4 view = core::translate(-camera.x,-camera.y,0.0f);
+		core::multiply(view,sprite.matrices.data(),sprite.matrices.data(),sprite.current_object_data_index);
+		glBindBufferBase(GL_UNIFORM_BUFFER,0,sprite.scene_data_uniform_buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER,0,sprite.current_object_data_index * sizeof(Mat4),sprite.matrices.data());
+		glBufferSubData(GL_UNIFORM_BUFFER,sprite.matrices.size() * sizeof(Mat4),sprite.current_object_data_index * sizeof(Object_Data),sprite.object_datas.data());
+		glBindTexture(GL_TEXTURE_2D_ARRAY,sprite.texture_id);
+		glDrawArraysInstanced(GL_TRIANGLES,0,6,GLsizei(sprite.current_object_data_index));
+		sprite.current_object_data_index = 0;
+	}
+
+	static void evict_sprite(Renderer_Internal_Data& data,Sprite& sprite) noexcept {
+		if(!sprite.resident) return;
+		if(!sprite.pinned) data.lru_sprites.erase(sprite.lru_position);
+		glDeleteBuffers(1,&sprite.scene_data_uniform_buffer);
+		glDeleteTextures(1,&sprite.texture_id);
+		sprite.texture_id = 0;
+		sprite.scene_data_uniform_buffer = 0;
+		sprite.matrices = {};
+		sprite.object_datas = {};
+		sprite.layer_hashes = {};
+		sprite.current_object_data_index = 0;
+		data.resident_texture_byte_count -= sprite.resident_byte_count;
+		sprite.resident_byte_count = 0;
+		sprite.resident = false;
+	}
+
+	//Takes the sprite out of the eviction order for good.
+	static void pin_sprite(Renderer_Internal_Data& data,Sprite& sprite) noexcept {
+		if(sprite.pinned) return;
+		if(sprite.resident) data.lru_sprites.erase(sprite.lru_position);
+		sprite.pinned = true;
+	}
+
+	//Evicts the least recently drawn sprites until 'incoming_byte_count' more bytes fit into the budget.
+	//Sprites drawn during the current frame are never evicted, so the budget may be exceeded temporarily.
+	static void evict_sprites_over_budget(Renderer_Internal_Data& data,std::size_t incoming_byte_count) noexcept {
+		while(data.resident_texture_byte_count + incoming_byte_count > data.texture_memory_budget && !data.lru_sprites.empty()) {
+			//The list is ordered by the last draw, once its front was drawn during this frame every sprite in it was.
+			Sprite* least_recently_used = &data.sprites[data.lru_sprites.front()];
+			if(least_recently_used->last_used_frame >= data.frame_index) return;
+#if defined(DEBUG_BUILD)
+			std::cout << "[Rendering] Evicting \"" << least_recently_used->file_path << "\" (" << least_recently_used->resident_byte_count << " bytes)." << std::endl;
+#endif
+			core::evict_sprite(data,*least_recently_used);
+		}
+	}
+
 	Renderer::Renderer(Platform* _platform) try : platform(_platform),data_buffer() {
 		static_assert(sizeof(Renderer_Internal_Data) <= sizeof(data_buffer));
 		Renderer_Internal_Data& data = *new(data_buffer) Renderer_Internal_Data();
+		data.texture_memory_budget = Default_Texture_Memory_Budget;
 
 		glDisable(GL_DITHER);
 		glDisable(GL_MULTISAMPLE);
@@ -172,6 +312,7 @@ namespace core {
 			static constexpr std::size_t Desired_Uniform_Buffer_Size = 65536;
 			if(std::size_t(max_uniform_buffer_size) < Desired_Uniform_Buffer_Size) data.object_data_uniform_buffer_size = max_uniform_buffer_size;
 			else data.object_data_uniform_buffer_size = Desired_Uniform_Buffer_Size;
+			data.object_data_capacity = data.object_data_uniform_buffer_size / (sizeof(Mat4) + sizeof(Object_Data));
 		}
 
 		auto create_shader = [&](GLenum type,const char* type_string,const char* source,std::size_t source_byte_length){
@@ -197,7 +338,7 @@ namespace core {
 		{
 			char vertex_shader_formatted_source[4096] = {};
 			int format_result = std::snprintf(vertex_shader_formatted_source,sizeof(vertex_shader_formatted_source) - 1,
-											  Vertex_Shader_Source_Format,data.object_data_uniform_buffer_size / sizeof(Object_Data));
+											  Vertex_Shader_Source_Format,data.object_data_capacity,data.object_data_capacity);
 			if(format_result < 0) throw Runtime_Exception("Couldn't preprocess the vertex shader source.");
 
 			GLuint vertex_shader = create_shader(GL_VERTEX_SHADER,"GL_VERTEX_SHADER",vertex_shader_formatted_source,sizeof(vertex_shader_formatted_source) - 1);
@@ -253,6 +394,7 @@ namespace core {
 			GLint64 actual_buffer_size = 0;
 			glGetBufferParameteri64v(GL_ARRAY_BUFFER,GL_BUFFER_SIZE,&actual_buffer_size);
 			if(std::size_t(actual_buffer_size) != sizeof(Sprite_Vertices)) throw Runtime_Exception("Couldn't allocate quad vertex buffer memory.");
+			data.sprite_buffer_byte_count = sizeof(Sprite_Vertices);
 
 			glGenVertexArrays(1,&data.sprite_vertex_array_id);
 			glBindVertexArray(data.sprite_vertex_array_id);
@@ -264,7 +406,20 @@ namespace core {
 			glVertexAttribPointer(tex_coords_location,2,GL_FLOAT,GL_FALSE,sizeof(Vertex),reinterpret_cast<void*>(3 * sizeof(float)));
 		}
 		adjust_viewport();
-		data.font_sprite = sprite_atlas("./assets/font_16x16.bmp",16);
+		{
+			//A single grey texel, stretched over the quad of whatever sprite it stands in for.
+			Decoded_Image placeholder{1,1,0,{128,128,128,255}};
+			data.placeholder_sprite = insert_sprite("",1,0);
+			core::pin_sprite(data,data.sprites[data.placeholder_sprite.index]);
+			upload_sprite(data.placeholder_sprite,placeholder);
+		}
+		{
+			//Text is drawn from the first frame on, so the font isn't loaded lazily. It would flicker if its texture could be evicted and loaded again.
+			static constexpr const char* Font_Sprite_File_Path = "./assets/font_16x16.bmp";
+			auto font_bytes = core::read_whole_file(Font_Sprite_File_Path);
+			data.font_sprite = sprite_atlas(Font_Sprite_File_Path,font_bytes.data(),font_bytes.size(),16);
+		}
+		core::pin_sprite(data,data.sprites[data.font_sprite.index]);
 		{
 			static constexpr const char* Font_Info_File_Path = "./assets/font_16x16.txt";
 			auto file = std::ifstream(Font_Info_File_Path,std::ios::binary);
@@ -305,10 +460,14 @@ namespace core {
 	void Renderer::destroy() noexcept {
 		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
 		for(auto& sprite : data.sprites) {
+			if(!sprite.resident) continue;
 			glDeleteBuffers(1,&sprite.scene_data_uniform_buffer);
 			glDeleteTextures(1,&sprite.texture_id);
 		}
 		data.sprites.clear();
+		data.sprite_indices_by_path.clear();
+		data.free_sprite_indices.clear();
+		data.lru_sprites.clear();
 
 		if(glIsVertexArray(data.sprite_vertex_array_id))
 			glDeleteVertexArrays(1,&data.sprite_vertex_array_id);
@@ -332,13 +491,11 @@ namespace core {
 	void Renderer::end() {
 		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
 		for(auto& sprite : data.sprites) {
-			if(!sprite.has_value || sprite.current_object_data_index == 0) continue;
-			glBindBufferBase(GL_UNIFORM_BUFFER,0,sprite.scene_data_uniform_buffer);
-			glBufferSubData(GL_UNIFORM_BUFFER,0,sprite.current_object_data_index * sizeof(Object_Data),sprite.object_datas.data());
-			glBindTexture(GL_TEXTURE_2D_ARRAY,sprite.texture_id);
-			glDrawArraysInstanced(GL_TRIANGLES,0,6,GLsizei(sprite.current_object_data_index));
-			sprite.current_object_data_index = 0;
+			if(!sprite.has_value) continue;
+			core::flush_sprite(sprite,data.camera);
 		}
+		core::evict_sprites_over_budget(data,0);
+		data.frame_index += 1;
 	}
 
 	void Renderer::draw_sprite(Vec3 position,Vec2 size,float rotation,const Sprite_Index& sprite_index,std::uint32_t sprite_layer_index) {
@@ -367,19 +524,24 @@ namespace core {
 		if(sprite.generation != sprite_index.generation || !sprite.has_value) throw Runtime_Exception("Invalid sprite index (outdated).");
 		if(sprite_layer_index >= sprite.array_layers) throw Runtime_Exception("Invalid sprite tile index.");
 #endif
+		if(!sprite.resident) {
+			load_sprite(sprite_index);
+			//Loads without 'Async_File_Io' finish right away.
+			if(!sprite.resident) {
+				draw_sprite(position,size,rotation,color,false,data.placeholder_sprite,0);
+				return;
+			}
+		}
+		//Only the first draw of a frame moves the sprite to the back of the list.
+		if(sprite.last_used_frame != data.frame_index && !sprite.pinned) data.lru_sprites.splice(data.lru_sprites.end(),data.lru_sprites,sprite.lru_position);
+		sprite.last_used_frame = data.frame_index;
 
 		//We render sprites by putting their transformation and texture data inside an uniform buffer designated for the texture we use in rendering.
 		//When that buffers is full or at the end of a frame, we render all of the sprites that use a particular texture at once using instancing.
-		if((sprite.current_object_data_index + 1) >= sprite.object_datas.size()) {
-			glBindBufferBase(GL_UNIFORM_BUFFER,0,sprite.scene_data_uniform_buffer);
-			glBufferSubData(GL_UNIFORM_BUFFER,0,sprite.current_object_data_index * sizeof(Object_Data),sprite.object_datas.data());
-			glBindTexture(GL_TEXTURE_2D_ARRAY,sprite.texture_id);
-			glDrawArraysInstanced(GL_TRIANGLES,0,6,GLsizei(sprite.current_object_data_index));
-			sprite.current_object_data_index = 0;
-		}
+		if((sprite.current_object_data_index + 1) >= sprite.object_datas.size()) core::flush_sprite(sprite,data.camera);
 
+		sprite.matrices[sprite.current_object_data_index] = core::sprite_transform(position,size,rotation);
 		auto& object_data = sprite.object_datas[sprite.current_object_data_index];
-		object_data.matrix = core::translate(position.x,position.y,position.z) * core::rotate(rotation) * core::scale(size.x,size.y,1);
 		object_data.texture_index = sprite_layer_index;
 		object_data.multiply_color = color;
 		object_data.effect_id = std::uint32_t(rainbow_effect);
@@ -410,6 +572,17 @@ namespace core {
 		}
 	}
 
+	void Renderer::set_camera(Vec2 position) noexcept {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		//Queued quads are moved by the camera when they are flushed, so every batch has to be drawn with a single camera.
+		if(position.x != data.camera.x || position.y != data.camera.y) {
+			for(auto& sprite : data.sprites) {
+				if(sprite.has_value) core::flush_sprite(sprite,data.camera);
+			}
+		}
+		data.camera = position;
+	}
+
 	Rect Renderer::compute_text_dims(Vec3 position,Vec2 char_size,const char* text) {
 		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
 		float layer_size = float(data.sprites[data.font_sprite.index].layer_size);
@@ -442,22 +615,106 @@ namespace core {
 		return dims;
 	}
 
-	[[nodiscard]] static std::vector<std::uint8_t> load_bitmap_from_file(const char* file_path,std::uint32_t* out_width,std::uint32_t* out_height) {
-		static char static_file_path[2048];
-		std::strcpy(static_file_path,file_path);
+	//Right shifts that move each channel of a BI_BITFIELDS pixel into the lowest byte.
+	struct Bitmap_Channel_Shifts {
+		std::uint32_t red;
+		std::uint32_t green;
+		std::uint32_t blue;
+		std::uint32_t alpha;
+	};
 
-		auto file = std::ifstream(file_path,std::ios::binary);
-		if(!file.is_open()) throw File_Open_Exception(static_file_path);
+	//Almost every bitmap exported by image editors uses 8-bit channels that sit on byte boundaries (e.g. BGRA).
+	//Such masks can be decoded with plain shifts which lets us process many pixels at once.
+	[[nodiscard]] static bool is_byte_aligned_channel_mask(std::uint32_t mask) noexcept {
+		return mask == 0x000000FFu || mask == 0x0000FF00u || mask == 0x00FF0000u || mask == 0xFF000000u;
+	}
 
+	static void swizzle_bitmap_pixels_scalar(const std::uint8_t* src,std::uint8_t* dst,std::size_t pixel_count,const Bitmap_Channel_Shifts& shifts) noexcept {
+		for(std::size_t i = 0;i < pixel_count;i += 1) {
+			std::uint32_t value = 0;
+			std::memcpy(&value,&src[i * 4],4);
+			dst[i * 4 + 0] = std::uint8_t(value >> shifts.red);
+			dst[i * 4 + 1] = std::uint8_t(value >> shifts.green);
+			dst[i * 4 + 2] = std::uint8_t(value >> shifts.blue);
+			dst[i * 4 + 3] = std::uint8_t(value >> shifts.alpha);
+		}
+	}
+
+#if defined(CORE_SSE2)
+	static void swizzle_bitmap_pixels_sse2(const std::uint8_t* src,std::uint8_t* dst,std::size_t pixel_count,const Bitmap_Channel_Shifts& shifts) noexcept {
+		const __m128i byte_mask = _mm_set1_epi32(0xFF);
+		const __m128i red_shift = _mm_cvtsi32_si128(int(shifts.red));
+		const __m128i green_shift = _mm_cvtsi32_si128(int(shifts.green));
+		const __m128i blue_shift = _mm_cvtsi32_si128(int(shifts.blue));
+		const __m128i alpha_shift = _mm_cvtsi32_si128(int(shifts.alpha));
+
+		std::size_t i = 0;
+		for(;i + 4 <= pixel_count;i += 4) {
+			__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&src[i * 4]));
+			__m128i red = _mm_and_si128(_mm_srl_epi32(value,red_shift),byte_mask);
+			__m128i green = _mm_slli_epi32(_mm_and_si128(_mm_srl_epi32(value,green_shift),byte_mask),8);
+			__m128i blue = _mm_slli_epi32(_mm_and_si128(_mm_srl_epi32(value,blue_shift),byte_mask),16);
+			__m128i alpha = _mm_slli_epi32(_mm_srl_epi32(value,alpha_shift),24);
+			__m128i result = _mm_or_si128(_mm_or_si128(red,green),_mm_or_si128(blue,alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&dst[i * 4]),result);
+		}
+		core::swizzle_bitmap_pixels_scalar(&src[i * 4],&dst[i * 4],pixel_count - i,shifts);
+	}
+#endif
+
+#if defined(CORE_X86)
+	CORE_TARGET_AVX2 static void swizzle_bitmap_pixels_avx2(const std::uint8_t* src,std::uint8_t* dst,std::size_t pixel_count,const Bitmap_Channel_Shifts& shifts) noexcept {
+		const __m256i byte_mask = _mm256_set1_epi32(0xFF);
+		const __m128i red_shift = _mm_cvtsi32_si128(int(shifts.red));
+		const __m128i green_shift = _mm_cvtsi32_si128(int(shifts.green));
+		const __m128i blue_shift = _mm_cvtsi32_si128(int(shifts.blue));
+		const __m128i alpha_shift = _mm_cvtsi32_si128(int(shifts.alpha));
+
+		std::size_t i = 0;
+		for(;i + 8 <= pixel_count;i += 8) {
+			__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&src[i * 4]));
+			__m256i red = _mm256_and_si256(_mm256_srl_epi32(value,red_shift),byte_mask);
+			__m256i green = _mm256_slli_epi32(_mm256_and_si256(_mm256_srl_epi32(value,green_shift),byte_mask),8);
+			__m256i blue = _mm256_slli_epi32(_mm256_and_si256(_mm256_srl_epi32(value,blue_shift),byte_mask),16);
+			__m256i alpha = _mm256_slli_epi32(_mm256_srl_epi32(value,alpha_shift),24);
+			__m256i result = _mm256_or_si256(_mm256_or_si256(red,green),_mm256_or_si256(blue,alpha));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(&dst[i * 4]),result);
+		}
+		core::swizzle_bitmap_pixels_scalar(&src[i * 4],&dst[i * 4],pixel_count - i,shifts);
+	}
+#endif
+
+	using Swizzle_Bitmap_Pixels_Func = void(*)(const std::uint8_t*,std::uint8_t*,std::size_t,const Bitmap_Channel_Shifts&) noexcept;
+	[[nodiscard]] static Swizzle_Bitmap_Pixels_Func select_swizzle_bitmap_pixels_func() noexcept {
+#if defined(CORE_X86)
+		if(core::cpu_supports_avx2()) return &core::swizzle_bitmap_pixels_avx2;
+#endif
+#if defined(CORE_SSE2)
+		return &core::swizzle_bitmap_pixels_sse2;
+#else
+		return &core::swizzle_bitmap_pixels_scalar;
+#endif
+	}
+
+	//Pixels are returned as RGBA8. If 'tile_dimension' isn't 0, the image is treated as an atlas and every tile is stored contiguously in row-major tile order,
+	//so the result can be uploaded as a 'GL_TEXTURE_2D_ARRAY' with a single call.
+	[[nodiscard]] static std::vector<std::uint8_t> decode_bitmap(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count,std::uint32_t* out_width,std::uint32_t* out_height,std::uint32_t tile_dimension = 0) {
+		//Images may be decoded on worker threads, so each thread gets its own copy of the path.
+		static thread_local char static_file_path[2048];
+		std::strcpy(static_file_path,file_path);
+
+		std::size_t cursor = 0;
 		auto read = [&]<typename T>() {
+			if(file_byte_count - cursor < sizeof(T)) throw File_Read_Exception(static_file_path,sizeof(T));
 			T value = T();
-			if(!file.read(reinterpret_cast<char*>(&value),sizeof(value))) throw File_Read_Exception(static_file_path,sizeof(value));
+			std::memcpy(&value,&file_bytes[cursor],sizeof(value));
+			cursor += sizeof(value);
 			return value;
 		};
 
-		char magic_bytes[2] = {};
-		if(!file.read(magic_bytes,2)) throw File_Read_Exception(static_file_path,2);
-		if(magic_bytes[0] != 'B' || magic_bytes[1] != 'M') throw File_Exception(static_file_path,"Invalid magic bytes at the beginning");
+		auto magic_byte_0 = read.operator()<char>();
+		auto magic_byte_1 = read.operator()<char>();
+		if(magic_byte_0 != 'B' || magic_byte_1 != 'M') throw File_Exception(static_file_path,"Invalid magic bytes at the beginning");
 
 		[[maybe_unused]] auto bitmap_file_size = read.operator()<std::uint32_t>();
 		[[maybe_unused]] auto reserved_data = read.operator()<std::uint32_t>();
@@ -470,6 +727,7 @@ namespace core {
 		auto height = read.operator()<std::int32_t>();
 		if(width <= 0) throw Runtime_Exception("Width must be > 0");
 		if(height <= 0) throw Runtime_Exception("Height must be > 0");
+		if(tile_dimension != 0 && ((std::uint32_t(width) % tile_dimension) != 0 || (std::uint32_t(height) % tile_dimension) != 0)) throw Runtime_Exception("Invalid sprite atlas tile size.");
 
 		auto plane_count = read.operator()<std::uint16_t>();
 		if(plane_count != 1) throw File_Exception(static_file_path,"Plane count must be 1");
@@ -492,78 +750,179 @@ namespace core {
 		auto alpha_mask = read.operator()<std::uint32_t>();
 
 		//BITMAPV5HEADER has more fields, but we are ignoring them for simplicity.
-		if(!file.seekg(pixel_data_offset,std::ios::beg)) throw File_Seek_Exception(static_file_path,pixel_data_offset);
+		if(pixel_data_offset > file_byte_count) throw File_Seek_Exception(static_file_path,pixel_data_offset);
+
+		std::size_t row_byte_count = std::size_t(width) * 4;
+		std::size_t pixel_byte_count = row_byte_count * std::size_t(height);
+		if(file_byte_count - pixel_data_offset < pixel_byte_count) throw File_Read_Exception(static_file_path,pixel_byte_count);
+		const std::uint8_t* raw_pixels = &file_bytes[pixel_data_offset];
+
+		Bitmap_Channel_Shifts shifts = {};
+		Swizzle_Bitmap_Pixels_Func swizzle = nullptr;
+		if(is_byte_aligned_channel_mask(red_mask) && is_byte_aligned_channel_mask(green_mask) && is_byte_aligned_channel_mask(blue_mask) && is_byte_aligned_channel_mask(alpha_mask)) {
+			shifts = {core::leading_zeroes(red_mask),core::leading_zeroes(green_mask),core::leading_zeroes(blue_mask),core::leading_zeroes(alpha_mask)};
+			static const Swizzle_Bitmap_Pixels_Func fast_swizzle = core::select_swizzle_bitmap_pixels_func();
+			swizzle = fast_swizzle;
+		}
 
 		std::vector<std::uint8_t> pixels{};
-		pixels.resize(std::size_t(width) * height * 4);
-		//BMP files are stored fliped around the X axis so we need to read it backwards.
-		for(std::uint32_t y = 0;y < std::uint32_t(height);y += 1)
-			if(!file.read(reinterpret_cast<char*>(&pixels[(std::size_t(height) - y - 1) * width * 4]),std::size_t(width) * 4))
-				throw File_Read_Exception(static_file_path,std::size_t(width) * 4);
+		pixels.resize(pixel_byte_count);
+		auto convert_row_segment = [&](const std::uint8_t* src,std::uint8_t* dst,std::size_t pixel_count) {
+			if(swizzle) {
+				swizzle(src,dst,pixel_count,shifts);
+				return;
+			}
+			//Rare layouts (e.g. 10-bit channels or a missing alpha channel) take the slow path.
+			for(std::size_t i = 0;i < pixel_count;i += 1) {
+				std::uint32_t value = 0;
+				std::memcpy(&value,&src[i * 4],4);
+				dst[i * 4 + 0] = std::uint8_t((value & red_mask) >> core::leading_zeroes(red_mask));
+				dst[i * 4 + 1] = std::uint8_t((value & green_mask) >> core::leading_zeroes(green_mask));
+				dst[i * 4 + 2] = std::uint8_t((value & blue_mask) >> core::leading_zeroes(blue_mask));
+				dst[i * 4 + 3] = std::uint8_t((value & alpha_mask) >> core::leading_zeroes(alpha_mask));
+			}
+		};
 
-		for(std::size_t i = 0;i < pixels.size();i += 4) {
-			std::uint32_t value = (std::uint32_t(pixels[i + 3]) << 24u) | (std::uint32_t(pixels[i + 2]) << 16u) | (std::uint32_t(pixels[i + 1]) << 8u) | (std::uint32_t(pixels[i + 0]) << 0u);
-			pixels[i + 0] = ((value & red_mask) >> core::leading_zeroes(red_mask));
-			pixels[i + 1] = ((value & green_mask) >> core::leading_zeroes(green_mask));
-			pixels[i + 2] = ((value & blue_mask) >> core::leading_zeroes(blue_mask));
-			pixels[i + 3] = ((value & alpha_mask) >> core::leading_zeroes(alpha_mask));
+		//BMP files are stored fliped around the X axis so we need to read it backwards.
+		//Flipping and splitting the atlas into tiles are folded into the conversion so every pixel is touched only once.
+		for(std::uint32_t y = 0;y < std::uint32_t(height);y += 1) {
+			const std::uint8_t* src_row = &raw_pixels[(std::size_t(height) - y - 1) * row_byte_count];
+			if(tile_dimension == 0) {
+				convert_row_segment(src_row,&pixels[std::size_t(y) * row_byte_count],std::size_t(width));
+				continue;
+			}
+			std::uint32_t tile_count_x = std::uint32_t(width) / tile_dimension;
+			std::size_t tile_byte_count = std::size_t(tile_dimension) * tile_dimension * 4;
+			std::size_t tile_row_offset = std::size_t(y % tile_dimension) * tile_dimension * 4;
+			for(std::uint32_t tile_x = 0;tile_x < tile_count_x;tile_x += 1) {
+				std::size_t layer = std::size_t(y / tile_dimension) * tile_count_x + tile_x;
+				convert_row_segment(&src_row[std::size_t(tile_x) * tile_dimension * 4],&pixels[layer * tile_byte_count + tile_row_offset],tile_dimension);
+			}
 		}
 
-		*out_width = width;
-		*out_height = height;
+		*out_width = std::uint32_t(width);
+		*out_height = std::uint32_t(height);
 		return pixels;
 	}
 
 	Sprite_Index Renderer::sprite(const char* file_path) {
-		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		return acquire_sprite(file_path,0,nullptr,0);
+	}
 
-		std::uint32_t width = 0;
-		std::uint32_t height = 0;
-		std::vector<std::uint8_t> pixels = core::load_bitmap_from_file(file_path,&width,&height);
-#if defined(DEBUG_BUILD)
-		std::cout << "[Rendering] Loading an image from file \"" << file_path << "\" (width: " << width << ", height: " << height << ")." << std::endl;
-#endif
+	Sprite_Index Renderer::sprite(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count) {
+		return acquire_sprite(file_path,0,file_bytes,file_byte_count);
+	}
 
-		//We use 'GL_TEXTURE_2D_ARRAY' instead of 'GL_TEXTURE_2D' to simplify shaders.
-		GLuint texture_id = 0;
-		glGenTextures(1,&texture_id);
-		glBindTexture(GL_TEXTURE_2D_ARRAY,texture_id);
-		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_WRAP_S,GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_WRAP_T,GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
-		glTexImage3D(GL_TEXTURE_2D_ARRAY,0,GL_RGBA,width,height,1,0,GL_RGBA,GL_UNSIGNED_BYTE,pixels.data());
+	Sprite_Index Renderer::sprite_atlas(const char* file_path,std::uint32_t tile_dimension) {
+		return acquire_sprite(file_path,tile_dimension,nullptr,0);
+	}
 
-		//Each texture has its own uniform buffer for storing data related to quads rendered with the texture.
-		GLuint uniform_buffer_id = 0;
-		glGenBuffers(1,&uniform_buffer_id);
-		glBindBuffer(GL_UNIFORM_BUFFER,uniform_buffer_id);
-		glBufferData(GL_UNIFORM_BUFFER,data.object_data_uniform_buffer_size,nullptr,GL_DYNAMIC_DRAW);
+	Sprite_Index Renderer::sprite_atlas(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count,std::uint32_t tile_dimension) {
+		return acquire_sprite(file_path,tile_dimension,file_bytes,file_byte_count);
+	}
 
-		try {
-			GLint64 actual_size = 0;
-			glGetBufferParameteri64v(GL_UNIFORM_BUFFER,GL_BUFFER_SIZE,&actual_size);
-			if(data.object_data_uniform_buffer_size != std::size_t(actual_size)) throw Runtime_Exception("Couldn't allocate an uniform buffer.");
-			return insert_sprite(texture_id,uniform_buffer_id,1,0);
+	Decoded_Image Renderer::decode_image(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count,std::uint32_t tile_dimension) {
+		Decoded_Image image{};
+		image.tile_dimension = tile_dimension;
+		image.pixels = core::decode_bitmap(file_path,file_bytes,file_byte_count,&image.width,&image.height,tile_dimension);
+		return image;
+	}
+
+	//Plain sprites are stored as an array texture with a single layer.
+	[[nodiscard]] static Dimensions decoded_image_layer_dimensions(const Decoded_Image& image) noexcept {
+		if(image.tile_dimension == 0) return {image.width,image.height};
+		return {image.tile_dimension,image.tile_dimension};
+	}
+
+	[[nodiscard]] static std::vector<std::uint64_t> compute_layer_hashes(const Decoded_Image& image) {
+		auto layer_dims = core::decoded_image_layer_dimensions(image);
+		std::size_t layer_byte_count = std::size_t(layer_dims.width) * layer_dims.height * 4;
+		std::vector<std::uint64_t> hashes{};
+		hashes.resize(image.pixels.size() / layer_byte_count);
+		for(std::size_t i = 0;i < hashes.size();i += 1) {
+			//FNV-1a, good enough to tell whether an artist touched a tile.
+			std::uint64_t hash = 14695981039346656037ull;
+			for(std::size_t j = 0;j < layer_byte_count;j += 1) {
+				hash ^= image.pixels[i * layer_byte_count + j];
+				hash *= 1099511628211ull;
+			}
+			hashes[i] = hash;
 		}
-		catch(...) {
-			glDeleteBuffers(1,&uniform_buffer_id);
-			glDeleteTextures(1,&texture_id);
-			throw;
+		return hashes;
+	}
+
+	Sprite_Index Renderer::acquire_sprite(const char* file_path,std::uint32_t tile_dimension,const std::uint8_t* file_bytes,std::size_t file_byte_count) {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		auto path_key = core::normalized_file_path(file_path);
+		if(auto found = data.sprite_indices_by_path.find(path_key);found != data.sprite_indices_by_path.end()) {
+			Sprite& sprite = data.sprites[found->second];
+			if(sprite.layer_size != tile_dimension) throw Runtime_Exception("Sprite was already loaded with a different atlas tile size.");
+			Sprite_Index sprite_index = {found->second,sprite.generation};
+			//The caller already paid for reading the file, so it might as well be uploaded.
+			if(!sprite.resident && file_bytes) upload_sprite(sprite_index,decode_image(file_path,file_bytes,file_byte_count,tile_dimension));
+			sprite.reference_count += 1;
+			return sprite_index;
 		}
+
+		Dimensions layer_dims = {tile_dimension,tile_dimension};
+		std::uint32_t layer_count = 1;
+		Decoded_Image image{};
+		if(file_bytes) {
+			image = decode_image(file_path,file_bytes,file_byte_count,tile_dimension);
+			layer_dims = core::decoded_image_layer_dimensions(image);
+			layer_count = std::uint32_t(image.pixels.size() / (std::size_t(layer_dims.width) * layer_dims.height * 4));
+		}
+		else {
+			auto image_dims = core::read_bitmap_dimensions(file_path);
+			if(tile_dimension == 0) layer_dims = image_dims;
+			else if((image_dims.width % tile_dimension) != 0 || (image_dims.height % tile_dimension) != 0) throw Runtime_Exception("Invalid sprite atlas tile size.");
+			else layer_count = (image_dims.width / tile_dimension) * (image_dims.height / tile_dimension);
+		}
+
+		auto sprite_index = insert_sprite(file_path,layer_count,tile_dimension);
+		data.sprite_indices_by_path.emplace(std::move(path_key),sprite_index.index);
+		Sprite& sprite = data.sprites[sprite_index.index];
+		sprite.layer_dimensions = layer_dims;
+		if(file_bytes) {
+			try {
+				upload_sprite(sprite_index,image);
+			}
+			catch(...) {
+				release_sprite(sprite_index);
+				throw;
+			}
+		}
+		return sprite_index;
 	}
 
-	Sprite_Index Renderer::sprite_atlas(const char* file_path,std::uint32_t tile_dimension) {
+	void Renderer::release_sprite(const Sprite_Index& sprite_index) {
 		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		if(sprite_index.index >= data.sprites.size()) throw Runtime_Exception("Invalid sprite index (out of bounds).");
+		Sprite& sprite = data.sprites[sprite_index.index];
+		if(sprite.generation != sprite_index.generation || !sprite.has_value) throw Runtime_Exception("Invalid sprite index (outdated).");
+
+		sprite.reference_count -= 1;
+		if(sprite.reference_count > 0) return;
+		core::flush_sprite(sprite,data.camera);
+		core::evict_sprite(data,sprite);
+		data.sprite_indices_by_path.erase(core::normalized_file_path(sprite.file_path.c_str()));
+		sprite.file_path.clear();
+		sprite.has_value = false;
+		data.free_sprite_indices.push_back(sprite_index.index);
+	}
 
-		std::uint32_t width = 0;
-		std::uint32_t height = 0;
-		std::vector<std::uint8_t> pixels = core::load_bitmap_from_file(file_path,&width,&height);
-		if((width % tile_dimension) != 0 || (height % tile_dimension) != 0) throw Runtime_Exception("Invalid sprite atlas tile size.");
+	void Renderer::upload_sprite(const Sprite_Index& sprite_index,const Decoded_Image& image) {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		Sprite& sprite = data.sprites[sprite_index.index];
 #if defined(DEBUG_BUILD)
-		std::cout << "[Rendering] Loading an image from file \"" << file_path << "\" (width: " << width << ", height: " << height << ")." << std::endl;
+		std::cout << "[Rendering] Loading an image from file \"" << sprite.file_path << "\" (width: " << image.width << ", height: " << image.height << ")." << std::endl;
 #endif
+		auto layer_dims = core::decoded_image_layer_dimensions(image);
+		auto layer_count = std::uint32_t(image.pixels.size() / (std::size_t(layer_dims.width) * layer_dims.height * 4));
+		std::size_t byte_count = image.pixels.size() + data.object_data_uniform_buffer_size;
+		core::evict_sprites_over_budget(data,byte_count);
 
+		//We use 'GL_TEXTURE_2D_ARRAY' instead of 'GL_TEXTURE_2D' to simplify shaders.
 		GLuint texture_id = 0;
 		glGenTextures(1,&texture_id);
 		glBindTexture(GL_TEXTURE_2D_ARRAY,texture_id);
@@ -572,28 +931,12 @@ namespace core {
 		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D_ARRAY,GL_TEXTURE_MAG_FILTER,GL_NEAREST);
 
-		std::uint32_t tile_count_x = width / tile_dimension;
-		std::uint32_t tile_count_y = height / tile_dimension;
-		glTexImage3D(GL_TEXTURE_2D_ARRAY,0,GL_RGBA,tile_dimension,tile_dimension,tile_count_x * tile_count_y,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+		//'decode_bitmap' already laid every tile out as a separate array layer, so the whole atlas is uploaded at once.
+		glTexImage3D(GL_TEXTURE_2D_ARRAY,0,GL_RGBA,layer_dims.width,layer_dims.height,layer_count,0,GL_RGBA,GL_UNSIGNED_BYTE,image.pixels.data());
 
+		//Each texture has its own uniform buffer for storing data related to quads rendered with the texture.
 		GLuint uniform_buffer_id = 0;
 		try {
-			std::vector<std::uint8_t> tmp_pixels = {};
-			tmp_pixels.resize(std::size_t(tile_dimension) * tile_dimension * 4);
-
-			//The code below extracts sprites from an atlas and each sprite is put as a seperate array layer.
-			for(std::uint32_t base_y = 0;base_y < height;base_y += tile_dimension) {
-				for(std::uint32_t x = 0;x < width;x += tile_dimension) {
-					std::uint32_t offset = 0;
-					for(std::uint32_t y = 0;y < tile_dimension;y += 1) {
-						std::memcpy(&tmp_pixels[offset],&pixels[((std::size_t(base_y) + y) * width + x) * 4],std::size_t(tile_dimension) * 4);
-						offset += tile_dimension * 4;
-					}
-					std::uint32_t index = (base_y / tile_dimension) * tile_count_x + (x / tile_dimension);
-					glTexSubImage3D(GL_TEXTURE_2D_ARRAY,0,0,0,index,tile_dimension,tile_dimension,1,GL_RGBA,GL_UNSIGNED_BYTE,tmp_pixels.data());
-				}
-			}
-
 			glGenBuffers(1,&uniform_buffer_id);
 			glBindBuffer(GL_UNIFORM_BUFFER,uniform_buffer_id);
 			glBufferData(GL_UNIFORM_BUFFER,data.object_data_uniform_buffer_size,nullptr,GL_DYNAMIC_DRAW);
@@ -601,43 +944,276 @@ namespace core {
 			GLint64 actual_size = 0;
 			glGetBufferParameteri64v(GL_UNIFORM_BUFFER,GL_BUFFER_SIZE,&actual_size);
 			if(data.object_data_uniform_buffer_size != std::size_t(actual_size)) throw Runtime_Exception("Couldn't allocate an uniform buffer.");
-			return insert_sprite(texture_id,uniform_buffer_id,tile_count_x * tile_count_y,tile_dimension);
+			sprite.matrices.resize(data.object_data_capacity);
+			sprite.object_datas.resize(data.object_data_capacity);
+			sprite.layer_hashes = core::compute_layer_hashes(image);
 		}
 		catch(...) {
 			if(glIsBuffer(uniform_buffer_id)) glDeleteBuffers(1,&uniform_buffer_id);
 			glDeleteTextures(1,&texture_id);
 			throw;
 		}
+		if(!sprite.pinned) sprite.lru_position = data.lru_sprites.insert(data.lru_sprites.end(),sprite_index.index);
+		sprite.resident = true;
+		sprite.last_used_frame = data.frame_index;
+		sprite.texture_id = texture_id;
+		sprite.scene_data_uniform_buffer = uniform_buffer_id;
+		sprite.current_object_data_index = 0;
+		sprite.array_layers = layer_count;
+		sprite.layer_dimensions = layer_dims;
+		sprite.resident_byte_count = byte_count;
+		data.resident_texture_byte_count += byte_count;
 	}
 
-	Sprite_Index Renderer::insert_sprite(unsigned int texture_id,unsigned int uniform_buffer_id,std::uint32_t array_layers,std::uint32_t layer_size) {
+	void Renderer::reload_sprite(const Sprite_Index& sprite_index,const Decoded_Image& image) {
 		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		if(sprite_index.index >= data.sprites.size()) throw Runtime_Exception("Invalid sprite index (out of bounds).");
+		Sprite& sprite = data.sprites[sprite_index.index];
+		if(sprite.generation != sprite_index.generation || !sprite.has_value) throw Runtime_Exception("Invalid sprite index (outdated).");
+
+		auto layer_dims = core::decoded_image_layer_dimensions(image);
+		auto layer_count = std::uint32_t(image.pixels.size() / (std::size_t(layer_dims.width) * layer_dims.height * 4));
+		auto layer_hashes = core::compute_layer_hashes(image);
+		std::size_t layer_byte_count = std::size_t(layer_dims.width) * layer_dims.height * 4;
+
+		sprite.load_failed = false;
+		//Evicted sprites are read from the drive again when drawn, so only the layout has to be kept up to date.
+		if(!sprite.resident) {
+			sprite.array_layers = layer_count;
+			sprite.layer_dimensions = layer_dims;
+			return;
+		}
+
+		//Sprites that are queued for drawing must be flushed before their texture changes.
+		core::flush_sprite(sprite,data.camera);
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY,sprite.texture_id);
+		if(layer_dims.width != sprite.layer_dimensions.width || layer_dims.height != sprite.layer_dimensions.height || layer_count != sprite.array_layers) {
+			//The layout changed, so the storage has to be respecified. The texture object stays the same, hence handles stay valid.
+			glTexImage3D(GL_TEXTURE_2D_ARRAY,0,GL_RGBA,layer_dims.width,layer_dims.height,layer_count,0,GL_RGBA,GL_UNSIGNED_BYTE,image.pixels.data());
+			sprite.array_layers = layer_count;
+			sprite.layer_dimensions = layer_dims;
+			sprite.layer_hashes = std::move(layer_hashes);
+			data.resident_texture_byte_count -= sprite.resident_byte_count;
+			sprite.resident_byte_count = image.pixels.size() + data.object_data_uniform_buffer_size;
+			data.resident_texture_byte_count += sprite.resident_byte_count;
+			return;
+		}
 
-		for(std::size_t i = 0;i < data.sprites.size();i += 1) {
-			auto& sprite = data.sprites[i];
-			if(!sprite.has_value) {
-				sprite.has_value = true;
-				sprite.generation += 1;
-				sprite.texture_id = texture_id;
-				sprite.scene_data_uniform_buffer = uniform_buffer_id;
-				sprite.array_layers = array_layers;
-				sprite.layer_size = layer_size;
-				sprite.current_object_data_index = 0;
-				return {i,sprite.generation};
+		//Only runs of layers that actually changed are uploaded.
+		for(std::uint32_t first = 0;first < layer_count;) {
+			if(layer_hashes[first] == sprite.layer_hashes[first]) {
+				first += 1;
+				continue;
 			}
+			std::uint32_t last = first + 1;
+			while(last < layer_count && layer_hashes[last] != sprite.layer_hashes[last]) last += 1;
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY,0,0,0,GLint(first),layer_dims.width,layer_dims.height,GLsizei(last - first),GL_RGBA,GL_UNSIGNED_BYTE,&image.pixels[first * layer_byte_count]);
+			first = last;
 		}
+		sprite.layer_hashes = std::move(layer_hashes);
+	}
+
+	Sprite_Index Renderer::insert_sprite(const char* file_path,std::uint32_t array_layers,std::uint32_t layer_size) {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
 
-		Sprite sprite{};
+		std::size_t index = data.sprites.size();
+		if(!data.free_sprite_indices.empty()) {
+			index = data.free_sprite_indices.back();
+			data.free_sprite_indices.pop_back();
+		}
+		else data.sprites.emplace_back();
+
+		//Slots are reused, the generation tells stale 'Sprite_Index' values apart.
+		auto& sprite = data.sprites[index];
 		sprite.has_value = true;
-		sprite.generation = 1;
-		sprite.texture_id = texture_id;
-		sprite.scene_data_uniform_buffer = uniform_buffer_id;
+		sprite.resident = false;
+		sprite.load_pending = false;
+		sprite.load_failed = false;
+		sprite.pinned = false;
+		sprite.generation += 1;
+		sprite.reference_count = 1;
+		sprite.file_path = file_path;
 		sprite.array_layers = array_layers;
 		sprite.layer_size = layer_size;
 		sprite.current_object_data_index = 0;
-		sprite.object_datas.resize(data.object_data_uniform_buffer_size / sizeof(Object_Data));
-		data.sprites.push_back(std::move(sprite));
-		return {data.sprites.size() - 1,1};
+		sprite.last_used_frame = data.frame_index;
+		return {index,sprite.generation};
+	}
+
+	void Renderer::load_sprite(const Sprite_Index& sprite_index) {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		Sprite& sprite = data.sprites[sprite_index.index];
+		if(sprite.resident || sprite.load_pending || sprite.load_failed) return;
+		if(!data.file_io) {
+			auto file_bytes = core::read_whole_file(sprite.file_path.c_str());
+			upload_sprite(sprite_index,decode_image(sprite.file_path.c_str(),file_bytes.data(),file_bytes.size(),sprite.layer_size));
+			return;
+		}
+
+		//Decoded on the worker thread, only the upload happens on the thread that owns the OpenGL context.
+		sprite.load_pending = true;
+		auto image = std::make_shared<Decoded_Image>();
+		data.file_io->submit_read(sprite.file_path.c_str(),[this,sprite_index,image](File_Completion& completion) {
+			Renderer_Internal_Data& current_data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+			//The sprite may have been released while its file was being read.
+			Sprite& loaded_sprite = current_data.sprites[sprite_index.index];
+			if(loaded_sprite.generation != sprite_index.generation || !loaded_sprite.has_value) return;
+			loaded_sprite.load_pending = false;
+			if(loaded_sprite.resident) return;
+			if(!completion.succeeded()) {
+				loaded_sprite.load_failed = true;
+				std::cerr << "[Rendering] Couldn't load \"" << completion.file_path << "\", drawing a placeholder instead." << std::endl;
+				return;
+			}
+			upload_sprite(sprite_index,*image);
+		},[image,tile_dimension = sprite.layer_size](File_Completion& completion) {
+			*image = Renderer::decode_image(completion.file_path.c_str(),completion.data.data(),completion.data.size(),tile_dimension);
+		});
+	}
+
+	void Renderer::prefetch_sprite(const Sprite_Index& sprite_index) {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		if(sprite_index.index >= data.sprites.size()) throw Runtime_Exception("Invalid sprite index (out of bounds).");
+		Sprite& sprite = data.sprites[sprite_index.index];
+		if(sprite.generation != sprite_index.generation || !sprite.has_value) throw Runtime_Exception("Invalid sprite index (outdated).");
+		load_sprite(sprite_index);
+	}
+
+	void Renderer::set_file_io(Async_File_Io* file_io) noexcept {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		data.file_io = file_io;
+		//Requests of the previous queue won't complete anymore.
+		for(auto& sprite : data.sprites) sprite.load_pending = false;
+	}
+
+	void Renderer::set_texture_memory_budget(std::size_t byte_count) noexcept {
+		Renderer_Internal_Data& data = *std::launder(reinterpret_cast<Renderer_Internal_Data*>(data_buffer));
+		data.texture_memory_budget = byte_count;
+	}
+
+	std::size_t Renderer::resident_texture_memory() const noexcept {
+		const Renderer_Internal_Data& data = *std::launder(reinterpret_cast<const Renderer_Internal_Data*>(data_buffer));
+		return data.resident_texture_byte_count;
+	}
+
+	void Renderer::report_memory(Memory_Report* report) const noexcept {
+		const Renderer_Internal_Data& data = *std::launder(reinterpret_cast<const Renderer_Internal_Data*>(data_buffer));
+		std::size_t staging_byte_count = 0;
+		std::size_t bookkeeping_byte_count = core::reserved_bytes(data.sprites) + core::reserved_bytes(data.free_sprite_indices) + core::reserved_bytes(data.font_character_infos);
+		std::size_t uniform_buffer_byte_count = 0;
+		for(const auto& sprite : data.sprites) {
+			staging_byte_count += core::reserved_bytes(sprite.matrices) + core::reserved_bytes(sprite.object_datas);
+			bookkeeping_byte_count += core::reserved_bytes(sprite.layer_hashes) + sprite.file_path.capacity();
+			//'resident_byte_count' holds the texture together with the uniform buffer of the sprite.
+			if(sprite.has_value && sprite.resident) uniform_buffer_byte_count += data.object_data_uniform_buffer_size;
+		}
+		bookkeeping_byte_count += core::hash_table_bytes(data.sprite_indices_by_path);
+		//Every list node holds the index and two links.
+		bookkeeping_byte_count += data.lru_sprites.size() * (sizeof(std::size_t) + 2 * sizeof(void*));
+		for(const auto& [file_path,index] : data.sprite_indices_by_path) bookkeeping_byte_count += file_path.capacity();
+		report->add(Memory_Tag::Sprite_Staging,staging_byte_count);
+		report->add(Memory_Tag::Renderer,bookkeeping_byte_count);
+		report->add(Memory_Tag::Textures,data.resident_texture_byte_count - uniform_buffer_byte_count);
+		report->add(Memory_Tag::Gpu_Buffers,uniform_buffer_byte_count + data.sprite_buffer_byte_count);
+	}
+
+	//Big enough that the pixels don't fit into the caches, like the sprite sheets of large maps.
+	static constexpr std::uint32_t Decode_Benchmark_Image_Dimension = 2048;
+	static constexpr std::uint32_t Decode_Benchmark_Tile_Dimension = 16;
+	static constexpr std::uint32_t Decode_Benchmark_Repeat_Count = 5;
+	static constexpr std::uint32_t Decode_Benchmark_Seed = 0xB17;
+
+	//Writes a 32-bit BITMAPV5HEADER bitmap with BGRA masks and random pixels, the layout every image editor exports.
+	[[nodiscard]] static std::vector<std::uint8_t> make_benchmark_bitmap(std::uint32_t dimension) {
+		static constexpr std::uint32_t Pixel_Data_Offset = 14 + 124;
+		std::size_t pixel_byte_count = std::size_t(dimension) * dimension * 4;
+		std::vector<std::uint8_t> bytes(Pixel_Data_Offset + pixel_byte_count);
+		std::size_t cursor = 0;
+		auto write = [&](auto value) {
+			std::memcpy(&bytes[cursor],&value,sizeof(value));
+			cursor += sizeof(value);
+		};
+		write('B');
+		write('M');
+		write(std::uint32_t(bytes.size()));
+		write(std::uint32_t(0));
+		write(Pixel_Data_Offset);
+		write(std::uint32_t(124));
+		write(std::int32_t(dimension));
+		write(std::int32_t(dimension));
+		write(std::uint16_t(1));
+		write(std::uint16_t(32));
+		write(std::uint32_t(3));
+		write(std::uint32_t(pixel_byte_count));
+		write(std::int32_t(2835));
+		write(std::int32_t(2835));
+		write(std::uint32_t(0));
+		write(std::uint32_t(0));
+		write(std::uint32_t(0x00FF0000u));
+		write(std::uint32_t(0x0000FF00u));
+		write(std::uint32_t(0x000000FFu));
+		write(std::uint32_t(0xFF000000u));
+
+		std::vector<std::uint32_t> row(dimension);
+		for(std::uint32_t y = 0;y < dimension;y += 1) {
+			core::fill_random_u32({Decode_Benchmark_Seed,0},0,y,row.data(),row.size());
+			std::memcpy(&bytes[Pixel_Data_Offset + std::size_t(y) * dimension * 4],row.data(),std::size_t(dimension) * 4);
+		}
+		return bytes;
+	}
+
+	//Keeps the fastest repetition, the one least disturbed by the rest of the system.
+	template<typename Test>
+	[[nodiscard]] static std::chrono::nanoseconds time_decode_test(Test test) {
+		auto fastest = std::chrono::nanoseconds::max();
+		for(std::uint32_t i = 0;i < Decode_Benchmark_Repeat_Count;i += 1) {
+			auto start = std::chrono::steady_clock::now();
+			test();
+			fastest = std::min(fastest,std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start));
+		}
+		return fastest;
+	}
+
+	std::string run_bitmap_decode_benchmark() {
+		auto dimension = Decode_Benchmark_Image_Dimension;
+		auto file_bytes = core::make_benchmark_bitmap(dimension);
+		std::size_t pixel_count = std::size_t(dimension) * dimension;
+		const std::uint8_t* raw_pixels = &file_bytes[file_bytes.size() - pixel_count * 4];
+		Bitmap_Channel_Shifts shifts = {16,8,0,24};
+
+		std::string report = "test,pixels,ms,ns_per_pixel\n";
+		auto add_line = [&](const char* test,std::chrono::nanoseconds time) {
+			char buffer[256] = {};
+			int count = std::snprintf(buffer,sizeof(buffer) - 1,"%s,%zu,%.3f,%.3f\n",test,pixel_count,double(time.count()) / 1000000.0,double(time.count()) / double(pixel_count));
+			if(count < 0) throw Runtime_Exception("Couldn't create the decode benchmark report.");
+			report += buffer;
+		};
+
+		//Every kernel has to produce the same pixels as the scalar one.
+		std::vector<std::uint8_t> expected(pixel_count * 4);
+		std::vector<std::uint8_t> pixels(pixel_count * 4);
+		std::pair<const char*,Swizzle_Bitmap_Pixels_Func> kernels[] = {
+			{"swizzle_scalar",&core::swizzle_bitmap_pixels_scalar},
+#if defined(CORE_SSE2)
+			{"swizzle_sse2",&core::swizzle_bitmap_pixels_sse2},
+#endif
+#if defined(CORE_X86)
+			{"swizzle_avx2",core::cpu_supports_avx2() ? &core::swizzle_bitmap_pixels_avx2 : nullptr},
+#endif
+		};
+		core::swizzle_bitmap_pixels_scalar(raw_pixels,expected.data(),pixel_count,shifts);
+		for(auto [test,kernel] : kernels) {
+			if(!kernel) continue;
+			add_line(test,core::time_decode_test([&] { kernel(raw_pixels,pixels.data(),pixel_count,shifts); }));
+			if(pixels != expected) throw Runtime_Exception("Bitmap swizzle kernels produced different pixels.");
+		}
+
+		//Whole decodes include parsing the header, flipping the rows and allocating the result, as the asset loader pays for them.
+		Decoded_Image image{};
+		add_line("decode_sprite",core::time_decode_test([&] { image = Renderer::decode_image("benchmark.bmp",file_bytes.data(),file_bytes.size()); }));
+		add_line("decode_atlas",core::time_decode_test([&] { image = Renderer::decode_image("benchmark.bmp",file_bytes.data(),file_bytes.size(),Decode_Benchmark_Tile_Dimension); }));
+		return report;
 	}
 
 	void Renderer::adjust_viewport() {
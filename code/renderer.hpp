@@ -1,6 +1,8 @@
 #ifndef RENDERER_HPP
 #define RENDERER_HPP
 
+#include <string>
+#include <vector>
 #include <cstddef>
 #include <cstdint>
 #include "math.hpp"
@@ -19,11 +21,26 @@ namespace core {
 		std::uint32_t generation;
 	};
 
+	//Result of decoding an image file into RGBA8 pixels. Decoding doesn't touch OpenGL, so it can be done on any thread.
+	struct Decoded_Image {
+		std::uint32_t width;
+		std::uint32_t height;
+		//0 for plain sprites, otherwise atlas tiles are stored one after another (see 'Renderer::sprite_atlas').
+		std::uint32_t tile_dimension;
+		std::vector<std::uint8_t> pixels;
+	};
+
 	class Platform;
+	class Async_File_Io;
+	struct Memory_Report;
 	class Renderer {
 		void destroy() noexcept;
 		void adjust_viewport();
-		[[nodiscard]] Sprite_Index insert_sprite(unsigned int texture_id,unsigned int uniform_buffer_id,std::uint32_t array_layers,std::uint32_t layer_size);
+		[[nodiscard]] Sprite_Index insert_sprite(const char* file_path,std::uint32_t array_layers,std::uint32_t layer_size);
+		[[nodiscard]] Sprite_Index acquire_sprite(const char* file_path,std::uint32_t tile_dimension,const std::uint8_t* file_bytes,std::size_t file_byte_count);
+		void upload_sprite(const Sprite_Index& sprite_index,const Decoded_Image& image);
+		//Starts reading a non-resident sprite, through 'Async_File_Io' if one is set and right away otherwise.
+		void load_sprite(const Sprite_Index& sprite_index);
 		explicit Renderer(Platform* _platform);
 	public:
 		Renderer(const Renderer&) = delete;
@@ -35,19 +52,47 @@ namespace core {
 		void draw_sprite(Vec3 position,Vec2 size,float rotation,Vec4 color,bool rainbow_effect,const Sprite_Index& sprite_index,std::uint32_t sprite_layer_index = 0);
 		void draw_text(Vec3 position,Vec2 char_size,Vec3 color,const char* text);
 		[[nodiscard]] Rect compute_text_dims(Vec3 position,Vec2 char_size,const char* text);
+		//Sprites drawn afterwards are moved so that 'position' ends up in the top-left corner of the screen. Reset it to draw on the screen itself, e.g. text.
+		void set_camera(Vec2 position) noexcept;
 
-		//Texture are freed the moment rendering engine is destroyed.
+		static inline constexpr std::size_t Default_Texture_Memory_Budget = 256 * 1024 * 1024;
+
+		//Sprites are shared by file path, asking for a path that is already loaded returns the same 'Sprite_Index'.
+		//These overloads only read the image header, the texture is loaded the first time the sprite is drawn (or prefetched).
 		[[nodiscard]] Sprite_Index sprite(const char* file_path);
 		[[nodiscard]] Sprite_Index sprite_atlas(const char* file_path,std::uint32_t tile_dimension);
+		//These overloads upload an image that has already been read into memory right away.
+		//'file_path' has to stay readable, it is used to load the image again after the texture has been evicted.
+		[[nodiscard]] Sprite_Index sprite(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count);
+		[[nodiscard]] Sprite_Index sprite_atlas(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count,std::uint32_t tile_dimension);
+		[[nodiscard]] static Decoded_Image decode_image(const char* file_path,const std::uint8_t* file_bytes,std::size_t file_byte_count,std::uint32_t tile_dimension = 0);
+		//Replaces the image behind a sprite in place, existing 'Sprite_Index' values stay valid. Only atlas layers whose pixels changed are uploaded.
+		void reload_sprite(const Sprite_Index& sprite_index,const Decoded_Image& image);
+		//Every 'sprite' and 'sprite_atlas' call has to be paired with a release, the sprite is freed when the last one is released.
+		void release_sprite(const Sprite_Index& sprite_index);
+		//Starts loading the texture of a sprite that isn't resident, so it's ready by the time it's first drawn.
+		void prefetch_sprite(const Sprite_Index& sprite_index);
+		//Once set, sprites that aren't resident are read and decoded on its workers while a placeholder is drawn in their place.
+		//Has to be reset before 'file_io' is destroyed. Without one, they are read on the spot.
+		void set_file_io(Async_File_Io* file_io) noexcept;
+		//Textures of sprites that weren't drawn recently are evicted once resident textures take more than this.
+		void set_texture_memory_budget(std::size_t byte_count) noexcept;
+		[[nodiscard]] std::size_t resident_texture_memory() const noexcept;
+		//Adds the memory of the sprites, the font and the buffers and textures on the graphics card to 'report'.
+		void report_memory(Memory_Report* report) const noexcept;
 
 		[[nodiscard]] Urect render_client_rect_dimensions() const noexcept;
 	private:
 		Platform* platform;
 		/*	An object of type 'Renderer_Internal_Data' is placement-newed inside this array internally.
 			This is to avoid having to include all of the headers that would be required to make this work. */
-		alignas(std::max_align_t) unsigned char data_buffer[144];
+		alignas(std::max_align_t) unsigned char data_buffer[512];
 		friend class Platform;
 	};
+
+	/*	Times decoding a large synthetic bitmap: each channel swizzle kernel the CPU supports on its own, then whole decodes as a sprite and as
+		an atlas. Returns the report as CSV, one line per test. Uploading the textures isn't timed, it needs an OpenGL context. */
+	[[nodiscard]] std::string run_bitmap_decode_benchmark();
 }
 
 #endif
@@ -0,0 +1,105 @@
+#include <exception>
+#include <algorithm>
+#include "thread_pool.hpp"
+
+namespace core {
+	Thread_Pool::Thread_Pool(std::size_t thread_count) : threads(),task_memory(),tasks(&task_memory),mutex(),task_available(),stopping() {
+		if(thread_count == 0) {
+			std::size_t hardware_thread_count = std::thread::hardware_concurrency();
+			thread_count = (hardware_thread_count > 1) ? (hardware_thread_count - 1) : 1;
+		}
+		threads.reserve(thread_count);
+		try {
+			for(std::size_t i = 0;i < thread_count;i += 1) threads.emplace_back([this]{ worker_loop(); });
+		}
+		catch(...) {
+			{
+				std::lock_guard lock{mutex};
+				stopping = true;
+			}
+			task_available.notify_all();
+			for(auto& thread : threads) thread.join();
+			throw;
+		}
+	}
+
+	Thread_Pool::~Thread_Pool() {
+		{
+			std::lock_guard lock{mutex};
+			stopping = true;
+		}
+		task_available.notify_all();
+		for(auto& thread : threads) thread.join();
+	}
+
+	void Thread_Pool::submit(std::function<void()> task) {
+		{
+			std::lock_guard lock{mutex};
+			tasks.push_back(std::move(task));
+		}
+		task_available.notify_one();
+	}
+
+	void Thread_Pool::parallel_for(std::size_t count,std::size_t min_range_size,const std::function<void(std::size_t begin,std::size_t end)>& body) {
+		if(count == 0) return;
+		std::size_t range_count = std::min((count + std::max<std::size_t>(min_range_size,1) - 1) / std::max<std::size_t>(min_range_size,1),threads.size() + 1);
+		if(range_count <= 1) {
+			body(0,count);
+			return;
+		}
+		std::size_t range_size = (count + range_count - 1) / range_count;
+
+		struct Shared_State {
+			std::mutex mutex;
+			std::condition_variable all_done;
+			std::size_t remaining_count;
+			std::exception_ptr exception;
+		};
+		Shared_State state{};
+		state.remaining_count = range_count - 1;
+		auto run_range = [&](std::size_t range_index) {
+			try {
+				std::size_t begin = range_index * range_size;
+				std::size_t end = std::min(begin + range_size,count);
+				if(begin < end) body(begin,end);
+			}
+			catch(...) {
+				std::lock_guard lock{state.mutex};
+				if(!state.exception) state.exception = std::current_exception();
+			}
+		};
+		auto run_task = [&](std::size_t range_index) {
+			run_range(range_index);
+			//Notifying under the lock, the caller may destroy 'state' as soon as it can observe the count reaching zero.
+			std::lock_guard lock{state.mutex};
+			state.remaining_count -= 1;
+			if(state.remaining_count == 0) state.all_done.notify_all();
+		};
+		//Tasks capture no more than two words, which 'std::function' stores without allocating.
+		for(std::size_t i = 1;i < range_count;i += 1) submit([&run_task,i] { run_task(i); });
+		run_range(0);
+		{
+			std::unique_lock lock{state.mutex};
+			state.all_done.wait(lock,[&state]{ return state.remaining_count == 0; });
+		}
+		if(state.exception) std::rethrow_exception(state.exception);
+	}
+
+	std::size_t Thread_Pool::thread_count() const noexcept {
+		return threads.size();
+	}
+
+	void Thread_Pool::worker_loop() {
+		for(;;) {
+			std::function<void()> task{};
+			{
+				std::unique_lock lock{mutex};
+				task_available.wait(lock,[this]{ return stopping || !tasks.empty(); });
+				if(tasks.empty()) return;
+				task = std::move(tasks.front());
+				tasks.pop_front();
+			}
+			task();
+		}
+	}
+}
@@ -0,0 +1,41 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <thread>
+#include <cstddef>
+#include <functional>
+#include <memory_resource>
+#include <condition_variable>
+
+namespace core {
+	//A fixed set of worker threads that execute submitted tasks in FIFO order.
+	class Thread_Pool {
+	public:
+		//A 'thread_count' of 0 uses one thread per hardware thread except the one running the game loop.
+		explicit Thread_Pool(std::size_t thread_count = 0);
+		Thread_Pool(const Thread_Pool&) = delete;
+		Thread_Pool& operator=(const Thread_Pool&) = delete;
+		//Tasks that are already queued are finished before the threads are joined.
+		~Thread_Pool();
+		void submit(std::function<void()> task);
+		//Splits [0, 'count') into ranges of at least 'min_range_size' elements and runs 'body' on them using the workers and the calling thread.
+		//Returns once every range is done. The first exception thrown by 'body' is rethrown on the calling thread.
+		void parallel_for(std::size_t count,std::size_t min_range_size,const std::function<void(std::size_t begin,std::size_t end)>& body);
+		[[nodiscard]] std::size_t thread_count() const noexcept;
+	private:
+		void worker_loop();
+
+		std::vector<std::thread> threads;
+		//Keeps the blocks of the queue around once they are freed, so a queue that is filled and drained every frame stops allocating.
+		std::pmr::unsynchronized_pool_resource task_memory;
+		std::pmr::deque<std::function<void()>> tasks;
+		std::mutex mutex;
+		std::condition_variable task_available;
+		bool stopping;
+	};
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <utility>
+#include <cinttypes>
+#include <algorithm>
+#include "random.hpp"
+#include "tile_grid.hpp"
+#include "exceptions.hpp"
+#include "tile_benchmark.hpp"
+
+namespace core {
+	//Half tiles per side, 2048 tiles.
+	static constexpr std::uint32_t Benchmark_Map_Dimension = 4096;
+	static constexpr std::uint32_t Benchmark_Solid_Percentage = 20;
+	static constexpr std::uint32_t Benchmark_Ray_Count = 1 << 18;
+	static constexpr std::uint32_t Benchmark_Tank_Count = 1 << 14;
+	static constexpr std::uint32_t Benchmark_Tank_Step_Count = 64;
+	static constexpr std::uint32_t Benchmark_Repeat_Count = 5;
+	static constexpr std::uint32_t Benchmark_Seed = 0x7113;
+
+	struct Tile_Benchmark_Result {
+		const char* test;
+		std::uint64_t operation_count;
+		std::uint64_t checksum;
+		std::chrono::nanoseconds time;
+	};
+
+	//'test' returns a checksum of what it read, so layouts can be compared and the reads aren't optimized away.
+	template<typename Test>
+	[[nodiscard]] static Tile_Benchmark_Result time_tile_test(const char* name,Test test) {
+		Tile_Benchmark_Result result{name,0,0,std::chrono::nanoseconds::max()};
+		//The fastest repetition is the one least disturbed by the rest of the system.
+		for(std::uint32_t i = 0;i < Benchmark_Repeat_Count;i += 1) {
+			std::uint64_t operation_count = 0;
+			auto start = std::chrono::steady_clock::now();
+			auto checksum = test(&operation_count);
+			auto time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+			if(time < result.time) result = {name,operation_count,checksum,time};
+		}
+		return result;
+	}
+
+	[[nodiscard]] static std::vector<Tile_Benchmark_Result> run_tile_tests(const Tile_Grid& grid,const std::vector<std::uint32_t>& random_values) {
+		auto dimension = std::int32_t(Benchmark_Map_Dimension);
+		auto random_coordinate = [&](std::size_t index) { return std::int32_t(random_values[index] % Benchmark_Map_Dimension); };
+		std::vector<Tile_Benchmark_Result> results{};
+
+		//Rays cast up from random half tiles until they hit a solid tile, addressing every cell by its coordinates like 'Game::raycast'.
+		results.push_back(core::time_tile_test("column_rays",[&](std::uint64_t* operation_count) {
+			std::uint64_t checksum = 0;
+			for(std::uint32_t i = 0;i < Benchmark_Ray_Count;i += 1) {
+				auto x = random_coordinate(2 * i);
+				auto y = random_coordinate(2 * i + 1);
+				for(;y >= 0;y -= 1) {
+					*operation_count += 1;
+					if(grid.cell(x,y) & Tile_Grid::Solid_Bit) break;
+				}
+				checksum += std::uint64_t(y + 1);
+			}
+			return checksum;
+		}));
+		results.push_back(core::time_tile_test("column_rays_cursor",[&](std::uint64_t* operation_count) {
+			std::uint64_t checksum = 0;
+			for(std::uint32_t i = 0;i < Benchmark_Ray_Count;i += 1) {
+				auto ray = grid.cursor(random_coordinate(2 * i),random_coordinate(2 * i + 1));
+				for(;ray.y() >= 0;ray.previous_y()) {
+					*operation_count += 1;
+					if(ray.cell() & Tile_Grid::Solid_Bit) break;
+				}
+				checksum += std::uint64_t(ray.y() + 1);
+			}
+			return checksum;
+		}));
+
+		//Every column swept from the bottom and every row from the right, the way a map covering every half tile is built.
+		results.push_back(core::time_tile_test("line_sweeps",[&](std::uint64_t* operation_count) {
+			std::uint64_t checksum = 0;
+			for(std::int32_t line = 0;line < dimension;line += 1) {
+				auto column = grid.cursor(line,dimension - 1);
+				auto row = grid.cursor(dimension - 1,line);
+				for(std::int32_t i = 0;i < dimension;i += 1) {
+					checksum += std::uint64_t((column.cell() & Tile_Grid::Solid_Bit) != 0) + std::uint64_t((row.cell() & Tile_Grid::Solid_Bit) != 0);
+					column.previous_y();
+					row.previous_x();
+				}
+				*operation_count += 2 * std::uint64_t(dimension);
+			}
+			return checksum;
+		}));
+
+		//Tanks covering 2x2 half tiles move one half tile at a time, testing the edge in front of them like 'Game::check_collision_with_tiles'.
+		//Blocked tanks turn instead.
+		results.push_back(core::time_tile_test("collision_sweeps",[&](std::uint64_t* operation_count) {
+			std::uint64_t checksum = 0;
+			for(std::uint32_t tank = 0;tank < Benchmark_Tank_Count;tank += 1) {
+				auto x = random_coordinate(2 * tank) % (dimension - 2);
+				auto y = random_coordinate(2 * tank + 1) % (dimension - 2);
+				auto dir = random_values[tank] % 4;
+				for(std::uint32_t step = 0;step < Benchmark_Tank_Step_Count;step += 1) {
+					std::int32_t edge_x = (dir == 0) ? x + 2 : (dir == 2) ? x - 1 : x;
+					std::int32_t edge_y = (dir == 1) ? y + 2 : (dir == 3) ? y - 1 : y;
+					bool blocked = !grid.contains(edge_x,edge_y);
+					if(!blocked) {
+						auto edge = grid.cursor(edge_x,edge_y);
+						for(std::uint32_t i = 0;i < 2 && !blocked;i += 1) {
+							*operation_count += 1;
+							blocked = (edge.cell() & Tile_Grid::Solid_Bit) != 0;
+							if(dir == 0 || dir == 2) edge.next_y();
+							else edge.next_x();
+						}
+					}
+					if(blocked) dir = (dir + 1) % 4;
+					else if(dir == 0 || dir == 2) x = (dir == 0) ? x + 1 : x - 1;
+					else y = (dir == 1) ? y + 1 : y - 1;
+				}
+				checksum += std::uint64_t(x) * Benchmark_Map_Dimension + std::uint64_t(y);
+			}
+			return checksum;
+		}));
+		return results;
+	}
+
+	std::string run_tile_layout_benchmark() {
+		//Tanks and rays read whole rows of the map, so the tiles are scattered over every chunk instead of leaving most of them empty.
+		std::vector<Tile_Template> templates = {{0,1,0.0f,Tile_Flag::Solid}};
+		Tile_Grid row_major_grid{};
+		row_major_grid.resize(Benchmark_Map_Dimension,Benchmark_Map_Dimension,Tile_Layout::Row_Major);
+		std::vector<std::uint32_t> row_values(Benchmark_Map_Dimension);
+		for(std::uint32_t y = 0;y < Benchmark_Map_Dimension;y += 1) {
+			core::fill_random_u32({Benchmark_Seed,0},0,y,row_values.data(),row_values.size());
+			for(std::uint32_t x = 0;x < Benchmark_Map_Dimension;x += 1) {
+				if(row_values[x] % 100 < Benchmark_Solid_Percentage) row_major_grid.set(std::int32_t(x),std::int32_t(y),{0,1},templates);
+			}
+		}
+		auto morton_grid = row_major_grid;
+		morton_grid.change_layout(Tile_Layout::Morton);
+
+		std::vector<std::uint32_t> random_values(2 * std::max(Benchmark_Ray_Count,Benchmark_Tank_Count));
+		core::fill_random_u32({Benchmark_Seed,1},0,0,random_values.data(),random_values.size());
+
+		auto row_major_results = core::run_tile_tests(row_major_grid,random_values);
+		auto morton_results = core::run_tile_tests(morton_grid,random_values);
+
+		std::string report = core::cpu_supports_bmi2() ? "#morton codes: pdep/pext\n" : "#morton codes: shifts\n";
+		report += "layout,test,operations,ms,ns_per_operation\n";
+		for(auto [layout,results] : {std::pair{"row_major",&row_major_results},std::pair{"morton",&morton_results}}) {
+			for(const auto& result : *results) {
+				char buffer[256] = {};
+				auto milliseconds = double(result.time.count()) / 1000000.0;
+				int count = std::snprintf(buffer,sizeof(buffer) - 1,"%s,%s,%" PRIu64 ",%.3f,%.3f\n",layout,result.test,result.operation_count,milliseconds,
+										  double(result.time.count()) / double(std::max<std::uint64_t>(result.operation_count,1)));
+				if(count < 0) throw Runtime_Exception("Couldn't create the tile benchmark report.");
+				report += buffer;
+			}
+		}
+		for(std::size_t i = 0;i < row_major_results.size();i += 1) {
+			if(row_major_results[i].checksum != morton_results[i].checksum) throw Runtime_Exception("Tile layouts read different tiles.");
+		}
+		return report;
+	}
+}
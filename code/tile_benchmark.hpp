@@ -0,0 +1,12 @@
+#ifndef TILE_BENCHMARK_HPP
+#define TILE_BENCHMARK_HPP
+
+#include <string>
+
+namespace core {
+	/*	Times the access patterns of the game on a large random map once per 'Tile_Layout': rays walking up columns cell by cell, full row and
+		column sweeps, and the edge checks of tanks moving around. Returns the report as CSV, one line per layout and test. */
+	[[nodiscard]] std::string run_tile_layout_benchmark();
+}
+
+#endif
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include "tile_grid.hpp"
+#include "exceptions.hpp"
+#include "memory_telemetry.hpp"
+
+namespace core {
+	Tile_Grid::Tile_Grid() : grid_width(),grid_height(),chunk_count_x(),cell_layout(),x_bits(),y_bits(),chunk_slots(),chunks(),free_chunks(),modified_chunks(),large_healths() {
+		resize(Default_Width,Default_Height);
+	}
+
+	void Tile_Grid::resize(std::uint32_t width,std::uint32_t height,Tile_Layout layout) {
+		if(width == 0 || height == 0 || width > Max_Dimension || height > Max_Dimension) throw Runtime_Exception("Invalid map size.");
+		grid_width = width;
+		grid_height = height;
+		cell_layout = layout;
+		x_bits = chunk_offset(layout,Chunk_Mask,0);
+		y_bits = chunk_offset(layout,0,Chunk_Mask);
+		chunk_count_x = (width + Chunk_Mask) >> Chunk_Shift;
+		std::uint32_t chunk_count_y = (height + Chunk_Mask) >> Chunk_Shift;
+		chunk_slots.assign(std::size_t(chunk_count_x) * chunk_count_y,No_Chunk);
+		modified_chunks.assign(chunk_slots.size(),0);
+		chunks.clear();
+		free_chunks.clear();
+		large_healths.clear();
+	}
+
+	void Tile_Grid::change_layout(Tile_Layout layout) noexcept {
+		if(layout == cell_layout) return;
+		//Free chunks are reordered too, they are refilled before being reused anyway.
+		for(auto& chunk : chunks) {
+			std::uint16_t reordered[Chunk_Cell_Count];
+			for(std::uint32_t i = 0;i < Chunk_Cell_Count;i += 1) {
+				auto coords = chunk_coords(cell_layout,i);
+				reordered[chunk_offset(layout,coords.x,coords.y)] = chunk.cells[i];
+			}
+			std::copy(std::begin(reordered),std::end(reordered),std::begin(chunk.cells));
+		}
+		cell_layout = layout;
+		x_bits = chunk_offset(layout,Chunk_Mask,0);
+		y_bits = chunk_offset(layout,0,Chunk_Mask);
+	}
+
+	std::uint32_t Tile_Grid::health(std::int32_t x,std::int32_t y) const {
+		auto code = std::uint16_t(cell(x,y) >> Health_Shift);
+		if(code == Indestructible_Health) return std::uint32_t(-1);
+		if(code == Side_Table_Health) return large_healths.at(side_table_key(x,y));
+		return code;
+	}
+
+	Tile Tile_Grid::get(std::int32_t x,std::int32_t y) const {
+		auto value = cell(x,y);
+		if(empty(value)) return {Invalid_Template_Index,0};
+		return {template_index(value),health(x,y)};
+	}
+
+	void Tile_Grid::set(std::int32_t x,std::int32_t y,Tile tile,const std::vector<Tile_Template>& templates) {
+		if(tile.template_index >= Template_Mask) {
+			erase_cell(x,y);
+			return;
+		}
+		auto& chunk = chunk_at(x,y);
+		auto& value = chunk.cells[cell_in_chunk(x,y)];
+		if(empty(value)) chunk.tile_count += 1;
+		std::uint16_t flag = (tile.template_index < templates.size()) ? flag_bit(templates[tile.template_index].flag) : 0;
+		//The health code is kept for 'set_health', which has to know whether the side table holds an entry.
+		value = std::uint16_t((value & Health_Mask) | tile.template_index | flag);
+		set_health(x,y,tile.health);
+	}
+
+	void Tile_Grid::clear() noexcept {
+		std::fill(chunk_slots.begin(),chunk_slots.end(),No_Chunk);
+		std::fill(modified_chunks.begin(),modified_chunks.end(),std::uint8_t(0));
+		chunks.clear();
+		free_chunks.clear();
+		large_healths.clear();
+	}
+
+	void Tile_Grid::damage(std::int32_t x,std::int32_t y) {
+		if(empty(cell(x,y))) return;
+		auto current_health = health(x,y);
+		if(current_health == std::uint32_t(-1)) return;
+		if(current_health == 0) erase_cell(x,y);
+		else set_health(x,y,current_health - 1);
+	}
+
+	void Tile_Grid::refresh_templates(const std::vector<Tile_Template>& templates) {
+		auto flags = std::uint16_t(Solid_Bit | Below_Bit | Above_Bit | Bulletpass_Bit);
+		for(std::size_t slot = 0;slot < chunk_slots.size();slot += 1) {
+			if(chunk_slots[slot] == No_Chunk) continue;
+			auto* cells = chunks[chunk_slots[slot]].cells;
+			for(std::uint32_t i = 0;i < Chunk_Cell_Count;i += 1) {
+				if(empty(cells[i])) continue;
+				auto index = template_index(cells[i]);
+				if(index < templates.size()) {
+					cells[i] = std::uint16_t((cells[i] & ~flags) | flag_bit(templates[index].flag));
+					continue;
+				}
+				auto coords = chunk_coords(cell_layout,i);
+				auto x = std::int32_t((std::uint32_t(slot % chunk_count_x) << Chunk_Shift) | coords.x);
+				auto y = std::int32_t((std::uint32_t(slot / chunk_count_x) << Chunk_Shift) | coords.y);
+				//Releasing the last tile of the chunk releases the chunk, so the loop ends with it.
+				bool last_tile = chunks[chunk_slots[slot]].tile_count == 1;
+				erase_cell(x,y);
+				if(last_tile) break;
+			}
+		}
+	}
+
+	void Tile_Grid::load_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y,const std::uint16_t* cells,const std::vector<Tile_Template>& templates) {
+		unload_chunk(chunk_x,chunk_y);
+		auto first_x = std::int32_t(chunk_x << Chunk_Shift);
+		auto first_y = std::int32_t(chunk_y << Chunk_Shift);
+		if(std::all_of(cells,cells + Chunk_Cell_Count,[](std::uint16_t value) { return empty(value); })) return;
+
+		auto flags = std::uint16_t(Solid_Bit | Below_Bit | Above_Bit | Bulletpass_Bit);
+		auto& chunk = chunk_at(first_x,first_y);
+		for(std::uint32_t i = 0;i < Chunk_Cell_Count;i += 1) {
+			auto value = cells[i];
+			auto index = template_index(value);
+			//Tiles whose template is gone are skipped, the same as 'refresh_templates' clears them.
+			if(index >= templates.size()) continue;
+			if((value >> Health_Shift) == Side_Table_Health) value = std::uint16_t((value & ~Health_Mask) | (Max_Cell_Health << Health_Shift));
+			chunk.cells[chunk_offset(cell_layout,i & Chunk_Mask,i >> Chunk_Shift)] = std::uint16_t((value & ~flags) | flag_bit(templates[index].flag));
+			chunk.tile_count += 1;
+		}
+		if(chunk.tile_count == 0) release_chunk(&chunk_slots[chunk_slot(first_x,first_y)]);
+	}
+
+	void Tile_Grid::copy_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y,std::uint16_t* cells) const noexcept {
+		auto slot = chunk_slots[std::size_t(chunk_y) * chunk_count_x + chunk_x];
+		if(slot == No_Chunk) {
+			std::fill_n(cells,Chunk_Cell_Count,Empty_Cell);
+			return;
+		}
+		const auto& chunk = chunks[slot];
+		for(std::uint32_t i = 0;i < Chunk_Cell_Count;i += 1) {
+			auto value = chunk.cells[chunk_offset(cell_layout,i & Chunk_Mask,i >> Chunk_Shift)];
+			if((value >> Health_Shift) == Side_Table_Health) value = std::uint16_t((value & ~Health_Mask) | (Max_Cell_Health << Health_Shift));
+			cells[i] = value;
+		}
+	}
+
+	bool Tile_Grid::store_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y,std::uint16_t* cells) {
+		auto& modified = modified_chunks[std::size_t(chunk_y) * chunk_count_x + chunk_x];
+		if(modified == 0) return false;
+		modified = 0;
+		copy_chunk(chunk_x,chunk_y,cells);
+		return true;
+	}
+
+	void Tile_Grid::unload_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y) {
+		auto first_x = std::int32_t(chunk_x << Chunk_Shift);
+		auto first_y = std::int32_t(chunk_y << Chunk_Shift);
+		auto& slot = chunk_slots[chunk_slot(first_x,first_y)];
+		modified_chunks[chunk_slot(first_x,first_y)] = 0;
+		if(slot == No_Chunk) return;
+		if(!large_healths.empty()) {
+			const auto& chunk = chunks[slot];
+			for(std::uint32_t i = 0;i < Chunk_Cell_Count;i += 1) {
+				if((chunk.cells[i] >> Health_Shift) != Side_Table_Health) continue;
+				auto coords = chunk_coords(cell_layout,i);
+				large_healths.erase(side_table_key(first_x + std::int32_t(coords.x),first_y + std::int32_t(coords.y)));
+			}
+		}
+		release_chunk(&slot);
+	}
+
+	std::size_t Tile_Grid::memory_usage() const noexcept {
+		return core::reserved_bytes(chunk_slots) + core::reserved_bytes(chunks) + core::reserved_bytes(free_chunks) + core::reserved_bytes(modified_chunks) + core::hash_table_bytes(large_healths);
+	}
+
+	Tile_Grid::Chunk& Tile_Grid::chunk_at(std::int32_t x,std::int32_t y) {
+		auto& slot = chunk_slots[chunk_slot(x,y)];
+		if(slot != No_Chunk) return chunks[slot];
+		if(!free_chunks.empty()) {
+			slot = free_chunks.back();
+			free_chunks.pop_back();
+		}
+		else {
+			chunks.emplace_back();
+			slot = std::uint32_t(chunks.size() - 1);
+			//Destroying tiles during a match must not allocate, so there is always room to release every chunk.
+			free_chunks.reserve(chunks.capacity());
+		}
+		auto& chunk = chunks[slot];
+		std::fill(std::begin(chunk.cells),std::end(chunk.cells),Empty_Cell);
+		chunk.tile_count = 0;
+		return chunk;
+	}
+
+	void Tile_Grid::set_health(std::int32_t x,std::int32_t y,std::uint32_t health) {
+		std::uint16_t code = Side_Table_Health;
+		if(health == std::uint32_t(-1)) code = Indestructible_Health;
+		else if(health < Side_Table_Health) code = std::uint16_t(health);
+
+		auto& value = chunks[chunk_slots[chunk_slot(x,y)]].cells[cell_in_chunk(x,y)];
+		modified_chunks[chunk_slot(x,y)] = 1;
+		if(code == Side_Table_Health) large_healths[side_table_key(x,y)] = health;
+		else if((value >> Health_Shift) == Side_Table_Health) large_healths.erase(side_table_key(x,y));
+		value = std::uint16_t((value & ~Health_Mask) | (code << Health_Shift));
+	}
+
+	void Tile_Grid::erase_cell(std::int32_t x,std::int32_t y) {
+		auto& slot = chunk_slots[chunk_slot(x,y)];
+		if(slot == No_Chunk) return;
+		auto& chunk = chunks[slot];
+		auto& value = chunk.cells[cell_in_chunk(x,y)];
+		if(empty(value)) return;
+		if((value >> Health_Shift) == Side_Table_Health) large_healths.erase(side_table_key(x,y));
+		value = Empty_Cell;
+		modified_chunks[chunk_slot(x,y)] = 1;
+		//Chunks left without tiles are reused for the next ones placed anywhere on the map.
+		chunk.tile_count -= 1;
+		if(chunk.tile_count == 0) release_chunk(&slot);
+	}
+
+	void Tile_Grid::release_chunk(std::uint32_t* slot) {
+		free_chunks.push_back(*slot);
+		*slot = No_Chunk;
+	}
+}
@@ -0,0 +1,218 @@
+#ifndef TILE_GRID_HPP
+#define TILE_GRID_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "math.hpp"
+#include "renderer.hpp"
+
+namespace core {
+	enum struct Tile_Flag {
+		Solid,
+		Below,
+		Above,
+		Bulletpass
+	};
+	[[nodiscard]] inline float tile_flag_to_z_order(Tile_Flag flag) {
+		switch(flag) {
+			case Tile_Flag::Above: return 0.75f;
+			case Tile_Flag::Bulletpass:
+			case Tile_Flag::Below: return -0.25f;
+			default: return 0.0f;
+		}
+	}
+
+	struct Tile_Template {
+		std::uint32_t tile_layer_index;
+		std::uint32_t health;
+		float rotation;
+		Tile_Flag flag;
+	};
+	struct Tile {
+		std::uint32_t template_index;
+		std::uint32_t health;
+	};
+
+	//Order of the cells inside a chunk. In the Z-order (Morton) layout vertical neighbours are as close as horizontal ones.
+	enum struct Tile_Layout {
+		Row_Major,
+		Morton
+	};
+
+	/*	The half tiles of the map, 16 bits each. A cell holds the template index, one bit for the flag of its template and the health, so collision
+		checks and raycasts test the cell alone instead of following the index into the templates.
+		Health too large for a cell, e.g. that of indestructible tiles, is kept in a side table. The flag bits are copies, so they have to be
+		refreshed whenever the templates change.
+		Cells of a chunk are stored either row by row or in Z-order, 'Cursor' walks rows and columns the same way in both.
+		The size of the map is only known once it's loaded, maps can have thousands of tiles per side. Cells are stored in square chunks that
+		are only allocated once a tile is placed in them, the rest of the map reads as empty cells. Accessors taking coordinates don't check
+		them, callers clamp their loops to the grid with 'contains' or 'width' and 'height' first. */
+	class Tile_Grid {
+	public:
+		static inline constexpr std::uint32_t Chunk_Shift = 5;
+		static inline constexpr std::uint32_t Chunk_Size = 1 << Chunk_Shift;
+		static inline constexpr std::uint32_t Chunk_Cell_Count = Chunk_Size * Chunk_Size;
+		//The size of maps that don't say otherwise, one screen.
+		static inline constexpr std::uint32_t Default_Width = Background_Tile_Count_X * 2;
+		static inline constexpr std::uint32_t Default_Height = Background_Tile_Count_Y * 2;
+		static inline constexpr std::uint32_t Max_Dimension = 8192;
+		static inline constexpr std::uint32_t Invalid_Template_Index = std::uint32_t(-1);
+
+		static inline constexpr std::uint16_t Template_Mask = 0x00FF;
+		static inline constexpr std::uint16_t Solid_Bit = 1 << 8;
+		static inline constexpr std::uint16_t Below_Bit = 1 << 9;
+		static inline constexpr std::uint16_t Above_Bit = 1 << 10;
+		static inline constexpr std::uint16_t Bulletpass_Bit = 1 << 11;
+		//Cells without a tile, they have no flag bit set.
+		static inline constexpr std::uint16_t Empty_Cell = Template_Mask;
+
+		/*	Walks a row or a column one cell at a time. Steps only update the offset inside the chunk, the chunk itself is looked up again when
+			the cursor crosses into the next one or steps back onto the grid. Cursors may start and step off the grid, cells there read as empty. */
+		class Cursor {
+		public:
+			Cursor(const Tile_Grid& _grid,std::int32_t _x,std::int32_t _y) noexcept : grid(&_grid),cursor_x(_x),cursor_y(_y),cells(),offset(std::uint32_t(_grid.cell_in_chunk(_x,_y))) {
+				load_chunk();
+			}
+			[[nodiscard]] std::uint16_t cell() const noexcept { return cells ? cells[offset] : Empty_Cell; }
+			[[nodiscard]] std::int32_t x() const noexcept { return cursor_x; }
+			[[nodiscard]] std::int32_t y() const noexcept { return cursor_y; }
+			//The coordinate bits of either layout are incremented in place, the carry skips over the bits of the other coordinate.
+			void next_x() noexcept {
+				cursor_x += 1;
+				offset = (((offset | grid->y_bits) + 1) & grid->x_bits) | (offset & grid->y_bits);
+				if((std::uint32_t(cursor_x) & Chunk_Mask) == 0) load_chunk();
+			}
+			void previous_x() noexcept {
+				cursor_x -= 1;
+				offset = (((offset & grid->x_bits) - 1) & grid->x_bits) | (offset & grid->y_bits);
+				//Coming back from past the right edge doesn't cross a chunk unless the width is a multiple of the chunk size.
+				if((std::uint32_t(cursor_x) & Chunk_Mask) == Chunk_Mask || std::uint32_t(cursor_x) + 1 == grid->grid_width) load_chunk();
+			}
+			void next_y() noexcept {
+				cursor_y += 1;
+				offset = (((offset | grid->x_bits) + 1) & grid->y_bits) | (offset & grid->x_bits);
+				if((std::uint32_t(cursor_y) & Chunk_Mask) == 0) load_chunk();
+			}
+			void previous_y() noexcept {
+				cursor_y -= 1;
+				offset = (((offset & grid->y_bits) - 1) & grid->y_bits) | (offset & grid->x_bits);
+				if((std::uint32_t(cursor_y) & Chunk_Mask) == Chunk_Mask || std::uint32_t(cursor_y) + 1 == grid->grid_height) load_chunk();
+			}
+		private:
+			void load_chunk() noexcept {
+				cells = nullptr;
+				if(!grid->contains(cursor_x,cursor_y)) return;
+				auto chunk = grid->chunk_slots[grid->chunk_slot(cursor_x,cursor_y)];
+				if(chunk != No_Chunk) cells = grid->chunks[chunk].cells;
+			}
+
+			const Tile_Grid* grid;
+			std::int32_t cursor_x;
+			std::int32_t cursor_y;
+			//Null for chunks without tiles and outside the grid.
+			const std::uint16_t* cells;
+			std::uint32_t offset;
+		};
+
+		Tile_Grid();
+		//Every cell of the resized grid is empty.
+		void resize(std::uint32_t width,std::uint32_t height,Tile_Layout layout = Tile_Layout::Row_Major);
+		//Reorders the cells of every chunk, the tiles stay where they are.
+		void change_layout(Tile_Layout layout) noexcept;
+		[[nodiscard]] std::uint32_t width() const noexcept { return grid_width; }
+		[[nodiscard]] std::uint32_t height() const noexcept { return grid_height; }
+		[[nodiscard]] Tile_Layout layout() const noexcept { return cell_layout; }
+		[[nodiscard]] Cursor cursor(std::int32_t x,std::int32_t y) const noexcept { return {*this,x,y}; }
+		[[nodiscard]] bool contains(std::int32_t x,std::int32_t y) const noexcept { return x >= 0 && y >= 0 && std::uint32_t(x) < grid_width && std::uint32_t(y) < grid_height; }
+		[[nodiscard]] std::uint16_t cell(std::int32_t x,std::int32_t y) const noexcept {
+			auto chunk = chunk_slots[chunk_slot(x,y)];
+			if(chunk == No_Chunk) return Empty_Cell;
+			return chunks[chunk].cells[cell_in_chunk(x,y)];
+		}
+		[[nodiscard]] static bool empty(std::uint16_t cell) noexcept { return (cell & Template_Mask) == Empty_Cell; }
+		//'Invalid_Template_Index' for empty cells.
+		[[nodiscard]] static std::uint32_t template_index(std::uint16_t cell) noexcept { return empty(cell) ? Invalid_Template_Index : std::uint32_t(cell & Template_Mask); }
+		[[nodiscard]] static std::uint16_t flag_bit(Tile_Flag flag) noexcept { return std::uint16_t(Solid_Bit << std::uint32_t(flag)); }
+		[[nodiscard]] std::uint32_t health(std::int32_t x,std::int32_t y) const;
+		[[nodiscard]] Tile get(std::int32_t x,std::int32_t y) const;
+		//Tiles whose template isn't loaded yet get no flag bits until 'refresh_templates'.
+		void set(std::int32_t x,std::int32_t y,Tile tile,const std::vector<Tile_Template>& templates);
+		void clear() noexcept;
+		//Takes one health from the tile, a tile without any left is destroyed. Indestructible tiles are left as they are.
+		void damage(std::int32_t x,std::int32_t y);
+		//Copies the flags of changed templates into the cells, tiles whose template is gone are cleared.
+		void refresh_templates(const std::vector<Tile_Template>& templates);
+		//Chunks that hold at least one tile.
+		[[nodiscard]] std::size_t allocated_chunk_count() const noexcept { return chunks.size() - free_chunks.size(); }
+		//Bytes reserved by the grid, freed chunks included.
+		[[nodiscard]] std::size_t memory_usage() const noexcept;
+
+		//Chunk access for 'Map_Stream', which keeps only part of the map in memory. Cells are passed row by row whatever the layout.
+		[[nodiscard]] std::uint32_t chunk_columns() const noexcept { return chunk_count_x; }
+		[[nodiscard]] std::uint32_t chunk_rows() const noexcept { return std::uint32_t(chunk_slots.size() / chunk_count_x); }
+		//Replaces the chunk, flag bits are taken from 'templates' like in 'refresh_templates'. The loaded chunk counts as unmodified.
+		void load_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y,const std::uint16_t* cells,const std::vector<Tile_Template>& templates);
+		//Health too large for a cell is copied as the largest that fits.
+		void copy_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y,std::uint16_t* cells) const noexcept;
+		//Copies the cells out with 'copy_chunk' and returns true if the chunk changed since it was loaded or last stored.
+		bool store_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y,std::uint16_t* cells);
+		//Drops the chunk without storing it, its cells read as empty until it's loaded again.
+		void unload_chunk(std::uint32_t chunk_x,std::uint32_t chunk_y);
+	private:
+		static inline constexpr std::uint32_t Chunk_Mask = Chunk_Size - 1;
+		static inline constexpr std::uint32_t No_Chunk = std::uint32_t(-1);
+		static inline constexpr std::uint32_t Health_Shift = 12;
+		static inline constexpr std::uint16_t Health_Mask = 0xF << Health_Shift;
+		//Health codes 0 to 13 are the health itself.
+		static inline constexpr std::uint16_t Side_Table_Health = 14;
+		static inline constexpr std::uint16_t Max_Cell_Health = Side_Table_Health - 1;
+		static inline constexpr std::uint16_t Indestructible_Health = 15;
+
+		struct Chunk {
+			std::uint16_t cells[Chunk_Cell_Count];
+			std::uint32_t tile_count;
+		};
+
+		[[nodiscard]] std::size_t chunk_slot(std::int32_t x,std::int32_t y) const noexcept {
+			return std::size_t(std::uint32_t(y) >> Chunk_Shift) * chunk_count_x + (std::uint32_t(x) >> Chunk_Shift);
+		}
+		[[nodiscard]] static std::uint32_t chunk_offset(Tile_Layout layout,std::uint32_t local_x,std::uint32_t local_y) noexcept {
+			if(layout == Tile_Layout::Morton) return core::morton_encode(local_x,local_y);
+			return (local_y << Chunk_Shift) | local_x;
+		}
+		//Coordinates inside the chunk of the cell at 'offset'.
+		[[nodiscard]] static Point chunk_coords(Tile_Layout layout,std::uint32_t offset) noexcept {
+			if(layout == Tile_Layout::Morton) return core::morton_decode(offset);
+			return {offset & Chunk_Mask,offset >> Chunk_Shift};
+		}
+		[[nodiscard]] std::size_t cell_in_chunk(std::int32_t x,std::int32_t y) const noexcept {
+			return chunk_offset(cell_layout,std::uint32_t(x) & Chunk_Mask,std::uint32_t(y) & Chunk_Mask);
+		}
+		[[nodiscard]] std::uint32_t side_table_key(std::int32_t x,std::int32_t y) const noexcept { return std::uint32_t(y) * grid_width + std::uint32_t(x); }
+		//Allocates the chunk if it doesn't exist yet.
+		[[nodiscard]] Chunk& chunk_at(std::int32_t x,std::int32_t y);
+		void set_health(std::int32_t x,std::int32_t y,std::uint32_t health);
+		void erase_cell(std::int32_t x,std::int32_t y);
+		//Returns the chunk in 'slot' to the free ones.
+		void release_chunk(std::uint32_t* slot);
+
+		std::uint32_t grid_width;
+		std::uint32_t grid_height;
+		std::uint32_t chunk_count_x;
+		Tile_Layout cell_layout;
+		//Bits of a chunk offset that hold the x and the y coordinate.
+		std::uint32_t x_bits;
+		std::uint32_t y_bits;
+		//Index into 'chunks' for every chunk of the map, or 'No_Chunk'.
+		std::vector<std::uint32_t> chunk_slots;
+		std::vector<Chunk> chunks;
+		std::vector<std::uint32_t> free_chunks;
+		//Set for every chunk whose tiles changed since 'load_chunk' or 'store_chunk', one byte per slot.
+		std::vector<std::uint8_t> modified_chunks;
+		std::unordered_map<std::uint32_t,std::uint32_t> large_healths;
+	};
+}
+
+#endif
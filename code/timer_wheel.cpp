@@ -0,0 +1,127 @@
+#include <algorithm>
+#include "timer_wheel.hpp"
+#include "memory_telemetry.hpp"
+
+namespace core {
+	Timer_Wheel::Timer_Wheel() : timers(),first_free_timer(Invalid_Index),timer_count(),current_tick(),slots() {}
+
+	Timer_Handle Timer_Wheel::schedule(std::uint64_t delay,Timer_Event event) {
+		std::uint32_t index = first_free_timer;
+		if(index == Invalid_Index) {
+			index = std::uint32_t(timers.size());
+			timers.push_back({0,{},1,Invalid_Index,Invalid_Index,Invalid_Index});
+		}
+		else first_free_timer = timers[index].next;
+
+		auto& timer = timers[index];
+		timer.expiry = current_tick + std::clamp<std::uint64_t>(delay,1,Max_Delay);
+		timer.event = event;
+		link(index);
+		timer_count += 1;
+		return {index,timer.generation};
+	}
+
+	bool Timer_Wheel::cancel(Timer_Handle handle) noexcept {
+		if(!pending(handle)) return false;
+		unlink(handle.index);
+		release(handle.index);
+		return true;
+	}
+
+	void Timer_Wheel::clear() noexcept {
+		for(auto& slot : slots) slot = {};
+		first_free_timer = Invalid_Index;
+		for(std::uint32_t i = 0;i < std::uint32_t(timers.size());i += 1) {
+			if(timers[i].slot != Invalid_Index) {
+				timers[i].generation += 1;
+				if(timers[i].generation == 0) timers[i].generation = 1;
+				timers[i].slot = Invalid_Index;
+			}
+			timers[i].next = first_free_timer;
+			first_free_timer = i;
+		}
+		timer_count = 0;
+	}
+
+	void Timer_Wheel::advance(std::uint64_t tick_count,std::pmr::vector<Timer_Event>* expired) {
+		for(std::uint64_t tick = 0;tick < tick_count;tick += 1) {
+			//Nothing can fire or drop a level, so the rest of the ticks can be skipped at once.
+			if(timer_count == 0) {
+				current_tick += tick_count - tick;
+				return;
+			}
+			current_tick += 1;
+
+			//Whenever a level wraps around, the timers in the next slot of the level above drop into the levels below.
+			for(std::uint32_t level = 1;level < Level_Count;level += 1) {
+				if(((current_tick >> ((level - 1) * Slot_Bit_Count)) & (Slot_Count - 1)) != 0) break;
+				auto& slot = slots[level * Slot_Count + ((current_tick >> (level * Slot_Bit_Count)) & (Slot_Count - 1))];
+				auto index = slot.first;
+				slot = {};
+				while(index != Invalid_Index) {
+					auto next = timers[index].next;
+					link(index);
+					index = next;
+				}
+			}
+
+			auto& slot = slots[current_tick & (Slot_Count - 1)];
+			auto index = slot.first;
+			slot = {};
+			while(index != Invalid_Index) {
+				auto next = timers[index].next;
+				expired->push_back(timers[index].event);
+				release(index);
+				index = next;
+			}
+		}
+	}
+
+	std::size_t Timer_Wheel::memory_usage() const noexcept {
+		return core::reserved_bytes(timers);
+	}
+
+	bool Timer_Wheel::pending(Timer_Handle handle) const noexcept {
+		return handle.index < timers.size() && timers[handle.index].generation == handle.generation && timers[handle.index].slot != Invalid_Index;
+	}
+
+	std::uint64_t Timer_Wheel::remaining(Timer_Handle handle) const noexcept {
+		return pending(handle) ? timers[handle.index].expiry - current_tick : 0;
+	}
+
+	void Timer_Wheel::link(std::uint32_t index) {
+		auto& timer = timers[index];
+		//The level is the first one whose slots are wider than the time left, which also keeps the timer out of the slot the level is at right now.
+		auto delay = timer.expiry - current_tick;
+		std::uint32_t level = 0;
+		while(level + 1 < Level_Count && delay >= (std::uint64_t(1) << ((level + 1) * Slot_Bit_Count))) level += 1;
+		timer.slot = level * Slot_Count + std::uint32_t((timer.expiry >> (level * Slot_Bit_Count)) & (Slot_Count - 1));
+
+		//Timers are appended, so those sharing a slot fire in the order they got there.
+		auto& slot = slots[timer.slot];
+		timer.previous = slot.last;
+		timer.next = Invalid_Index;
+		if(slot.last != Invalid_Index) timers[slot.last].next = index;
+		else slot.first = index;
+		slot.last = index;
+	}
+
+	void Timer_Wheel::unlink(std::uint32_t index) noexcept {
+		auto& timer = timers[index];
+		auto& slot = slots[timer.slot];
+		if(timer.previous != Invalid_Index) timers[timer.previous].next = timer.next;
+		else slot.first = timer.next;
+		if(timer.next != Invalid_Index) timers[timer.next].previous = timer.previous;
+		else slot.last = timer.previous;
+	}
+
+	void Timer_Wheel::release(std::uint32_t index) noexcept {
+		auto& timer = timers[index];
+		timer.generation += 1;
+		if(timer.generation == 0) timer.generation = 1;
+		timer.slot = Invalid_Index;
+		timer.next = first_free_timer;
+		first_free_timer = index;
+		timer_count -= 1;
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+namespace core {
+	//What happened, 'kind' is up to the owner of the wheel and 'entity_id' says whom it happened to.
+	struct Timer_Event {
+		std::uint32_t kind;
+		std::uint32_t entity_id;
+		//Tells apart entities that reuse an id, like the slots of a pool.
+		std::uint32_t entity_generation = 0;
+	};
+
+	//Refers to a scheduled timer. Handles of timers that fired or were cancelled stay safe to use, they just aren't pending anymore.
+	struct Timer_Handle {
+		std::uint32_t index = 0;
+		//Zero never refers to a timer, so a default handle isn't pending.
+		std::uint32_t generation = 0;
+	};
+
+	/*	Hierarchical timer wheel counting whole ticks. Each level has 256 slots, a slot of the first level spans one tick and a slot of every next level
+		spans all of the previous one, so four levels cover 2^32 ticks. Timers wait in the level their expiry falls into and drop a level whenever the wheel
+		below them wraps around, until they reach the first level and fire. Scheduling and cancelling are O(1) and advancing costs a constant per tick plus
+		the timers that fire or drop a level, no matter how many are waiting.
+		Timers are kept in a pool and linked by index, so scheduling only allocates while the pool grows. Given the same calls, timers fire in the same order. */
+	class Timer_Wheel {
+	public:
+		static inline constexpr std::uint32_t Level_Count = 4;
+		static inline constexpr std::uint32_t Slot_Bit_Count = 8;
+		static inline constexpr std::uint32_t Slot_Count = 1u << Slot_Bit_Count;
+		//Longer delays are shortened to this.
+		static inline constexpr std::uint64_t Max_Delay = (std::uint64_t(1) << (Level_Count * Slot_Bit_Count)) - 1;
+
+		Timer_Wheel();
+		//Fires 'event' once 'delay' more ticks have passed. A zero delay fires on the next tick.
+		Timer_Handle schedule(std::uint64_t delay,Timer_Event event);
+		//Returns false if the timer wasn't pending.
+		bool cancel(Timer_Handle handle) noexcept;
+		//Drops every timer, the current tick is kept.
+		void clear() noexcept;
+		//Moves 'tick_count' ticks forward and appends the events of the timers that fired to 'expired', in the order they expired.
+		void advance(std::uint64_t tick_count,std::pmr::vector<Timer_Event>* expired);
+		[[nodiscard]] std::size_t memory_usage() const noexcept;
+		[[nodiscard]] bool pending(Timer_Handle handle) const noexcept;
+		//Ticks left until a pending timer fires, zero for any other handle.
+		[[nodiscard]] std::uint64_t remaining(Timer_Handle handle) const noexcept;
+		[[nodiscard]] std::uint64_t now() const noexcept { return current_tick; }
+		[[nodiscard]] std::size_t pending_count() const noexcept { return timer_count; }
+	private:
+		static inline constexpr std::uint32_t Invalid_Index = std::uint32_t(-1);
+		struct Timer {
+			std::uint64_t expiry;
+			Timer_Event event;
+			std::uint32_t generation;
+			std::uint32_t slot;
+			std::uint32_t previous;
+			std::uint32_t next;
+		};
+		struct Slot {
+			std::uint32_t first = Invalid_Index;
+			std::uint32_t last = Invalid_Index;
+		};
+
+		void link(std::uint32_t index);
+		void unlink(std::uint32_t index) noexcept;
+		void release(std::uint32_t index) noexcept;
+
+		std::vector<Timer> timers;
+		std::uint32_t first_free_timer;
+		std::size_t timer_count;
+		std::uint64_t current_tick;
+		Slot slots[Level_Count * Slot_Count];
+	};
+}
+
+#endif